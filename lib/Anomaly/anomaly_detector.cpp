@@ -0,0 +1,211 @@
+#include "anomaly_detector.h"
+
+static const char* EVENT_NAMES[] = {"step_up", "step_down", "panel_mismatch", "no_current", "idle_current"};
+static const char* SIGNAL_NAMES[] = {"panelCurrent", "busVoltage", "simGenerated", "simLoad"};
+
+void ChangeDetector::reset() {
+    mean = 0.0f;
+    variance = 0.0f;
+    high = 0.0f;
+    low = 0.0f;
+    samples = 0;
+}
+
+int ChangeDetector::update(float value) {
+    if (samples++ == 0) {
+        mean = value;
+        return 0;
+    }
+    
+    // Residual in baseline standard deviations (floored so a flat signal does not alarm on noise)
+    float deviation = value - mean;
+    float sigma = max(sqrtf(variance), (float)ANOMALY_SIGMA_FLOOR * fabsf(mean) + 1e-3f);
+    float z = deviation / sigma;
+    high = max(0.0f, high + z - (float)ANOMALY_CUSUM_K);
+    low = max(0.0f, low - z - (float)ANOMALY_CUSUM_K);
+    
+    // Exponentially weighted mean and variance
+    const float alpha = ANOMALY_EWMA_ALPHA;
+    mean += alpha * deviation;
+    variance = (1.0f - alpha) * (variance + alpha * deviation * deviation);
+    
+    if (samples < ANOMALY_WARMUP) {
+        high = 0.0f;
+        low = 0.0f;
+        return 0;
+    }
+    
+    int change = high > ANOMALY_CUSUM_H ? 1 : (low > ANOMALY_CUSUM_H ? -1 : 0);
+    if (change != 0) {
+        // Re-baseline on the new level instead of alarming until the EWMA catches up
+        mean = value;
+        high = 0.0f;
+        low = 0.0f;
+    }
+    return change;
+}
+
+AnomalyDetector::AnomalyDetector(Transistor* transistorRef)
+    : transistor(transistorRef), lastMask(0), settleSamples(0), checkPending(false), expectedCurrent(0.0),
+      noCurrent(false), idleCurrent(false), head(0), count(0), nextSequence(1), processed(0) {
+    for (int i = 0; i < ANOMALY_SIGNALS; i++) detectors[i].reset();
+}
+
+void AnomalyDetector::addSample(const InaSample& sample) {
+    if (sample.overflow) return;
+    process(transistor->getMask(), sample.voltage, sample.current, sample.timeMs);
+}
+
+void AnomalyDetector::addSimulation(const SimulationData& data) {
+    uint32_t now = millis();
+    uint8_t mask = transistor->getMask();
+    checkChange(SIGNAL_SIM_GENERATED, data.powerGenerated, mask, now);
+    checkChange(SIGNAL_SIM_LOAD, data.powerLoad, mask, now);
+}
+
+void AnomalyDetector::process(uint8_t panelMask, float voltage, float current, uint32_t timeMs) {
+    processed++;
+    int panels = __builtin_popcount(panelMask & 0x0F);
+    ChangeDetector& panelCurrent = detectors[SIGNAL_PANEL_CURRENT];
+    
+    checkChange(SIGNAL_BUS_VOLTAGE, voltage, panelMask, timeMs);
+    
+    // Switching: expect the learned per-panel current times the new panel count
+    if (panelMask != lastMask) {
+        bool learned = panelCurrent.samples >= ANOMALY_WARMUP && __builtin_popcount(lastMask & 0x0F) > 0;
+        lastMask = panelMask;
+        expectedCurrent = panelCurrent.mean * panels;
+        checkPending = learned && panels > 0;
+        settleSamples = ANOMALY_SETTLE_SAMPLES;
+    }
+    if (settleSamples > 0) {
+        settleSamples--;
+        if (settleSamples == 0 && checkPending) {
+            checkPending = false;
+            if (fabsf(current - expectedCurrent) > ANOMALY_MISMATCH * expectedCurrent) {
+                addEvent(EVENT_PANEL_MISMATCH, SIGNAL_PANEL_CURRENT, panelMask, current, expectedCurrent, timeMs);
+            }
+        }
+        if (settleSamples == 0 && panels > 0 && current > ANOMALY_IDLE_CURRENT) {
+            // Continue from the settled level, the mismatch is already reported
+            panelCurrent.mean = current / panels;
+            panelCurrent.high = 0.0f;
+            panelCurrent.low = 0.0f;
+        }
+        return;
+    }
+    
+    // All panels off: nothing should flow
+    if (panels == 0) {
+        bool flowing = current > ANOMALY_IDLE_CURRENT;
+        if (flowing && !idleCurrent) addEvent(EVENT_IDLE_CURRENT, SIGNAL_PANEL_CURRENT, panelMask, current, 0.0, timeMs);
+        idleCurrent = flowing;
+        return;
+    }
+    idleCurrent = false;
+    
+    // Panels on but no current
+    bool missing = current < ANOMALY_IDLE_CURRENT;
+    if (missing && !noCurrent) addEvent(EVENT_NO_CURRENT, SIGNAL_PANEL_CURRENT, panelMask, current, panelCurrent.mean * panels, timeMs);
+    noCurrent = missing;
+    if (missing) return;
+    
+    // Per-panel current is independent of how many panels are switched in
+    checkChange(SIGNAL_PANEL_CURRENT, current / panels, panelMask, timeMs);
+}
+
+void AnomalyDetector::checkChange(AnomalySignal signal, float value, uint8_t panelMask, uint32_t timeMs) {
+    ChangeDetector& detector = detectors[signal];
+    float baseline = detector.mean;
+    int change = detector.update(value);
+    if (change != 0) {
+        addEvent(change > 0 ? EVENT_STEP_UP : EVENT_STEP_DOWN, signal, panelMask, value, baseline, timeMs);
+    }
+}
+
+void AnomalyDetector::addEvent(AnomalyType type, AnomalySignal signal, uint8_t panelMask, float value, float expected, uint32_t timeMs) {
+    AnomalyEvent& event = events[head];
+    event.sequence = nextSequence++;
+    event.timeMs = timeMs;
+    event.type = type;
+    event.signal = signal;
+    event.panelMask = panelMask;
+    event.value = value;
+    event.expected = expected;
+    
+    head = (head + 1) % ANOMALY_EVENT_RING;
+    if (count < ANOMALY_EVENT_RING) count++;
+}
+
+String AnomalyDetector::getEventsJson(uint32_t since) {
+    String json = "{";
+    json += "\"processed\":" + String(processed) + ",";
+    json += "\"next\":" + String(nextSequence) + ",";
+    json += "\"baselines\":{";
+    for (int i = 0; i < ANOMALY_SIGNALS; i++) {
+        json += "\"" + String(SIGNAL_NAMES[i]) + "\":" + String(detectors[i].mean, 2);
+        if (i < ANOMALY_SIGNALS - 1) json += ",";
+    }
+    json += "},\"events\":[";
+    
+    bool first = true;
+    for (int i = 0; i < count; i++) {
+        const AnomalyEvent& event = events[(head - count + i + ANOMALY_EVENT_RING) % ANOMALY_EVENT_RING];
+        if (event.sequence <= since) continue;
+        if (!first) json += ",";
+        first = false;
+        json += "{\"seq\":" + String(event.sequence);
+        json += ",\"timeMs\":" + String(event.timeMs);
+        json += ",\"type\":\"" + String(EVENT_NAMES[event.type]) + "\"";
+        json += ",\"signal\":\"" + String(SIGNAL_NAMES[event.signal]) + "\"";
+        json += ",\"panels\":" + String(event.panelMask);
+        json += ",\"value\":" + String(event.value, 2);
+        json += ",\"expected\":" + String(event.expected, 2) + "}";
+    }
+    json += "]}";
+    return json;
+}
+
+String AnomalyDetector::benchmark(int samples, const std::function<void()>& pause) {
+    // Synthetic 4-panel stream: noise, a cloud drop, one dead panel after switching
+    AnomalyDetector detector(nullptr);
+    uint32_t rng = 12345;
+    uint8_t mask = 0x0F;
+    float level = 80.0;  // mA per panel
+    int cloudStart = samples / 3;
+    int cloudEnd = cloudStart + samples / 10;
+    int switchAt = samples * 2 / 3;
+    
+    uint32_t pausedUs = 0;
+    uint32_t startUs = micros();
+    for (int i = 0; i < samples; i++) {
+        if (pause && (i & 4095) == 4095) {
+            // Let other jobs run between chunks, not counted as detector time
+            uint32_t pauseUs = micros();
+            pause();
+            pausedUs += micros() - pauseUs;
+        }
+        
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        float noise = ((int32_t)rng * (1.0f / 2147483648.0f)) * 0.02f;
+        
+        float perPanel = level * ((i >= cloudStart && i < cloudEnd) ? 0.5f : 1.0f);
+        if (i == switchAt) mask = 0x07;  // Panel 4 off; panel 3 "disconnected" below
+        int contributing = mask == 0x0F ? 4 : 2;
+        detector.process(mask, 4.9f * (1.0f + noise), perPanel * contributing * (1.0f + noise), i * JOB_SENSOR_PERIOD);
+    }
+    uint32_t elapsedUs = micros() - startUs - pausedUs;
+    
+    String json = "{";
+    json += "\"samples\":" + String(samples) + ",";
+    json += "\"elapsedUs\":" + String(elapsedUs) + ",";
+    json += "\"samplesPerSecond\":" + String(elapsedUs > 0 ? samples * 1000000.0 / elapsedUs : 0.0, 0) + ",";
+    json += "\"usPerSample\":" + String(samples > 0 ? (float)elapsedUs / samples : 0.0, 3) + ",";
+    json += "\"events\":" + String(detector.nextSequence - 1) + ",";
+    json += "\"stateBytes\":" + String(sizeof(ChangeDetector)) + ",";
+    json += "\"detectorBytes\":" + String(sizeof(AnomalyDetector));
+    json += "}";
+    return json;
+}
@@ -0,0 +1,83 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+#include "ina.h"
+#include "simulation.h"
+#include "transistor.h"
+
+enum AnomalySignal {
+    SIGNAL_PANEL_CURRENT,    // INA current per active panel, mA
+    SIGNAL_BUS_VOLTAGE,      // INA bus voltage, V
+    SIGNAL_SIM_GENERATED,    // Simulated generation, W
+    SIGNAL_SIM_LOAD,         // Simulated load, W
+    ANOMALY_SIGNALS
+};
+
+enum AnomalyType {
+    EVENT_STEP_UP,           // CUSUM: sustained rise above the baseline
+    EVENT_STEP_DOWN,         // CUSUM: sustained drop (cloud, shading)
+    EVENT_PANEL_MISMATCH,    // Current after switching differs from active panels x per-panel baseline
+    EVENT_NO_CURRENT,        // Panels switched on, no current (open connector)
+    EVENT_IDLE_CURRENT       // All panels off, current still flowing
+};
+
+struct AnomalyEvent {
+    uint32_t sequence;
+    uint32_t timeMs;
+    uint8_t type;            // AnomalyType
+    uint8_t signal;          // AnomalySignal
+    uint8_t panelMask;       // Transistor mask at the time of the event
+    float value;             // Measured
+    float expected;          // Baseline or expected value
+};
+
+// EWMA baseline with a two-sided CUSUM on the standardized residual, O(1) per signal
+struct ChangeDetector {
+    float mean;
+    float variance;
+    float high;              // CUSUM of rises
+    float low;               // CUSUM of drops
+    uint32_t samples;
+
+    void reset();
+    int update(float value);  // +1 rise, -1 drop, 0 no change
+};
+
+// Online event detection on the INA sample stream and the simulation output
+class AnomalyDetector {
+public:
+    AnomalyDetector(Transistor* transistorRef);
+    void addSample(const InaSample& sample);           // Sensor job, every burst
+    void addSimulation(const SimulationData& data);    // While a run is active
+    void process(uint8_t panelMask, float voltage, float current, uint32_t timeMs);
+
+    String getEventsJson(uint32_t since);
+    static String benchmark(int samples, const std::function<void()>& pause = nullptr);  // Synthetic stream, samples per second
+
+private:
+    Transistor* transistor;
+    ChangeDetector detectors[ANOMALY_SIGNALS];
+
+    // Expected current after panel switching
+    uint8_t lastMask;
+    uint8_t settleSamples;   // Samples to skip until the new current has settled
+    bool checkPending;
+    float expectedCurrent;
+    bool noCurrent;          // Latched until the condition clears
+    bool idleCurrent;
+
+    // Event ring, oldest overwritten
+    AnomalyEvent events[ANOMALY_EVENT_RING];
+    uint16_t head;
+    uint16_t count;
+    uint32_t nextSequence;
+    uint32_t processed;
+
+    void addEvent(AnomalyType type, AnomalySignal signal, uint8_t panelMask, float value, float expected, uint32_t timeMs);
+    void checkChange(AnomalySignal signal, float value, uint8_t panelMask, uint32_t timeMs);
+};
+
+#endif // ANOMALY_DETECTOR_H
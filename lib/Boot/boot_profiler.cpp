@@ -0,0 +1,36 @@
+#include "boot_profiler.h"
+
+BootProfiler::BootProfiler() : count(0), startUs(0), lastUs(0) {
+}
+
+void BootProfiler::begin() {
+    count = 0;
+    startUs = micros();
+    lastUs = startUs;
+}
+
+void BootProfiler::mark(const char* phase) {
+    uint32_t now = micros();
+    if (count < BOOT_MAX_PHASES) {
+        names[count] = phase;
+        durationsUs[count] = now - lastUs;
+        count++;
+    }
+    lastUs = now;
+}
+
+void BootProfiler::print() {
+    Serial.println("=== Boot Timing ===");
+    for (int i = 0; i < count; i++) {
+        Serial.print("  ");
+        Serial.print(names[i]);
+        Serial.print(": ");
+        Serial.print(durationsUs[i] / 1000.0, 1);
+        Serial.println(" ms");
+    }
+    Serial.print("Total (since setup): ");
+    Serial.print((lastUs - startUs) / 1000.0, 1);
+    Serial.print(" ms, since power-on: ");
+    Serial.print(millis());
+    Serial.println(" ms");
+}
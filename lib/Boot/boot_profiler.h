@@ -0,0 +1,23 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Records the duration of each boot phase for the serial log
+class BootProfiler {
+public:
+    BootProfiler();
+    void begin();
+    void mark(const char* phase);  // End of a phase, measured from the previous mark
+    void print();
+
+private:
+    const char* names[BOOT_MAX_PHASES];
+    uint32_t durationsUs[BOOT_MAX_PHASES];
+    int count;
+    uint32_t startUs;
+    uint32_t lastUs;
+};
+
+#endif // BOOT_PROFILER_H
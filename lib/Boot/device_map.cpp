@@ -0,0 +1,98 @@
+#include "device_map.h"
+#include "config.h"
+
+DeviceMap::DeviceMap() {
+    memset(bitmap, 0, sizeof(bitmap));
+}
+
+int DeviceMap::scan(bool fastBoot) {
+    uint8_t cached[16];
+
+    prefs.begin("boot", true);
+    bool hasCache = prefs.getBytes("i2c", cached, sizeof(cached)) == sizeof(cached);
+    prefs.end();
+
+    // Fast boot: only probe the addresses seen last time, whichever they are
+    // (a unit without display caches just the INA219). An empty map gets a
+    // full scan so devices attached since are found.
+    bool anyCached = false;
+    for (int i = 0; i < 16 && hasCache; i++) anyCached |= cached[i] != 0;
+    if (fastBoot && anyCached) {
+        int count = verifyCached(cached);
+        if (count >= 0) {
+            Serial.print("I2C map verified from cache: ");
+            Serial.print(count);
+            Serial.println(" devices");
+            return count;
+        }
+        Serial.println("I2C cache mismatch, falling back to full scan");
+    }
+
+    int count = fullScan();
+    if (!hasCache || memcmp(cached, bitmap, sizeof(bitmap)) != 0) {
+        saveCache();
+    }
+    return count;
+}
+
+bool DeviceMap::isPresent(uint8_t address) {
+    return (bitmap[address >> 3] >> (address & 7)) & 1;
+}
+
+bool DeviceMap::probe(uint8_t address) {
+    Wire.beginTransmission(address);
+    return Wire.endTransmission() == 0;
+}
+
+int DeviceMap::fullScan() {
+    Serial.println("Starting I2C scan...");
+    memset(bitmap, 0, sizeof(bitmap));
+    int deviceCount = 0;
+
+    for (uint8_t address = 1; address < 127; address++) {
+        if (probe(address)) {
+            bitmap[address >> 3] |= 1 << (address & 7);
+            printDevice(address);
+            deviceCount++;
+        }
+    }
+
+    Serial.print("Total devices found: ");
+    Serial.println(deviceCount);
+    return deviceCount;
+}
+
+int DeviceMap::verifyCached(const uint8_t* cached) {
+    // Returns -1 as soon as a cached device no longer answers
+    memset(bitmap, 0, sizeof(bitmap));
+    int deviceCount = 0;
+
+    for (uint8_t address = 1; address < 127; address++) {
+        if (!((cached[address >> 3] >> (address & 7)) & 1)) continue;
+        if (!probe(address)) return -1;
+
+        bitmap[address >> 3] |= 1 << (address & 7);
+        printDevice(address);
+        deviceCount++;
+    }
+    return deviceCount;
+}
+
+void DeviceMap::saveCache() {
+    prefs.begin("boot", false);
+    prefs.putBytes("i2c", bitmap, sizeof(bitmap));
+    prefs.end();
+}
+
+void DeviceMap::printDevice(uint8_t address) {
+    Serial.print("I2C device found at address: 0x");
+    if (address < 16) Serial.print("0");
+    Serial.println(address, HEX);
+
+    if (address == OLED_ADDR) {
+        Serial.println("  -> OLED detected");
+    }
+    if (address == INA219_ADDR) {
+        Serial.println("  -> INA219 detected");
+    }
+}
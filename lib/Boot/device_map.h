@@ -0,0 +1,26 @@
+#ifndef DEVICE_MAP_H
+#define DEVICE_MAP_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Preferences.h>
+
+// I2C devices found on the bus, cached in NVS for fast boots
+class DeviceMap {
+public:
+    DeviceMap();
+    int scan(bool fastBoot);  // Returns number of devices present
+    bool isPresent(uint8_t address);
+
+private:
+    uint8_t bitmap[16];  // One bit per 7-bit address
+    Preferences prefs;
+
+    bool probe(uint8_t address);
+    int fullScan();
+    int verifyCached(const uint8_t* cached);
+    void saveCache();
+    void printDevice(uint8_t address);
+};
+
+#endif // DEVICE_MAP_H
@@ -0,0 +1,213 @@
+#include "calibration.h"
+
+// NVS layout version, bump when CalibrationSegment changes
+#define CALIBRATION_VERSION 2
+
+struct CalibrationBlob {
+    uint32_t version;
+    CalibrationSegment global;
+    CalibrationSegment segments[CALIBRATION_SEGMENTS];
+    float knots[CALIBRATION_SEGMENTS + 1];
+};
+
+Calibration::Calibration() {
+    clearSegment(global);
+    for (int i = 0; i < CALIBRATION_SEGMENTS; i++) {
+        clearSegment(segments[i]);
+    }
+    buildKnots();
+}
+
+bool Calibration::begin() {
+    CalibrationBlob blob;
+
+    prefs.begin("calibration", true);
+    size_t length = prefs.getBytesLength("model");
+    bool loaded = length == sizeof(blob) && prefs.getBytes("model", &blob, sizeof(blob)) == sizeof(blob);
+    prefs.end();
+
+    if (!loaded || blob.version != CALIBRATION_VERSION) {
+        Serial.println("Calibration: no stored model, using raw INA219 readings");
+        return false;
+    }
+
+    global = blob.global;
+    for (int i = 0; i <= CALIBRATION_SEGMENTS; i++) {
+        if (i < CALIBRATION_SEGMENTS) segments[i] = blob.segments[i];
+        knots[i] = blob.knots[i];
+    }
+
+    Serial.print("Calibration loaded: gain=");
+    Serial.print(global.gain, 4);
+    Serial.print(" offset=");
+    Serial.print(global.offset, 3);
+    Serial.print(" mA, samples=");
+    Serial.println(global.count);
+    return true;
+}
+
+void Calibration::addSample(float rawMA, float referenceMA) {
+    updateSegment(global, rawMA, referenceMA);
+    updateSegment(segments[segmentFor(rawMA)], rawMA, referenceMA);
+}
+
+bool Calibration::fit() {
+    const float width = CALIBRATION_RANGE_MA / CALIBRATION_SEGMENTS;
+    if (!solveSegment(global, 2, CALIBRATION_RANGE_MA)) {
+        Serial.println("Calibration: not enough distinct samples to fit");
+        return false;
+    }
+
+    for (int i = 0; i < CALIBRATION_SEGMENTS; i++) {
+        solveSegment(segments[i], CALIBRATION_MIN_SAMPLES, width);
+    }
+    buildKnots();
+
+    Serial.print("Calibration fitted: gain=");
+    Serial.print(global.gain, 4);
+    Serial.print(" offset=");
+    Serial.print(global.offset, 3);
+    Serial.println(" mA");
+
+    return save();
+}
+
+void Calibration::reset() {
+    clearSegment(global);
+    for (int i = 0; i < CALIBRATION_SEGMENTS; i++) {
+        clearSegment(segments[i]);
+    }
+    buildKnots();
+
+    prefs.begin("calibration", false);
+    prefs.remove("model");
+    prefs.end();
+
+    Serial.println("Calibration reset");
+}
+
+float Calibration::apply(float rawMA) {
+    // Linear between the boundary values of the raw reading's segment; the outer
+    // segments extrapolate their chord. Without a fit the reading passes through.
+    if (!global.fitted) return rawMA;
+
+    const float width = CALIBRATION_RANGE_MA / CALIBRATION_SEGMENTS;
+    int index = segmentFor(rawMA);
+    float t = (rawMA - index * width) / width;
+    float corrected = knots[index] + t * (knots[index + 1] - knots[index]);
+
+    return corrected < 0.0 ? 0.0 : corrected;
+}
+
+bool Calibration::isFitted() {
+    return global.fitted;
+}
+
+uint32_t Calibration::getSampleCount() {
+    return global.count;
+}
+
+String Calibration::getJson() {
+    String json = "{";
+    json += "\"fitted\":" + String(global.fitted ? "true" : "false") + ",";
+    json += "\"samples\":" + String(global.count) + ",";
+    json += "\"gain\":" + String(global.gain, 5) + ",";
+    json += "\"offset\":" + String(global.offset, 3) + ",";
+    json += "\"segments\":[";
+    for (int i = 0; i < CALIBRATION_SEGMENTS; i++) {
+        if (i > 0) json += ",";
+        json += "{\"samples\":" + String(segments[i].count);
+        json += ",\"fitted\":" + String(segments[i].fitted ? "true" : "false");
+        json += ",\"gain\":" + String(segments[i].gain, 5);
+        json += ",\"offset\":" + String(segments[i].offset, 3) + "}";
+    }
+    json += "],\"knots\":[";
+    for (int i = 0; i <= CALIBRATION_SEGMENTS; i++) {
+        if (i > 0) json += ",";
+        json += String(knots[i], 3);
+    }
+    json += "]}";
+    return json;
+}
+
+int Calibration::segmentFor(float rawMA) {
+    // Equal-width segments over 0..CALIBRATION_RANGE_MA, outer ones open-ended
+    int index = (int)(rawMA / (CALIBRATION_RANGE_MA / CALIBRATION_SEGMENTS));
+    if (index < 0) index = 0;
+    if (index >= CALIBRATION_SEGMENTS) index = CALIBRATION_SEGMENTS - 1;
+    return index;
+}
+
+void Calibration::clearSegment(CalibrationSegment& segment) {
+    segment.count = 0;
+    segment.meanX = 0.0;
+    segment.meanY = 0.0;
+    segment.m2X = 0.0;
+    segment.cXY = 0.0;
+    segment.gain = 1.0;
+    segment.offset = 0.0;
+    segment.fitted = false;
+}
+
+void Calibration::updateSegment(CalibrationSegment& segment, float x, float y) {
+    // Welford update of means and (co)variances, numerically stable in O(1)
+    segment.count++;
+    double dx = x - segment.meanX;
+    segment.meanX += dx / segment.count;
+    segment.meanY += (y - segment.meanY) / segment.count;
+    segment.m2X += dx * (x - segment.meanX);
+    segment.cXY += dx * (y - segment.meanY);
+}
+
+bool Calibration::solveSegment(CalibrationSegment& segment, uint32_t minSamples, float width) {
+    // Least squares: gain = cov(x,y) / var(x), offset = meanY - gain * meanX.
+    // The raw samples must spread over part of the segment, otherwise the gain
+    // is an extrapolation from one operating point.
+    float minSpread = CALIBRATION_MIN_SPREAD * width;
+    if (segment.count < minSamples || segment.m2X < segment.count * minSpread * minSpread) {
+        segment.fitted = false;
+        return false;
+    }
+
+    segment.gain = segment.cXY / segment.m2X;
+    segment.offset = segment.meanY - segment.gain * segment.meanX;
+    segment.fitted = true;
+    return true;
+}
+
+void Calibration::buildKnots() {
+    // Boundary values: each segment's line (global line where it has no fit),
+    // averaged where two segments meet so the model has no steps
+    const float width = CALIBRATION_RANGE_MA / CALIBRATION_SEGMENTS;
+    for (int i = 0; i <= CALIBRATION_SEGMENTS; i++) {
+        float x = i * width;
+        float sum = 0.0;
+        int lines = 0;
+        for (int s = i - 1; s <= i; s++) {
+            if (s < 0 || s >= CALIBRATION_SEGMENTS) continue;
+            const CalibrationSegment& line = segments[s].fitted ? segments[s] : global;
+            sum += line.gain * x + line.offset;
+            lines++;
+        }
+        knots[i] = sum / lines;
+    }
+}
+
+bool Calibration::save() {
+    CalibrationBlob blob;
+    blob.version = CALIBRATION_VERSION;
+    blob.global = global;
+    for (int i = 0; i <= CALIBRATION_SEGMENTS; i++) {
+        if (i < CALIBRATION_SEGMENTS) blob.segments[i] = segments[i];
+        blob.knots[i] = knots[i];
+    }
+
+    prefs.begin("calibration", false);
+    bool ok = prefs.putBytes("model", &blob, sizeof(blob)) == sizeof(blob);
+    prefs.end();
+
+    if (!ok) {
+        Serial.println("Calibration: saving to NVS failed");
+    }
+    return ok;
+}
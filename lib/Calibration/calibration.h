@@ -0,0 +1,50 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+// Running least-squares state of one line segment (constant memory)
+struct CalibrationSegment {
+    uint32_t count;   // Number of samples
+    double meanX;     // Mean raw current (mA)
+    double meanY;     // Mean reference current (simulated mA)
+    double m2X;       // Sum of squared deviations of x
+    double cXY;       // Sum of co-deviations of x and y
+    float gain;       // Fitted gain
+    float offset;     // Fitted offset (mA)
+    bool fitted;      // Gain/offset valid
+};
+
+class Calibration {
+public:
+    Calibration();
+    bool begin();  // Load persisted model from NVS
+
+    // Sample collection and fitting
+    void addSample(float rawMA, float referenceMA);
+    bool fit();    // Solve all segments and persist the model
+    void reset();  // Drop samples and model (also in NVS)
+
+    // Sampling path
+    float apply(float rawMA);  // Raw INA219 mA -> reference (simulated) mA, continuous over all segments
+    bool isFitted();
+    uint32_t getSampleCount();
+    String getJson();
+
+private:
+    CalibrationSegment global;
+    CalibrationSegment segments[CALIBRATION_SEGMENTS];
+    float knots[CALIBRATION_SEGMENTS + 1];  // Model value at each segment boundary
+    Preferences prefs;
+
+    int segmentFor(float rawMA);
+    void clearSegment(CalibrationSegment& segment);
+    void updateSegment(CalibrationSegment& segment, float x, float y);
+    bool solveSegment(CalibrationSegment& segment, uint32_t minSamples, float width);
+    void buildKnots();
+    bool save();
+};
+
+#endif // CALIBRATION_H
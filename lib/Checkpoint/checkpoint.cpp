@@ -0,0 +1,141 @@
+#include "checkpoint.h"
+#include <esp_rom_crc.h>
+
+// NVS layout version, bump when SimulationState changes
+#define CHECKPOINT_VERSION 1
+
+static const char* SLOT_KEYS[2] = {"slot0", "slot1"};
+
+struct CheckpointBlob {
+    uint16_t version;
+    uint16_t length;     // sizeof(SimulationState), differs between build variants
+    uint32_t sequence;   // Newer checkpoints have higher numbers
+    uint32_t crc;        // CRC32 of sequence and state
+    SimulationState state;
+};
+
+static uint32_t blobCrc(const CheckpointBlob& blob) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&blob.sequence, sizeof(blob.sequence));
+    return esp_rom_crc32_le(crc, (const uint8_t*)&blob.state, sizeof(blob.state));
+}
+
+// State without the run time, which differs on every call
+static uint32_t stateCrc(SimulationState state) {
+    state.elapsedMs = 0;
+    return esp_rom_crc32_le(0, (const uint8_t*)&state, sizeof(state));
+}
+
+Checkpoint::Checkpoint(Simulation* simulationRef)
+    : simulation(simulationRef), sequence(0), slot(-1), savedRunning(false), savedCrc(0), savedInterval(-1), failures(0) {
+}
+
+bool Checkpoint::readSlot(int index, SimulationState& state, uint32_t& slotSequence) {
+    CheckpointBlob blob;
+    size_t length = prefs.getBytesLength(SLOT_KEYS[index]);
+    if (length != sizeof(blob) || prefs.getBytes(SLOT_KEYS[index], &blob, sizeof(blob)) != sizeof(blob)) return false;
+    if (blob.version != CHECKPOINT_VERSION || blob.length != sizeof(SimulationState) || blob.crc != blobCrc(blob)) return false;
+    
+    state = blob.state;
+    slotSequence = blob.sequence;
+    return true;
+}
+
+bool Checkpoint::begin() {
+    uint32_t startUs = micros();
+    SimulationState states[2];
+    uint32_t sequences[2] = {0, 0};
+    bool valid[2];
+    
+    prefs.begin("checkpoint", true);
+    valid[0] = readSlot(0, states[0], sequences[0]);
+    valid[1] = readSlot(1, states[1], sequences[1]);
+    prefs.end();
+    
+    // Newest slot that passes the CRC; a torn write only ever damages one
+    if (valid[0] && valid[1]) slot = (int32_t)(sequences[1] - sequences[0]) > 0 ? 1 : 0;
+    else if (valid[0] || valid[1]) slot = valid[0] ? 0 : 1;
+    else {
+        Serial.println("Checkpoint: none stored");
+        return false;
+    }
+    sequence = sequences[slot];
+    savedRunning = states[slot].running;
+    savedCrc = stateCrc(states[slot]);
+    if (!valid[1 - slot]) Serial.println("Checkpoint: one slot invalid, using the other");
+    
+    if (!savedRunning) {
+        Serial.println("Checkpoint: no run to resume");
+        return false;
+    }
+    
+    simulation->restoreState(states[slot]);
+    savedInterval = progressInterval();
+    
+    Serial.print("Checkpoint: resumed run at ");
+    Serial.print(states[slot].elapsedMs / 1000.0, 1);
+    Serial.print(" s (sequence ");
+    Serial.print(sequence);
+    Serial.print(") in ");
+    Serial.print(micros() - startUs);
+    Serial.println(" us");
+    return true;
+}
+
+int32_t Checkpoint::progressInterval() {
+    // Simulated hours since the run started in steps of CHECKPOINT_SIM_HOURS, doubled
+    // (up to a day) until the steps are CHECKPOINT_MIN_PERIOD of wall time apart
+    float msPerHour = simulation->getDurationSeconds() * 1000.0 / 24.0;
+    float hours = CHECKPOINT_SIM_HOURS;
+    while (hours < 24.0 && hours * msPerHour < CHECKPOINT_MIN_PERIOD) hours = min(hours * 2.0f, 24.0f);
+    return (int32_t)((simulation->getSimulationHour() - 6.0) / hours);
+}
+
+void Checkpoint::update() {
+    // Nothing changes while stopped; the stop itself is saved once so it is not resumed
+    bool running = simulation->isRunning();
+    if (!running) {
+        if (savedRunning) save();
+        savedInterval = -1;
+        return;
+    }
+    
+    // A new run (or a restart) checkpoints at once, then at every progress boundary
+    int32_t interval = progressInterval();
+    if (interval == savedInterval) return;
+    savedInterval = interval;
+    save();
+}
+
+bool Checkpoint::save() {
+    CheckpointBlob blob;
+    memset(&blob, 0, sizeof(blob));  // Padding is covered by the CRCs
+    blob.version = CHECKPOINT_VERSION;
+    blob.length = sizeof(SimulationState);
+    blob.sequence = sequence + 1;
+    simulation->saveState(blob.state);
+    
+    // The newest slot already holds this state, only the run time has moved on
+    uint32_t crc = stateCrc(blob.state);
+    if (slot >= 0 && crc == savedCrc) return true;
+    blob.crc = blobCrc(blob);
+    
+    // Always overwrite the older slot
+    int target = slot == 0 ? 1 : 0;
+    prefs.begin("checkpoint", false);
+    bool ok = prefs.putBytes(SLOT_KEYS[target], &blob, sizeof(blob)) == sizeof(blob);
+    prefs.end();
+    
+    if (!ok) {
+        failures++;
+        Serial.print("Checkpoint: saving to NVS failed (");
+        Serial.print(failures);
+        Serial.println(" failures)");
+        return false;
+    }
+    
+    slot = target;
+    sequence = blob.sequence;
+    savedRunning = blob.state.running;
+    savedCrc = crc;
+    return true;
+}
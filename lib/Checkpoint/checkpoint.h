@@ -0,0 +1,33 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "simulation.h"
+
+// Snapshots of the live run in NVS at simulated-progress boundaries, restored
+// on boot. Two slots are written alternately, each with a sequence number and
+// CRC32, so a power cut during a write leaves the previous checkpoint intact.
+class Checkpoint {
+public:
+    Checkpoint(Simulation* simulationRef);
+    bool begin();   // Restore the newest valid slot, true if a run was resumed
+    void update();  // Scheduler job: save at each progress interval while running
+    bool save();
+
+private:
+    Simulation* simulation;
+    Preferences prefs;
+    uint32_t sequence;      // Of the newest slot written or restored
+    int slot;               // Slot holding that sequence (-1 = none)
+    bool savedRunning;      // Run state in the newest slot
+    uint32_t savedCrc;      // stateCrc() of the newest slot
+    int32_t savedInterval;  // Progress interval last checkpointed (-1 = none this run)
+    uint32_t failures;
+
+    bool readSlot(int index, SimulationState& state, uint32_t& slotSequence);
+    int32_t progressInterval();
+};
+
+#endif // CHECKPOINT_H
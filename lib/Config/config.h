@@ -9,6 +9,53 @@
 #define OLED_ADDR 0x3C
 #define INA219_ADDR 0x40
 
+// INA219 Sampling (one burst per sensor job, consumers read the cached sample)
+#define INA_MAX_AGE 200                 // ms a cached sample may be old before the bus is read again
+
+// Boot Settings
+#define FAST_BOOT 1                     // Verify cached I2C map, skip settle delays
+#define BOOT_MAX_PHASES 12              // Logged boot phases
+#define WIFI_READY_TIMEOUT 5000         // ms to wait for the AP task
+#define WIFI_AP_MAX_STATIONS 4          // Clients on a standalone unit's AP
+
+// Fleet Settings (role via build_flags: -DFLEET_ROLE=FLEET_MEMBER / FLEET_HUB)
+#define FLEET_STANDALONE 0
+#define FLEET_MEMBER 1                  // Joins the hub's AP and sends telemetry
+#define FLEET_HUB 2                     // Collects and merges telemetry of all members
+#ifndef FLEET_ROLE
+#define FLEET_ROLE FLEET_STANDALONE
+#endif
+#define FLEET_PORT 4210                 // UDP telemetry port on the hub
+#define FLEET_HUB_SSID "Solar_Monitor_Hub"  // Distinct from standalone units, members never join one by mistake
+#define FLEET_HUB_PASSWORD "12345678"
+#define FLEET_HUB_IP IPAddress(192, 168, 4, 1)
+#define FLEET_HUB_MAX_STATIONS 10       // ESP-IDF soft-AP limit: at most 10 members (or 9 plus a browser) per hub
+#define FLEET_MAX_UNITS 16              // Members tracked by the hub (~4 KB each; above 10 only via benchmark/routed networks)
+#define FLEET_RING_SIZE 240             // Samples kept per member
+#define FLEET_SAMPLE_PERIOD 250         // ms between samples on a member
+#define FLEET_SAMPLES_PER_PACKET 4      // Samples batched into one datagram
+#define FLEET_UNIT_TIMEOUT 10000        // ms without packets before a member is offline
+#define FLEET_REJOIN_GAP 64             // Sequence jump back beyond this = member restarted
+#define FLEET_MAX_POINTS 240            // Site series points per request
+#define JOB_FLEET_PERIOD 20
+#define JOB_FLEET_BUDGET 3000
+
+// MQTT Settings (broker reachable from the unit's network, e.g. a laptop on the AP)
+#ifndef MQTT_ENABLED
+#define MQTT_ENABLED 0
+#endif
+#define MQTT_BROKER "192.168.4.2"
+#define MQTT_PORT 1883
+#define MQTT_TOPIC_PREFIX "solar_monitor/"  // + unit id + "/telemetry"
+#define MQTT_SAMPLE_PERIOD 1000         // ms between queued samples
+#define MQTT_BATCH_SIZE 10              // Samples per message
+#define MQTT_QUEUE_SIZE 360             // Offline queue (6 min at 1 s), oldest dropped when full
+#define MQTT_PAYLOAD_MAX 1536           // Encode buffer and client packet size
+#define MQTT_RECONNECT_MIN 1000         // ms, doubled after every failed attempt
+#define MQTT_RECONNECT_MAX 30000
+#define MQTT_DRAIN_INTERVAL 20          // ms between messages while catching up
+#define JOB_MQTT_BUDGET 500
+
 // OLED Display Settings
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
@@ -19,10 +66,160 @@
 #define TRANSISTOR_3 17
 #define TRANSISTOR_4 18
 
+// Main Loop Scheduler (period in ms, budget in µs)
+#define SCHEDULER_MAX_JOBS 12
+#define JOB_WEB_PERIOD 10
+#define JOB_WEB_BUDGET 20000
+#define JOB_SIMULATION_PERIOD 20
+#define JOB_SIMULATION_BUDGET 2000
+#define JOB_SENSOR_PERIOD 100
+#define JOB_SENSOR_BUDGET 3000
+#define JOB_DISPLAY_PERIOD 250
+#define JOB_DISPLAY_BUDGET 100000
+#define JOB_HOUSEKEEPING_PERIOD 10000
+#define JOB_HOUSEKEEPING_BUDGET 5000
+
+// History Settings (live run, downsampled on the device for the charts)
+#define HISTORY_SAMPLE_PERIOD 250       // ms between recorded points
+#define HISTORY_BLOCK_SIZE 512          // Bytes per compressed block (at most EXPORT_BUFFER_SIZE - 12)
+#define HISTORY_BLOCKS 2560             // Blocks in PSRAM (1.25 MB, ~5.6 B per point: ~16 h at 250 ms)
+#define HISTORY_BLOCKS_INTERNAL 64      // Fallback without PSRAM
+#define HISTORY_BLOCK_MAX_POINTS 160    // Per block, bounds the decode cache (3.2 KB per block)
+#define HISTORY_CACHE_BLOCKS 6          // Decoded blocks kept for queries (LTTB spans about four)
+#define HISTORY_LTTB_CARRY 256          // Next-bucket points LTTB keeps for its candidate scan (2 KB x 2)
+#define HISTORY_MANTISSA_BITS 12        // Float precision kept (of 23), 1e-4 relative
+#define HISTORY_TIME_UNITS 36000        // Simulated time resolution, steps per hour (0.1 s)
+#define HISTORY_BENCH_POINTS 20000      // Default points for /history/benchmark
+#define HISTORY_BENCH_MAX_POINTS 200000 // Upper limit per benchmark request
+#define HISTORY_MAX_POINTS 2000         // Points per query (chart pixels)
+#define JOB_HISTORY_BUDGET 200
+
+// Measurement Rollups (INA samples reduced to 1 s / 1 min / 1 h buckets, 48 B each)
+#define ROLLUP_SECONDS 3600             // 1 s buckets kept (1 h)
+#define ROLLUP_MINUTES 10080            // 1 min buckets kept (7 days)
+#define ROLLUP_HOURS 2208               // 1 h buckets kept (92 days), ~760 kB PSRAM in total
+#define ROLLUP_SECONDS_INTERNAL 120     // Fallback without PSRAM
+#define ROLLUP_MINUTES_INTERNAL 120
+#define ROLLUP_HOURS_INTERNAL 168
+#define ROLLUP_MAX_GAP_MS 1000          // Longer gaps between samples add no energy
+#define ROLLUP_MAX_POINTS 2000          // Buckets per query
+
+// Anomaly Detection (EWMA baseline + CUSUM per signal, checked every sensor sample)
+#define ANOMALY_EWMA_ALPHA 0.02         // Baseline weight of a new sample
+#define ANOMALY_CUSUM_K 0.5             // Slack per sample, in baseline standard deviations
+#define ANOMALY_CUSUM_H 8.0             // Alarm threshold of the accumulated deviation
+#define ANOMALY_SIGMA_FLOOR 0.02        // Minimum standard deviation, fraction of the baseline
+#define ANOMALY_WARMUP 50               // Samples before a signal can alarm
+#define ANOMALY_IDLE_CURRENT 5.0        // mA: "no current" below, leakage above with all panels off
+#define ANOMALY_SETTLE_SAMPLES 3        // Samples skipped after panel switching
+#define ANOMALY_MISMATCH 0.25           // Allowed deviation from the expected current after switching
+#define ANOMALY_EVENT_RING 64           // Events kept for /events
+#define ANOMALY_BENCH_MAX_SAMPLES 1000000  // Upper limit per /events/benchmark request
+
+// Scenario Jobs (batch runs queued over the API, worked off in the background)
+#define SCENARIO_QUEUE_SIZE 48          // Queued + finished jobs kept (~330 B each, PSRAM)
+#define SCENARIO_WORKER_STACK 12288
+#define SCENARIO_WORKER_PRIORITY 0      // Below the loop task: runs while the scheduler idles
+
+// Checkpoint Settings (live run state in NVS, two CRC-checked slots)
+#define CHECKPOINT_SIM_HOURS 1.0       // Simulated hours between snapshots of a live run
+#define CHECKPOINT_MIN_PERIOD 10000     // ms; fast runs snapshot every few simulated hours instead
+#define JOB_CHECKPOINT_PERIOD 1000      // Job only checks the run progress, writes are rare
+#define JOB_CHECKPOINT_BUDGET 30000     // One NVS blob write (~1 kB)
+
+// Transistor Switching Schedule
+#define TRANSISTOR_SCHEDULE_SIZE 32     // Max. timed switching events
+#define TRANSISTOR_SCHEDULE_MAX_S 3600  // Latest event offset (s), keeps µs offsets in 32 bits
+
 // WiFi Access Point Settings
 #define DEFAULT_AP_IP IPAddress(192, 168, 4, 1)
 
+// Web Server Settings (per-request arena, released after every response)
+#define REQUEST_ARENA_SIZE 2048         // Scratch bytes per request
+#define WEB_MAX_ROUTES 64               // Routes tracked in /system/heap
+#define SIM_DATA_JSON_SIZE 768          // /simulation/data reply, formatted into the arena
+
 // Simulation Settings
 #define DEFAULT_CURRENT_MULTIPLIER 600.0
 
+// Simulation Sizing (per hardware variant, override via build_flags)
+#ifndef SIM_PANELS
+#define SIM_PANELS 4                    // Simulated panels (1-4 switch real hardware)
+#endif
+#ifndef SIM_CELLS
+#define SIM_CELLS 4                     // Battery cells, 5 kWh each
+#endif
+#ifndef SIM_LOADS
+#define SIM_LOADS 6                     // Entries in the load table (must match LOAD_TABLE)
+#endif
+#define SIM_MAX_DAY_STEPS 1440          // Whole-day kernel buffer length (1-minute steps)
+
+// Load Optimizer (dynamic program over hour x SoC bucket x job progress)
+#define OPTIMIZER_HOURS 24              // Planning horizon, one slot per hour like the load schedule
+#define OPTIMIZER_SOC_BUCKETS 51        // Battery SoC grid (2% steps)
+#define OPTIMIZER_MAX_JOBS 4            // Deferrable appliance runs per day
+#define OPTIMIZER_MAX_JOB_STATES 16     // Product of (hours + 1) over all jobs
+
+// Site Settings (sun model)
+#define SITE_LATITUDE 48.78             // Degrees north (Stuttgart), negative = south
+
+// Panel Datasheet (one simulated panel = a string of 6 x 60-cell modules, STC)
+#define PANEL_PEAK_POWER 2500.0         // W per panel at 1000 W/m² and 25 °C
+#define PANEL_NOMINAL_VOLTAGE 190.0     // V at the maximum power point
+#define PANEL_VOC 230.0                 // Open-circuit voltage, V
+#define PANEL_ISC 14.0                  // Short-circuit current, A
+#define PANEL_VMP PANEL_NOMINAL_VOLTAGE
+#define PANEL_IMP (PANEL_PEAK_POWER / PANEL_NOMINAL_VOLTAGE)
+#define PANEL_CELLS_SERIES 360
+#define PANEL_TEMP_COEFF_VOC -0.0029    // Voc change per °C, fraction of Voc
+#define PANEL_TEMP_COEFF_ISC 0.0005     // Isc change per °C, fraction of Isc
+#define PANEL_NOCT 45.0                 // Cell temperature at 800 W/m², 20 °C ambient
+
+// PV Model (single diode, MPP tabulated over irradiance x cell temperature)
+#define PV_IDEALITY 1.3                 // Diode ideality factor
+#define PV_NEWTON_MAX_ITERATIONS 12
+#define PV_NEWTON_TOLERANCE 0.01        // V (the power curve is flat at the MPP)
+#define PV_TABLE_IRRADIANCES 25         // 0-1200 W/m²
+#define PV_TABLE_IRRADIANCE_STEP 50.0
+#define PV_TABLE_TEMPERATURES 21        // -20-80 °C
+#define PV_TABLE_TEMPERATURE_MIN -20.0
+#define PV_TABLE_TEMPERATURE_STEP 5.0
+#define PV_MPPT_EFFICIENCY 0.99         // Tracking efficiency of the charge controller
+#define PV_AMBIENT_TEMPERATURE 25.0     // °C for sun-model runs (no weather data)
+
+// Panel Array Settings (per-panel model, strings in series, strings in parallel)
+#define PANEL_ARRAY_MAX 10000           // Panels (about 30 bytes each, PSRAM)
+#define PANEL_ARRAY_MAX_STRING 64       // Panels in series per string
+#define PANEL_ARRAY_TILT_WEIGHT 0.5     // Share of irradiance that follows the panel azimuth
+#define PANEL_ARRAY_DEGRADED 0.8        // Output of a degraded panel
+#define PANEL_ARRAY_BENCH_STEPS 24      // Steps per size in /simulation/array/benchmark
+#define PANEL_ARRAY_BENCH_STRING 20     // Panels per string in the benchmark
+
+// Irradiance Dataset Settings
+#define DATASET_IRRADIANCE_LSB 6.0      // W/m² per stored step (uint8, max 1530 W/m²)
+#define DATASET_TEMPERATURE_LSB 0.5     // °C per stored step (int8, -64..63.5 °C)
+#define DATASET_BUFFER_RECORDS 256      // Records per buffered flash read/write
+
+// Export Settings
+#define EXPORT_BUFFER_SIZE 1460         // Bytes per chunk (one TCP segment)
+#define EXPORT_ROW_MAX 192              // Flush before a row could overflow the buffer
+
+// Long Requests (batch runs, exports and benchmarks let the other jobs run between chunks)
+#define SIM_BENCH_MAX_DAYS 31           // Upper limit for /simulation/benchmark (both runs)
+
+// Tariff Settings (flat default, overridden by /tariff.csv)
+#define TARIFF_IMPORT_ZAR 3.50          // Per kWh drawn from grid
+#define TARIFF_IMPORT_EUR 0.20
+#define TARIFF_EXPORT_ZAR 1.17          // Per kWh fed into grid
+#define TARIFF_EXPORT_EUR 0.06
+#define TARIFF_SLOTS_PER_DAY 48         // Lookup resolution (30 min)
+#define TARIFF_MAX_RATES 16             // Distinct rate entries
+#define TARIFF_DEFAULT_MONTH 3          // Month (1-12) used for the fixed 12 h day
+
+// Calibration Settings
+#define CALIBRATION_SEGMENTS 4          // Piecewise segments (1 = single gain/offset)
+#define CALIBRATION_RANGE_MA 400.0      // Raw INA219 current covered by the segments
+#define CALIBRATION_MIN_SAMPLES 3       // Samples needed before a segment is fitted
+#define CALIBRATION_MIN_SPREAD 0.05     // Raw std dev needed for a fit, as a fraction of the segment width
+
 #endif // CONFIG_H
@@ -0,0 +1,421 @@
+#include "fleet_hub.h"
+#include "psram_alloc.h"
+
+// Large tables go to PSRAM when fitted
+static void* allocateTable(size_t bytes) {
+    void* table = allocateLarge(bytes);
+    if (table != nullptr) memset(table, 0, bytes);
+    return table;
+}
+
+FleetHub::FleetHub()
+    : units(nullptr), heap(nullptr), held(nullptr), capacity(0), unitCount(0), listening(false), rejected(0) {
+}
+
+FleetHub::~FleetHub() {
+    free(units);
+    free(heap);
+    free(held);
+}
+
+bool FleetHub::begin(int maxUnits, bool listen) {
+    units = (FleetUnit*)allocateTable(maxUnits * sizeof(FleetUnit));
+    heap = (HeapEntry*)allocateTable(maxUnits * sizeof(HeapEntry));
+    held = (const FleetSample**)allocateTable(maxUnits * sizeof(const FleetSample*));
+    if (units == nullptr || heap == nullptr || held == nullptr) {
+        Serial.println("Fleet hub: out of memory");
+        return false;
+    }
+    capacity = maxUnits;
+
+    if (listen) {
+        listening = udp.begin(FLEET_PORT);
+        Serial.print("Fleet hub listening on UDP ");
+        Serial.println(FLEET_PORT);
+    }
+    return true;
+}
+
+bool FleetHub::isActive() {
+    return units != nullptr;
+}
+
+int FleetHub::getUnitCount() {
+    return unitCount;
+}
+
+const FleetUnit* FleetHub::getUnit(int index) {
+    return index >= 0 && index < unitCount ? &units[index] : nullptr;
+}
+
+void FleetHub::poll() {
+    if (!listening) return;
+
+    // Bounded per call so a burst cannot starve the web job
+    uint8_t buffer[sizeof(FleetPacketHeader) + 16 * sizeof(FleetSample)];
+    for (int i = 0; i < 16; i++) {
+        if (udp.parsePacket() <= 0) break;
+        int length = udp.read(buffer, sizeof(buffer));
+        if (length > 0) ingest(buffer, length, (uint32_t)udp.remoteIP(), millis());
+    }
+}
+
+bool FleetHub::ingest(const uint8_t* data, size_t length, uint32_t address, uint32_t nowMs) {
+    FleetPacketHeader header;
+    if (units == nullptr || length < sizeof(header)) {
+        rejected++;
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != FLEET_MAGIC || header.version != FLEET_VERSION || header.count == 0 ||
+        length < sizeof(header) + header.count * sizeof(FleetSample)) {
+        rejected++;
+        return false;
+    }
+
+    FleetUnit* unit = findUnit(header.unitId, nowMs);
+    if (unit == nullptr) {
+        rejected++;
+        return false;
+    }
+
+    if (unit->packets > 0) {
+        // A rebooted member restarts its sequence and millis() at 0: start over
+        // instead of dropping it as old datagrams against a stale clock offset
+        int32_t gap = (int32_t)(header.sequence - unit->lastSequence);
+        if (gap < -FLEET_REJOIN_GAP || nowMs - unit->lastSeenMs > FLEET_UNIT_TIMEOUT) {
+            unit->packets = 0;
+            unit->clockOffset = 0;
+            unit->head = 0;
+            unit->count = 0;
+            unit->rejoins++;
+            Serial.print("Fleet member rejoined: ");
+            Serial.println(unit->id, HEX);
+        } else if (gap <= 0) {
+            return false;  // Duplicate or reordered datagram
+        } else {
+            unit->lost += gap - 1;
+        }
+    }
+
+    // Clock offset from the newest sample, which was taken just before sending.
+    // Transit delay only inflates the estimate, so the smallest one wins; upward
+    // drift of the member clock is followed slowly.
+    const uint8_t* payload = data + sizeof(header);
+    FleetSample sample;
+    memcpy(&sample, payload + (header.count - 1) * sizeof(FleetSample), sizeof(sample));
+    int32_t estimate = (int32_t)(nowMs - sample.timeMs);
+    if (unit->packets == 0 || estimate < unit->clockOffset) {
+        unit->clockOffset = estimate;
+    } else {
+        unit->clockOffset += (estimate - unit->clockOffset) / 64;
+    }
+
+    for (int i = 0; i < header.count; i++) {
+        memcpy(&sample, payload + i * sizeof(FleetSample), sizeof(sample));
+        sample.timeMs += unit->clockOffset;
+
+        // Keep each ring strictly ascending for the merge
+        if (unit->count > 0 && (int32_t)(sample.timeMs - sampleAt(*unit, unit->count - 1).timeMs) <= 0) continue;
+
+        unit->ring[unit->head] = sample;
+        unit->head = (unit->head + 1) % FLEET_RING_SIZE;
+        if (unit->count < FLEET_RING_SIZE) unit->count++;
+    }
+
+    unit->address = address;
+    unit->lastSequence = header.sequence;
+    unit->lastSeenMs = nowMs;
+    unit->packets++;
+    return true;
+}
+
+FleetUnit* FleetHub::findUnit(uint32_t id, uint32_t nowMs) {
+    for (int i = 0; i < unitCount; i++) {
+        if (units[i].id == id) return &units[i];
+    }
+
+    // New member: free slot, otherwise the longest offline one
+    int slot = -1;
+    if (unitCount < capacity) {
+        slot = unitCount++;
+    } else {
+        uint32_t oldestAge = FLEET_UNIT_TIMEOUT;
+        for (int i = 0; i < unitCount; i++) {
+            uint32_t age = nowMs - units[i].lastSeenMs;
+            if (age > oldestAge) {
+                oldestAge = age;
+                slot = i;
+            }
+        }
+        if (slot < 0) return nullptr;
+    }
+
+    FleetUnit& unit = units[slot];
+    memset(&unit, 0, sizeof(unit));
+    unit.id = id;
+
+    Serial.print("Fleet member joined: ");
+    Serial.println(id, HEX);
+    return &unit;
+}
+
+const FleetSample& FleetHub::sampleAt(const FleetUnit& unit, int position) {
+    int oldest = (unit.head + FLEET_RING_SIZE - unit.count) % FLEET_RING_SIZE;
+    return unit.ring[(oldest + position) % FLEET_RING_SIZE];
+}
+
+int FleetHub::firstAtOrAfter(const FleetUnit& unit, uint32_t timeMs) {
+    // Binary search over the ascending ring
+    int low = 0;
+    int high = unit.count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if ((int32_t)(sampleAt(unit, middle).timeMs - timeMs) < 0) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+void FleetHub::siftDown(int size, int index) {
+    while (true) {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if (left < size && (int32_t)(heap[left].timeMs - heap[smallest].timeMs) < 0) smallest = left;
+        if (right < size && (int32_t)(heap[right].timeMs - heap[smallest].timeMs) < 0) smallest = right;
+        if (smallest == index) return;
+
+        HeapEntry swap = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = swap;
+        index = smallest;
+    }
+}
+
+void FleetHub::siftUp(int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if ((int32_t)(heap[index].timeMs - heap[parent].timeMs) >= 0) return;
+
+        HeapEntry swap = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = swap;
+        index = parent;
+    }
+}
+
+int FleetHub::merge(uint32_t fromMs, uint32_t bucketMs, FleetPoint* out, int maxPoints) {
+    if (units == nullptr || bucketMs == 0 || maxPoints <= 0) return 0;
+
+    // Site sums are updated per sample: each member contributes its latest
+    // sample, held until its next one arrives
+    float generated = 0.0;
+    float load = 0.0;
+    float battery = 0.0;
+    int contributing = 0;
+    int size = 0;
+
+    for (int u = 0; u < unitCount; u++) {
+        const FleetUnit& unit = units[u];
+        held[u] = nullptr;
+        if (unit.count == 0) continue;
+
+        int position = firstAtOrAfter(unit, fromMs);
+        if (position > 0) {
+            // Value in force at fromMs
+            held[u] = &sampleAt(unit, position - 1);
+            generated += held[u]->powerGenerated;
+            load += held[u]->powerLoad;
+            battery += held[u]->batteryLevel;
+            contributing++;
+        }
+        if (position < unit.count) {
+            heap[size].timeMs = sampleAt(unit, position).timeMs;
+            heap[size].unit = u;
+            heap[size].position = position;
+            siftUp(size++);
+        }
+    }
+
+    int points = 0;
+    uint32_t bucketStart = fromMs;
+
+    auto emit = [&]() {
+        FleetPoint& point = out[points++];
+        point.timeMs = bucketStart;
+        point.powerGenerated = generated;
+        point.powerLoad = load;
+        point.batteryLevel = contributing > 0 ? battery / contributing : 0.0;
+        point.units = contributing;
+    };
+
+    while (size > 0) {
+        HeapEntry top = heap[0];
+
+        // Close every bucket that ends before the next sample
+        while ((int32_t)(top.timeMs - (bucketStart + bucketMs)) >= 0) {
+            if (contributing > 0) {
+                emit();
+                if (points == maxPoints) return points;
+                bucketStart += bucketMs;
+            } else {
+                bucketStart += (top.timeMs - bucketStart) / bucketMs * bucketMs;  // Skip the empty gap
+            }
+        }
+
+        const FleetUnit& unit = units[top.unit];
+        const FleetSample& sample = sampleAt(unit, top.position);
+        if (held[top.unit] != nullptr) {
+            generated -= held[top.unit]->powerGenerated;
+            load -= held[top.unit]->powerLoad;
+            battery -= held[top.unit]->batteryLevel;
+        } else {
+            contributing++;
+        }
+        generated += sample.powerGenerated;
+        load += sample.powerLoad;
+        battery += sample.batteryLevel;
+        held[top.unit] = &sample;
+
+        // Replace the top with this member's next sample, or drop it
+        if (top.position + 1 < unit.count) {
+            heap[0].position = top.position + 1;
+            heap[0].timeMs = sampleAt(unit, top.position + 1).timeMs;
+        } else {
+            heap[0] = heap[--size];
+        }
+        siftDown(size, 0);
+    }
+
+    if (contributing > 0 && points < maxPoints) emit();  // Current, still open bucket
+    return points;
+}
+
+String FleetHub::getJson() {
+    uint32_t now = millis();
+    float generated = 0.0;
+    float load = 0.0;
+    float battery = 0.0;
+    int online = 0;
+
+    String json = "{\"active\":" + String(units != nullptr ? "true" : "false") + ",";
+    json += "\"rejected\":" + String(rejected) + ",";
+    json += "\"units\":[";
+    for (int i = 0; i < unitCount; i++) {
+        const FleetUnit& unit = units[i];
+        bool isOnline = now - unit.lastSeenMs < FLEET_UNIT_TIMEOUT;
+        if (i > 0) json += ",";
+        json += "{\"id\":\"" + String(unit.id, HEX) + "\"";
+        json += ",\"ip\":\"" + String(unit.address & 0xFF) + "." + String((unit.address >> 8) & 0xFF) + "." +
+                String((unit.address >> 16) & 0xFF) + "." + String(unit.address >> 24) + "\"";
+        json += ",\"online\":" + String(isOnline ? "true" : "false");
+        json += ",\"packets\":" + String(unit.packets);
+        json += ",\"lost\":" + String(unit.lost);
+        json += ",\"rejoins\":" + String(unit.rejoins);
+        json += ",\"lastSeenMs\":" + String(now - unit.lastSeenMs);
+        json += ",\"clockOffset\":" + String(unit.clockOffset);
+
+        if (unit.count > 0) {
+            const FleetSample& latest = sampleAt(unit, unit.count - 1);
+            json += ",\"powerGenerated\":" + String(latest.powerGenerated, 1);
+            json += ",\"powerLoad\":" + String(latest.powerLoad, 1);
+            json += ",\"batteryLevel\":" + String(latest.batteryLevel, 1);
+            if (isOnline) {
+                generated += latest.powerGenerated;
+                load += latest.powerLoad;
+                battery += latest.batteryLevel;
+                online++;
+            }
+        }
+        json += "}";
+    }
+    json += "],\"site\":{";
+    json += "\"online\":" + String(online) + ",";
+    json += "\"powerGenerated\":" + String(generated, 1) + ",";
+    json += "\"powerLoad\":" + String(load, 1) + ",";
+    json += "\"batteryLevel\":" + String(online > 0 ? battery / online : 0.0, 1);
+    json += "}}";
+    return json;
+}
+
+String FleetHub::getSeriesJson(uint32_t bucketMs, int points) {
+    FleetPoint* series = (FleetPoint*)malloc(points * sizeof(FleetPoint));
+    if (series == nullptr) return "{\"error\":\"Out of memory\"}";
+
+    uint32_t now = millis();
+    uint32_t fromMs = now - points * bucketMs;
+    fromMs -= fromMs % bucketMs;  // Align buckets across requests
+    int count = merge(fromMs, bucketMs, series, points);
+
+    String json;
+    json.reserve(64 + count * 40);
+    json = "{\"bucketMs\":" + String(bucketMs) + ",\"now\":" + String(now) + ",\"t\":[";
+    for (int i = 0; i < count; i++) json += (i ? "," : "") + String(series[i].timeMs);
+    json += "],\"powerGenerated\":[";
+    for (int i = 0; i < count; i++) json += (i ? "," : "") + String(series[i].powerGenerated, 1);
+    json += "],\"powerLoad\":[";
+    for (int i = 0; i < count; i++) json += (i ? "," : "") + String(series[i].powerLoad, 1);
+    json += "],\"batteryLevel\":[";
+    for (int i = 0; i < count; i++) json += (i ? "," : "") + String(series[i].batteryLevel, 1);
+    json += "],\"units\":[";
+    for (int i = 0; i < count; i++) json += (i ? "," : "") + String(series[i].units);
+    json += "]}";
+
+    free(series);
+    return json;
+}
+
+String FleetHub::benchmark(int members, int packetsPerUnit, uint32_t bucketMs) {
+    // Synthetic members feeding a private hub: ingest rate and merge latency vs. N
+    FleetHub hub;
+    if (!hub.begin(members, false)) return "{\"error\":\"Out of memory\"}";
+
+    FleetPoint* series = (FleetPoint*)malloc(FLEET_MAX_POINTS * sizeof(FleetPoint));
+    if (series == nullptr) return "{\"error\":\"Out of memory\"}";
+
+    uint8_t packet[sizeof(FleetPacketHeader) + FLEET_SAMPLES_PER_PACKET * sizeof(FleetSample)];
+    FleetPacketHeader* header = (FleetPacketHeader*)packet;
+    FleetSample* samples = (FleetSample*)(packet + sizeof(FleetPacketHeader));
+    uint32_t packetMs = FLEET_SAMPLE_PERIOD * FLEET_SAMPLES_PER_PACKET;
+    uint32_t ingestUs = 0;
+
+    for (int p = 0; p < packetsPerUnit; p++) {
+        for (int u = 0; u < members; u++) {
+            // Every member has its own clock and phase
+            uint32_t memberStart = 1000 + u * 37;
+            header->magic = FLEET_MAGIC;
+            header->version = FLEET_VERSION;
+            header->count = FLEET_SAMPLES_PER_PACKET;
+            header->unitId = 0x1000 + u;
+            header->sequence = p;
+            for (int k = 0; k < FLEET_SAMPLES_PER_PACKET; k++) {
+                samples[k].timeMs = memberStart + p * packetMs + k * FLEET_SAMPLE_PERIOD;
+                samples[k].powerGenerated = 500.0 + u;
+                samples[k].powerLoad = 300.0 + p;
+                samples[k].batteryLevel = 50.0;
+            }
+            uint32_t arrivalMs = 100000 + p * packetMs + (u * 7) % 20;
+
+            uint32_t startUs = micros();
+            hub.ingest(packet, sizeof(packet), 0, arrivalMs);
+            ingestUs += micros() - startUs;
+        }
+    }
+
+    uint32_t startUs = micros();
+    uint32_t fromMs = 100000 + (packetsPerUnit * packetMs) - FLEET_MAX_POINTS * bucketMs;
+    int points = hub.merge(fromMs, bucketMs, series, FLEET_MAX_POINTS);
+    uint32_t mergeUs = micros() - startUs;
+    free(series);
+
+    uint32_t packets = members * packetsPerUnit;
+    String json = "{\"units\":" + String(members) + ",";
+    json += "\"packets\":" + String(packets) + ",";
+    json += "\"ingestUs\":" + String(ingestUs) + ",";
+    json += "\"packetsPerSecond\":" + String(ingestUs > 0 ? packets * 1000000.0 / ingestUs : 0.0, 0) + ",";
+    json += "\"points\":" + String(points) + ",";
+    json += "\"mergeUs\":" + String(mergeUs);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,77 @@
+#ifndef FLEET_HUB_H
+#define FLEET_HUB_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+#include "fleet_protocol.h"
+
+// Per-member state and sample ring (timestamps in hub time, ascending)
+struct FleetUnit {
+    uint32_t id;
+    uint32_t address;        // IPv4 of the last datagram
+    int32_t clockOffset;     // Hub millis() minus member millis()
+    uint32_t lastSequence;
+    uint32_t packets;
+    uint32_t lost;           // Sequence gaps
+    uint32_t rejoins;        // Restarts detected (sequence reset or long silence)
+    uint32_t lastSeenMs;
+    FleetSample ring[FLEET_RING_SIZE];
+    uint16_t head;           // Next write position
+    uint16_t count;
+};
+
+// One time-aligned point of the site series
+struct FleetPoint {
+    uint32_t timeMs;         // Bucket start (hub time)
+    float powerGenerated;    // Sum over members, W
+    float powerLoad;         // Sum over members, W
+    float batteryLevel;      // Mean over members, %
+    uint16_t units;          // Members contributing
+};
+
+// Hub side: ingests member datagrams and merges them into site-level series
+class FleetHub {
+public:
+    FleetHub();
+    ~FleetHub();
+    bool begin(int maxUnits = FLEET_MAX_UNITS, bool listen = true);
+    void poll();  // Drain pending datagrams (scheduler job)
+    bool ingest(const uint8_t* data, size_t length, uint32_t address, uint32_t nowMs);
+
+    // Streaming k-way merge of all member rings from fromMs on, one point per bucket
+    int merge(uint32_t fromMs, uint32_t bucketMs, FleetPoint* out, int maxPoints);
+
+    bool isActive();
+    int getUnitCount();
+    const FleetUnit* getUnit(int index);
+    String getJson();
+    String getSeriesJson(uint32_t bucketMs, int points);
+    static String benchmark(int members, int packetsPerUnit, uint32_t bucketMs);
+
+private:
+    // Merge heap entry: next unread sample of one member
+    struct HeapEntry {
+        uint32_t timeMs;
+        uint16_t unit;
+        uint16_t position;  // Logical ring index (0 = oldest)
+    };
+
+    FleetUnit* units;
+    HeapEntry* heap;
+    const FleetSample** held;  // Merge: sample each member currently contributes
+    int capacity;
+    int unitCount;
+    bool listening;
+    WiFiUDP udp;
+    uint32_t rejected;  // Malformed datagrams or no free unit slot
+
+    FleetUnit* findUnit(uint32_t id, uint32_t nowMs);
+    const FleetSample& sampleAt(const FleetUnit& unit, int position);
+    int firstAtOrAfter(const FleetUnit& unit, uint32_t timeMs);
+    void siftDown(int size, int index);
+    void siftUp(int index);
+};
+
+#endif // FLEET_HUB_H
@@ -0,0 +1,26 @@
+#ifndef FLEET_PROTOCOL_H
+#define FLEET_PROTOCOL_H
+
+#include <Arduino.h>
+
+// Telemetry datagram: header followed by `count` samples, little endian
+#define FLEET_MAGIC 0x5346  // "FS"
+#define FLEET_VERSION 1
+
+struct __attribute__((packed)) FleetPacketHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;       // Samples in this packet
+    uint32_t unitId;     // Lower 32 bits of the member's MAC
+    uint32_t sequence;   // Packet counter, used for loss statistics
+};
+
+// One sample; timeMs is the sender's millis(), converted to hub time on receipt
+struct __attribute__((packed)) FleetSample {
+    uint32_t timeMs;
+    float powerGenerated;  // W
+    float powerLoad;       // W
+    float batteryLevel;    // %
+};
+
+#endif // FLEET_PROTOCOL_H
@@ -0,0 +1,50 @@
+#include "fleet_reporter.h"
+
+FleetReporter::FleetReporter(Simulation* simulationRef)
+    : simulation(simulationRef), started(false), unitId(0), sequence(0), pending(0) {
+}
+
+void FleetReporter::begin(IPAddress hubIP) {
+    hub = hubIP;
+    unitId = (uint32_t)ESP.getEfuseMac();
+    started = true;
+
+    Serial.print("Fleet member ");
+    Serial.print(unitId, HEX);
+    Serial.print(" reporting to ");
+    Serial.println(hub);
+}
+
+void FleetReporter::update() {
+    if (!started) return;
+
+    // Batch samples; a datagram goes out every FLEET_SAMPLES_PER_PACKET samples
+    SimulationData data = simulation->getCurrentData();
+    FleetSample* samples = (FleetSample*)(packet + sizeof(FleetPacketHeader));
+    FleetSample& sample = samples[pending++];
+    sample.timeMs = millis();
+    sample.powerGenerated = data.powerGenerated;
+    sample.powerLoad = data.powerLoad;
+    sample.batteryLevel = data.batteryLevel;
+
+    if (pending < FLEET_SAMPLES_PER_PACKET) return;
+
+    // Not associated yet: drop the batch, live telemetry is not worth queueing
+    if (WiFi.status() == WL_CONNECTED) {
+        FleetPacketHeader* header = (FleetPacketHeader*)packet;
+        header->magic = FLEET_MAGIC;
+        header->version = FLEET_VERSION;
+        header->count = pending;
+        header->unitId = unitId;
+        header->sequence = sequence++;
+
+        udp.beginPacket(hub, FLEET_PORT);
+        udp.write(packet, sizeof(FleetPacketHeader) + pending * sizeof(FleetSample));
+        udp.endPacket();
+    }
+    pending = 0;
+}
+
+uint32_t FleetReporter::getSentPackets() {
+    return sequence;
+}
@@ -0,0 +1,31 @@
+#ifndef FLEET_REPORTER_H
+#define FLEET_REPORTER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+#include "fleet_protocol.h"
+#include "simulation.h"
+
+// Member side: samples the simulation and sends batched datagrams to the hub
+class FleetReporter {
+public:
+    FleetReporter(Simulation* simulationRef);
+    void begin(IPAddress hubIP);
+    void update();  // Called every FLEET_SAMPLE_PERIOD
+
+    uint32_t getSentPackets();
+
+private:
+    Simulation* simulation;
+    WiFiUDP udp;
+    IPAddress hub;
+    bool started;
+    uint32_t unitId;
+    uint32_t sequence;
+    uint8_t packet[sizeof(FleetPacketHeader) + FLEET_SAMPLES_PER_PACKET * sizeof(FleetSample)];
+    uint8_t pending;  // Samples in the packet buffer
+};
+
+#endif // FLEET_REPORTER_H
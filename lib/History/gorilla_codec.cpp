@@ -0,0 +1,249 @@
+#include "gorilla_codec.h"
+
+namespace {
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Two's complement field of `bits` width back to int32
+inline int32_t signExtend(uint32_t value, int bits) {
+    uint32_t sign = 1u << (bits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
+
+inline bool fits(int32_t value, int bits) {
+    return value >= -(1 << (bits - 1)) && value < (1 << (bits - 1));
+}
+
+}  // namespace
+
+GorillaEncoder::GorillaEncoder()
+    : data(nullptr), capacityBits(0), bitPosition(0), overflow(false), intCount(0), floatCount(0), roundMask(0), count(0) {
+}
+
+void GorillaEncoder::begin(uint8_t* block, size_t size, int intChannels, int floatChannels, int mantissaBits) {
+    data = block;
+    capacityBits = size * 8;
+    bitPosition = 0;
+    overflow = false;
+    intCount = min(intChannels, GORILLA_MAX_CHANNELS);
+    floatCount = min(floatChannels, GORILLA_MAX_CHANNELS);
+    int drop = 23 - constrain(mantissaBits, 1, 23);
+    roundMask = (1u << drop) - 1;
+    count = 0;
+    memset(data, 0, size);  // writeBits only sets bits
+}
+
+void GorillaEncoder::writeBits(uint32_t value, int bits) {
+    if (bitPosition + bits > capacityBits) {
+        overflow = true;
+        return;
+    }
+    while (bits > 0) {
+        int space = 8 - (bitPosition & 7);
+        int take = min(space, bits);
+        uint32_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+        data[bitPosition >> 3] |= chunk << (space - take);
+        bitPosition += take;
+        bits -= take;
+    }
+}
+
+void GorillaEncoder::encodeInt(int channel, uint32_t value) {
+    int32_t delta = (int32_t)(value - lastInt[channel]);
+    int32_t deltaOfDelta = delta - lastDelta[channel];
+    lastInt[channel] = value;
+    lastDelta[channel] = delta;
+    
+    if (deltaOfDelta == 0) {
+        writeBits(0, 1);
+    } else if (fits(deltaOfDelta, 7)) {
+        writeBits(0b10, 2);
+        writeBits((uint32_t)deltaOfDelta & 0x7F, 7);
+    } else if (fits(deltaOfDelta, 9)) {
+        writeBits(0b110, 3);
+        writeBits((uint32_t)deltaOfDelta & 0x1FF, 9);
+    } else if (fits(deltaOfDelta, 12)) {
+        writeBits(0b1110, 4);
+        writeBits((uint32_t)deltaOfDelta & 0xFFF, 12);
+    } else {
+        writeBits(0b1111, 4);
+        writeBits((uint32_t)deltaOfDelta, 32);
+    }
+}
+
+void GorillaEncoder::encodeFloat(int channel, uint32_t value) {
+    uint32_t x = value ^ lastFloat[channel];
+    lastFloat[channel] = value;
+    if (x == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    
+    int leading = min(__builtin_clz(x), 31);
+    int trailing = __builtin_ctz(x);
+    if (leading >= lastLeading[channel] && trailing >= lastTrailing[channel]) {
+        // Fits the previous window: no need to repeat its position
+        int length = 32 - lastLeading[channel] - lastTrailing[channel];
+        writeBits(0b10, 2);
+        writeBits(x >> lastTrailing[channel], length);
+        return;
+    }
+    
+    int length = 32 - leading - trailing;
+    writeBits(0b11, 2);
+    writeBits(leading, 5);
+    writeBits(length - 1, 5);
+    writeBits(x >> trailing, length);
+    lastLeading[channel] = leading;
+    lastTrailing[channel] = trailing;
+}
+
+bool GorillaEncoder::append(const uint32_t* ints, const float* floats) {
+    if (data == nullptr) return false;
+    
+    // Quantized floats: round to nearest, the carry may step into the exponent
+    uint32_t values[GORILLA_MAX_CHANNELS];
+    for (int c = 0; c < floatCount; c++) {
+        uint32_t bits = floatBits(floats[c]);
+        values[c] = roundMask != 0 ? (bits + (roundMask >> 1) + 1) & ~roundMask : bits;
+    }
+    
+    if (count == 0) {
+        for (int c = 0; c < intCount; c++) {
+            writeBits(ints[c], 32);
+            lastInt[c] = ints[c];
+            lastDelta[c] = 0;
+        }
+        for (int c = 0; c < floatCount; c++) {
+            writeBits(values[c], 32);
+            lastFloat[c] = values[c];
+            lastLeading[c] = 32;  // No window yet: the first change sends its own
+            lastTrailing[c] = 32;
+        }
+    } else {
+        // Keep the channel state to undo a record that does not fit
+        uint32_t savedPosition = bitPosition;
+        uint32_t savedInt[GORILLA_MAX_CHANNELS];
+        int32_t savedDelta[GORILLA_MAX_CHANNELS];
+        uint32_t savedFloat[GORILLA_MAX_CHANNELS];
+        uint8_t savedLeading[GORILLA_MAX_CHANNELS];
+        uint8_t savedTrailing[GORILLA_MAX_CHANNELS];
+        memcpy(savedInt, lastInt, sizeof(savedInt));
+        memcpy(savedDelta, lastDelta, sizeof(savedDelta));
+        memcpy(savedFloat, lastFloat, sizeof(savedFloat));
+        memcpy(savedLeading, lastLeading, sizeof(savedLeading));
+        memcpy(savedTrailing, lastTrailing, sizeof(savedTrailing));
+        
+        for (int c = 0; c < intCount; c++) encodeInt(c, ints[c]);
+        for (int c = 0; c < floatCount; c++) encodeFloat(c, values[c]);
+        
+        if (overflow) {
+            bitPosition = savedPosition;
+            memcpy(lastInt, savedInt, sizeof(savedInt));
+            memcpy(lastDelta, savedDelta, sizeof(savedDelta));
+            memcpy(lastFloat, savedFloat, sizeof(savedFloat));
+            memcpy(lastLeading, savedLeading, sizeof(savedLeading));
+            memcpy(lastTrailing, savedTrailing, sizeof(savedTrailing));
+        }
+    }
+    
+    if (overflow) return false;
+    count++;
+    return true;
+}
+
+int GorillaEncoder::getCount() {
+    return count;
+}
+
+uint32_t GorillaEncoder::getBits() {
+    return bitPosition;
+}
+
+size_t GorillaEncoder::getBytes() {
+    return (bitPosition + 7) / 8;
+}
+
+GorillaDecoder::GorillaDecoder()
+    : data(nullptr), endBits(0), bitPosition(0), intCount(0), floatCount(0), first(true) {
+}
+
+void GorillaDecoder::begin(const uint8_t* block, uint32_t bits, int intChannels, int floatChannels) {
+    data = block;
+    endBits = bits;
+    bitPosition = 0;
+    intCount = min(intChannels, GORILLA_MAX_CHANNELS);
+    floatCount = min(floatChannels, GORILLA_MAX_CHANNELS);
+    first = true;
+}
+
+uint32_t GorillaDecoder::readBits(int bits) {
+    uint32_t value = 0;
+    while (bits > 0) {
+        int available = 8 - (bitPosition & 7);
+        int take = min(available, bits);
+        uint32_t chunk = (data[bitPosition >> 3] >> (available - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        bitPosition += take;
+        bits -= take;
+    }
+    return value;
+}
+
+uint32_t GorillaDecoder::decodeInt(int channel) {
+    int32_t deltaOfDelta = 0;
+    if (readBits(1) != 0) {
+        if (readBits(1) == 0) deltaOfDelta = signExtend(readBits(7), 7);
+        else if (readBits(1) == 0) deltaOfDelta = signExtend(readBits(9), 9);
+        else if (readBits(1) == 0) deltaOfDelta = signExtend(readBits(12), 12);
+        else deltaOfDelta = (int32_t)readBits(32);
+    }
+    lastDelta[channel] += deltaOfDelta;
+    lastInt[channel] += (uint32_t)lastDelta[channel];
+    return lastInt[channel];
+}
+
+uint32_t GorillaDecoder::decodeFloat(int channel) {
+    if (readBits(1) == 0) return lastFloat[channel];
+    
+    if (readBits(1) != 0) {
+        lastLeading[channel] = readBits(5);
+        int length = readBits(5) + 1;
+        lastTrailing[channel] = 32 - lastLeading[channel] - length;
+    }
+    int length = 32 - lastLeading[channel] - lastTrailing[channel];
+    lastFloat[channel] ^= readBits(length) << lastTrailing[channel];
+    return lastFloat[channel];
+}
+
+bool GorillaDecoder::next(uint32_t* ints, float* floats) {
+    if (data == nullptr || bitPosition >= endBits) return false;
+    
+    if (first) {
+        for (int c = 0; c < intCount; c++) {
+            lastInt[c] = readBits(32);
+            lastDelta[c] = 0;
+            ints[c] = lastInt[c];
+        }
+        for (int c = 0; c < floatCount; c++) {
+            lastFloat[c] = readBits(32);
+            floats[c] = bitsFloat(lastFloat[c]);
+        }
+        first = false;
+        return true;
+    }
+    
+    for (int c = 0; c < intCount; c++) ints[c] = decodeInt(c);
+    for (int c = 0; c < floatCount; c++) floats[c] = bitsFloat(decodeFloat(c));
+    return true;
+}
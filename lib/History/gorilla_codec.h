@@ -0,0 +1,75 @@
+#ifndef GORILLA_CODEC_H
+#define GORILLA_CODEC_H
+
+#include <Arduino.h>
+
+#define GORILLA_MAX_CHANNELS 8
+
+// Gorilla-style time-series codec (Pelkonen et al., VLDB 2015) for fixed-size
+// blocks. Each record is a set of integer channels (timestamps, counters),
+// stored as delta-of-delta, and float channels, stored XORed with the previous
+// value of the channel:
+//   int:   '0' same delta | '10' + 7 bits | '110' + 9 bits | '1110' + 12 bits | '1111' + 32 bits
+//   float: '0' same value | '10' + bits in the previous window | '11' + 5 bits leading zeros
+//          + 5 bits length - 1 + meaningful bits
+// The first record of a block is stored raw, so every block decodes on its own.
+class GorillaEncoder {
+public:
+    GorillaEncoder();
+    // mantissaBits < 23 rounds floats to that precision first (lossy, more trailing zeros)
+    void begin(uint8_t* block, size_t size, int intChannels, int floatChannels, int mantissaBits = 23);
+    bool append(const uint32_t* ints, const float* floats);  // false when the record does not fit: the block is full
+
+    int getCount();
+    uint32_t getBits();
+    size_t getBytes();  // Bits rounded up to whole bytes
+
+private:
+    uint8_t* data;
+    uint32_t capacityBits;
+    uint32_t bitPosition;
+    bool overflow;
+    int intCount;
+    int floatCount;
+    uint32_t roundMask;   // Mantissa bits dropped by the precision
+    int count;
+
+    // Previous record per channel
+    uint32_t lastInt[GORILLA_MAX_CHANNELS];
+    int32_t lastDelta[GORILLA_MAX_CHANNELS];
+    uint32_t lastFloat[GORILLA_MAX_CHANNELS];
+    uint8_t lastLeading[GORILLA_MAX_CHANNELS];
+    uint8_t lastTrailing[GORILLA_MAX_CHANNELS];
+
+    void writeBits(uint32_t value, int bits);  // MSB first, at most 32
+    void encodeInt(int channel, uint32_t value);
+    void encodeFloat(int channel, uint32_t value);
+};
+
+// Streams the records of one block back, in order
+class GorillaDecoder {
+public:
+    GorillaDecoder();
+    void begin(const uint8_t* block, uint32_t bits, int intChannels, int floatChannels);
+    bool next(uint32_t* ints, float* floats);  // false at the end of the block
+
+private:
+    const uint8_t* data;
+    uint32_t endBits;
+    uint32_t bitPosition;
+    int intCount;
+    int floatCount;
+    bool first;
+
+    uint32_t lastInt[GORILLA_MAX_CHANNELS];
+    int32_t lastDelta[GORILLA_MAX_CHANNELS];
+    uint32_t lastFloat[GORILLA_MAX_CHANNELS];
+    uint8_t lastLeading[GORILLA_MAX_CHANNELS];
+    uint8_t lastTrailing[GORILLA_MAX_CHANNELS];
+
+    uint32_t readBits(int bits);
+    uint32_t decodeInt(int channel);
+    uint32_t decodeFloat(int channel);
+};
+
+#endif // GORILLA_CODEC_H
@@ -0,0 +1,481 @@
+#include "history.h"
+#include "psram_alloc.h"
+
+// Record layout of the codec
+#define HISTORY_INT_CHANNELS 2    // Simulated time, millis()
+#define HISTORY_FLOAT_CHANNELS 3  // Generated, load, SoC
+
+History::History(Simulation* simulationRef)
+    : simulation(simulationRef), storage(nullptr), blocks(nullptr), blockCapacity(0), blockHead(0), blockCount(0), count(0),
+      overwritten(0), cacheClock(0), decodedBlocks(0) {
+    for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) {
+        cache[i] = nullptr;
+        cacheBlock[i] = -1;
+    }
+}
+
+bool History::begin() {
+    // Full ring in PSRAM when fitted, a short one in internal RAM otherwise
+    bool inPsram = false;
+    storage = (uint8_t*)allocateLarge(HISTORY_BLOCKS * HISTORY_BLOCK_SIZE, HISTORY_BLOCKS_INTERNAL * HISTORY_BLOCK_SIZE, &inPsram);
+    blockCapacity = inPsram ? HISTORY_BLOCKS : HISTORY_BLOCKS_INTERNAL;
+    blocks = (HistoryBlock*)malloc(blockCapacity * sizeof(HistoryBlock));
+    bool cached = true;
+    for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) {
+        cache[i] = (HistoryPoint*)malloc(HISTORY_BLOCK_MAX_POINTS * sizeof(HistoryPoint));
+        cached = cached && cache[i] != nullptr;
+    }
+    if (storage == nullptr || blocks == nullptr || !cached) {
+        Serial.println("History: out of memory");
+        blockCapacity = 0;
+        return false;
+    }
+    
+    Serial.print("History: ");
+    Serial.print(blockCapacity);
+    Serial.print(" blocks of ");
+    Serial.print(HISTORY_BLOCK_SIZE);
+    Serial.println(" bytes");
+    return true;
+}
+
+void History::toRecord(const HistoryPoint& point, uint32_t* ints, float* floats) {
+    ints[0] = (uint32_t)(point.hour * HISTORY_TIME_UNITS + 0.5f);
+    ints[1] = point.timeMs;
+    floats[0] = point.powerGenerated;
+    floats[1] = point.powerLoad;
+    floats[2] = point.batteryLevel;
+}
+
+void History::fromRecord(const uint32_t* ints, const float* floats, HistoryPoint& point) {
+    point.hour = ints[0] / (float)HISTORY_TIME_UNITS;
+    point.timeMs = ints[1];
+    point.powerGenerated = floats[0];
+    point.powerLoad = floats[1];
+    point.batteryLevel = floats[2];
+}
+
+void History::clear() {
+    blockHead = 0;
+    blockCount = 0;
+    count = 0;
+    for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) cacheBlock[i] = -1;
+}
+
+HistoryBlock& History::block(int index) {
+    return blocks[(blockHead + index) % blockCapacity];
+}
+
+uint8_t* History::blockData(int index) {
+    return storage + (size_t)((blockHead + index) % blockCapacity) * HISTORY_BLOCK_SIZE;
+}
+
+bool History::openBlock(const uint32_t* ints, const float* floats, float hour) {
+    uint32_t first = blockCount > 0 ? block(blockCount - 1).first + block(blockCount - 1).count : 0;
+    if (blockCount == blockCapacity) {
+        // Ring full: drop the oldest block
+        overwritten += block(0).count;
+        count -= block(0).count;
+        for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) {
+            if (cacheBlock[i] == blockHead) cacheBlock[i] = -1;
+        }
+        blockHead = (blockHead + 1) % blockCapacity;
+        blockCount--;
+    }
+    
+    blockCount++;
+    encoder.begin(blockData(blockCount - 1), HISTORY_BLOCK_SIZE, HISTORY_INT_CHANNELS, HISTORY_FLOAT_CHANNELS, HISTORY_MANTISSA_BITS);
+    if (!encoder.append(ints, floats)) {
+        blockCount--;
+        return false;
+    }
+    HistoryBlock& opened = block(blockCount - 1);
+    opened.first = first;
+    opened.count = 1;
+    opened.bits = encoder.getBits();
+    opened.firstHour = hour;
+    opened.lastHour = hour;
+    return true;
+}
+
+void History::sample() {
+    if (blockCapacity == 0 || !simulation->isRunning()) return;
+    
+    HistoryPoint point;
+    point.timeMs = millis();
+    point.hour = simulation->getSimulationHour();
+    SimulationData data = simulation->getCurrentData();
+    point.powerGenerated = data.powerGenerated;
+    point.powerLoad = data.powerLoad;
+    point.batteryLevel = data.batteryLevel;
+    
+    uint32_t ints[HISTORY_INT_CHANNELS];
+    float floats[HISTORY_FLOAT_CHANNELS];
+    toRecord(point, ints, floats);
+    float hour = ints[0] / (float)HISTORY_TIME_UNITS;  // As stored
+    
+    if (count > 0) {
+        float lastHour = block(blockCount - 1).lastHour;
+        if (hour < lastHour) {
+            // New run started: the hour went back to 6:00
+            clear();
+        } else if (hour == lastHour) {
+            return;
+        }
+    }
+    
+    // Into the open block, or a new one when it is full
+    bool appended = blockCount > 0 && encoder.getCount() < HISTORY_BLOCK_MAX_POINTS && encoder.append(ints, floats);
+    if (appended) {
+        HistoryBlock& open = block(blockCount - 1);
+        open.count++;
+        open.bits = encoder.getBits();
+        open.lastHour = hour;
+    } else if (!openBlock(ints, floats, hour)) {
+        return;
+    }
+    count++;
+}
+
+int History::blockOf(uint32_t sequence) {
+    // Last block starting at or before the sequence number
+    int low = 0;
+    int high = blockCount - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (block(middle).first <= sequence) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+const HistoryPoint* History::decoded(int index) {
+    int ring = (blockHead + index) % blockCapacity;
+    const HistoryBlock& b = block(index);
+    
+    int slot = 0;
+    for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) {
+        if (cacheBlock[i] == ring && cacheFirst[i] == b.first && cacheCount[i] == b.count) {
+            cacheUsed[i] = ++cacheClock;
+            return cache[i];
+        }
+        if (cacheBlock[i] < 0 || (cacheBlock[slot] >= 0 && cacheUsed[i] < cacheUsed[slot])) slot = i;
+    }
+    
+    GorillaDecoder decoder;
+    decoder.begin(blockData(index), b.bits, HISTORY_INT_CHANNELS, HISTORY_FLOAT_CHANNELS);
+    uint32_t ints[HISTORY_INT_CHANNELS];
+    float floats[HISTORY_FLOAT_CHANNELS];
+    int n = 0;
+    while (n < b.count && decoder.next(ints, floats)) {
+        fromRecord(ints, floats, cache[slot][n]);
+        n++;
+    }
+    cacheBlock[slot] = ring;
+    cacheFirst[slot] = b.first;
+    cacheCount[slot] = b.count;
+    cacheUsed[slot] = ++cacheClock;
+    decodedBlocks++;
+    return cache[slot];
+}
+
+HistoryPoint History::at(int position) {
+    uint32_t sequence = block(0).first + position;
+    
+    // Queries walk forward, so the point is usually in a cached block
+    for (int i = 0; i < HISTORY_CACHE_BLOCKS; i++) {
+        if (cacheBlock[i] >= 0 && sequence >= cacheFirst[i] && sequence < cacheFirst[i] + cacheCount[i] &&
+            cacheCount[i] == blocks[cacheBlock[i]].count) {
+            return cache[i][sequence - cacheFirst[i]];
+        }
+    }
+    int index = blockOf(sequence);
+    return decoded(index)[sequence - block(index).first];
+}
+
+int History::firstAtOrAfter(float hour) {
+    // Hours only increase within a run: find the block by its range, then the point
+    int low = 0;
+    int high = blockCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (block(middle).lastHour < hour) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == blockCount) return count;
+    
+    const HistoryPoint* points = decoded(low);
+    int offset = 0;
+    while (offset < block(low).count && points[offset].hour < hour) offset++;
+    return block(low).first + offset - block(0).first;
+}
+
+float History::value(const HistoryPoint& point, HistoryField field) {
+    switch (field) {
+        case HISTORY_LOAD: return point.powerLoad;
+        case HISTORY_SOC: return point.batteryLevel;
+        default: return point.powerGenerated;
+    }
+}
+
+int History::query(float fromHour, float toHour, int maxPoints, HistoryMode mode, HistoryField field, const HistoryCallback& emit) {
+    int first = firstAtOrAfter(fromHour);
+    int end = firstAtOrAfter(toHour);  // Exclusive
+    int total = end - first;
+    if (total <= 0 || maxPoints < 1) return 0;
+    
+    // Few enough points: send them all
+    if (total <= maxPoints || (mode == HISTORY_LTTB && maxPoints < 3)) {
+        int sent = 0;
+        for (int i = first; i < end && sent < maxPoints; i++) {
+            if (!emit(at(i))) break;
+            sent++;
+        }
+        return sent;
+    }
+    
+    int sent = 0;
+    if (mode == HISTORY_MINMAX) {
+        // Two points per bucket, emitted in time order so lines stay monotonic in x
+        int buckets = max(1, maxPoints / 2);
+        for (int b = 0; b < buckets; b++) {
+            int bucketStart = first + (int)((int64_t)total * b / buckets);
+            int bucketEnd = first + (int)((int64_t)total * (b + 1) / buckets);
+            int minIndex = bucketStart;
+            int maxIndex = bucketStart;
+            float minValue = value(at(bucketStart), field);
+            float maxValue = minValue;
+            for (int i = bucketStart + 1; i < bucketEnd; i++) {
+                float v = value(at(i), field);
+                if (v < minValue) {
+                    minValue = v;
+                    minIndex = i;
+                }
+                if (v > maxValue) {
+                    maxValue = v;
+                    maxIndex = i;
+                }
+            }
+            int earlier = min(minIndex, maxIndex);
+            int later = max(minIndex, maxIndex);
+            if (!emit(at(earlier))) return sent;
+            sent++;
+            if (later != earlier) {
+                if (!emit(at(later))) return sent;
+                sent++;
+            }
+        }
+        return sent;
+    }
+    
+    // LTTB: keep the first and last point, and from every bucket in between the
+    // point spanning the largest triangle with the previously kept point and the
+    // average of the next bucket. The next bucket is the candidate bucket of the
+    // following step: its points are kept while averaging (up to HISTORY_LTTB_CARRY)
+    // so each point is read once.
+    float bucketSize = (float)(total - 2) / (maxPoints - 2);
+    HistoryPoint a = at(first);
+    float ax = a.hour;
+    float ay = value(a, field);
+    if (!emit(a)) return sent;
+    sent++;
+    
+    int carried = -1;  // Points of the current bucket in carry[current], -1 = not carried
+    int current = 0;
+    for (int b = 0; b < maxPoints - 2; b++) {
+        int bucketStart = first + 1 + (int)(b * bucketSize);
+        int bucketEnd = first + 1 + (int)((b + 1) * bucketSize);
+        int nextEnd = min(first + 1 + (int)((b + 2) * bucketSize), end);
+        
+        // Average of the next bucket (the last point for the final bucket)
+        float averageX = 0.0f;
+        float averageY = 0.0f;
+        int nextCount = nextEnd - bucketEnd;
+        float* nextX = carryX[1 - current];
+        float* nextY = carryY[1 - current];
+        if (nextCount > 0) {
+            bool keep = nextCount <= HISTORY_LTTB_CARRY;
+            for (int i = bucketEnd; i < nextEnd; i++) {
+                HistoryPoint p = at(i);
+                float y = value(p, field);
+                averageX += p.hour;
+                averageY += y;
+                if (keep) {
+                    nextX[i - bucketEnd] = p.hour;
+                    nextY[i - bucketEnd] = y;
+                }
+            }
+            averageX /= nextCount;
+            averageY /= nextCount;
+        } else {
+            HistoryPoint last = at(end - 1);
+            averageX = last.hour;
+            averageY = value(last, field);
+        }
+        
+        // Candidates from the carry, or read again when the bucket was too large
+        const float* candidateX = carryX[current];
+        const float* candidateY = carryY[current];
+        bool fromCarry = carried == bucketEnd - bucketStart;
+        float largestArea = -1.0f;
+        int selected = bucketStart;
+        float selectedX = ax;
+        float selectedY = ay;
+        for (int i = bucketStart; i < bucketEnd; i++) {
+            float x;
+            float y;
+            if (fromCarry) {
+                x = candidateX[i - bucketStart];
+                y = candidateY[i - bucketStart];
+            } else {
+                HistoryPoint p = at(i);
+                x = p.hour;
+                y = value(p, field);
+            }
+            float area = fabsf((ax - averageX) * (y - ay) - (ax - x) * (averageY - ay));
+            if (area > largestArea) {
+                largestArea = area;
+                selected = i;
+                selectedX = x;
+                selectedY = y;
+            }
+        }
+        
+        ax = selectedX;
+        ay = selectedY;
+        carried = nextCount > 0 && nextCount <= HISTORY_LTTB_CARRY ? nextCount : -1;
+        current = 1 - current;
+        if (!emit(at(selected))) return sent;
+        sent++;
+    }
+    
+    if (emit(at(end - 1))) sent++;
+    return sent;
+}
+
+int History::exportBlocks(float fromHour, float toHour, const std::function<bool(const HistoryBlock& block, const uint8_t* data)>& emit) {
+    int sent = 0;
+    for (int i = 0; i < blockCount; i++) {
+        const HistoryBlock& b = block(i);
+        if (b.lastHour < fromHour || b.firstHour >= toHour) continue;
+        if (!emit(b, blockData(i))) break;
+        sent++;
+    }
+    return sent;
+}
+
+int History::getCount() {
+    return count;
+}
+
+bool History::getRange(float& firstHour, float& lastHour) {
+    if (count == 0) return false;
+    firstHour = block(0).firstHour;
+    lastHour = block(blockCount - 1).lastHour;
+    return true;
+}
+
+String History::getJson() {
+    float firstHour = 0.0f;
+    float lastHour = 0.0f;
+    getRange(firstHour, lastHour);
+    
+    uint32_t bytes = 0;
+    for (int i = 0; i < blockCount; i++) bytes += (block(i).bits + 7) / 8;
+    float bytesPerPoint = count > 0 ? (float)bytes / count : 0.0f;
+    
+    String json = "{";
+    json += "\"count\":" + String(count) + ",";
+    json += "\"blocks\":" + String(blockCount) + ",";
+    json += "\"blockCapacity\":" + String(blockCapacity) + ",";
+    json += "\"blockSize\":" + String(HISTORY_BLOCK_SIZE) + ",";
+    json += "\"bytes\":" + String(bytes) + ",";
+    json += "\"bytesPerPoint\":" + String(bytesPerPoint, 2) + ",";
+    json += "\"compression\":" + String(bytesPerPoint > 0.0f ? sizeof(HistoryPoint) / bytesPerPoint : 0.0f, 2) + ",";
+    json += "\"mantissaBits\":" + String(HISTORY_MANTISSA_BITS) + ",";
+    json += "\"decodedBlocks\":" + String(decodedBlocks) + ",";
+    json += "\"overwritten\":" + String(overwritten) + ",";
+    json += "\"firstHour\":" + String(firstHour, 3) + ",";
+    json += "\"lastHour\":" + String(lastHour, 3) + ",";
+    json += "\"periodMs\":" + String(HISTORY_SAMPLE_PERIOD);
+    json += "}";
+    return json;
+}
+
+String History::benchmark(int points, const std::function<void()>& pause) {
+    // Live-run-like series: 6 min of simulated time per point, clear-sky generation
+    // with the simulation's 12% jitter and cloud drops, load with 3% jitter.
+    // Records are generated in batches outside the timed sections, where `pause`
+    // also lets other jobs run.
+    const int batch = 64;
+    uint32_t ints[batch][HISTORY_INT_CHANNELS];
+    float floats[batch][HISTORY_FLOAT_CHANNELS];
+    uint8_t data[HISTORY_BLOCK_SIZE];
+    GorillaEncoder benchEncoder;
+    GorillaDecoder decoder;
+    uint32_t encodeUs = 0;
+    uint32_t decodeUs = 0;
+    uint32_t bytes = 0;
+    int blocksUsed = 0;
+    int decoded = 0;
+    float soc = 50.0f;
+    
+    // Closes a full block: decode it back and account for its size
+    auto flush = [&]() {
+        uint32_t decodeInts[HISTORY_INT_CHANNELS];
+        float decodeFloats[HISTORY_FLOAT_CHANNELS];
+        uint32_t startUs = micros();
+        decoder.begin(data, benchEncoder.getBits(), HISTORY_INT_CHANNELS, HISTORY_FLOAT_CHANNELS);
+        while (decoder.next(decodeInts, decodeFloats)) decoded++;
+        decodeUs += micros() - startUs;
+        bytes += benchEncoder.getBytes();
+        blocksUsed++;
+    };
+    
+    benchEncoder.begin(data, sizeof(data), HISTORY_INT_CHANNELS, HISTORY_FLOAT_CHANNELS, HISTORY_MANTISSA_BITS);
+    for (int first = 0; first < points; first += batch) {
+        int n = min(batch, points - first);
+        if (pause) pause();
+        for (int k = 0; k < n; k++) {
+            HistoryPoint point;
+            point.hour = 6.0f + (first + k) * 0.1f;
+            point.timeMs = 1000 + (first + k) * HISTORY_SAMPLE_PERIOD + random(-2, 3);
+            float sun = sinf((fmodf(point.hour, 24.0f) - 6.0f) / 12.0f * PI);
+            point.powerGenerated = max(0.0f, 10000.0f * sun) * (1.0f + random(-120, 121) / 1000.0f) * (random(10) == 0 ? 0.5f : 1.0f);
+            point.powerLoad = 1200.0f * (1.0f + random(-30, 31) / 1000.0f);
+            soc = constrain(soc + (point.powerGenerated - point.powerLoad) / 50000.0f, 0.0f, 100.0f);
+            point.batteryLevel = soc;
+            toRecord(point, ints[k], floats[k]);
+        }
+        
+        uint32_t decodeBefore = decodeUs;
+        uint32_t startUs = micros();
+        for (int k = 0; k < n; k++) {
+            if (benchEncoder.getCount() < HISTORY_BLOCK_MAX_POINTS && benchEncoder.append(ints[k], floats[k])) continue;
+            flush();
+            benchEncoder.begin(data, sizeof(data), HISTORY_INT_CHANNELS, HISTORY_FLOAT_CHANNELS, HISTORY_MANTISSA_BITS);
+            benchEncoder.append(ints[k], floats[k]);
+        }
+        encodeUs += micros() - startUs - (decodeUs - decodeBefore);
+    }
+    if (benchEncoder.getCount() > 0) flush();
+    
+    float bytesPerPoint = points > 0 ? (float)bytes / points : 0.0f;
+    String json = "{";
+    json += "\"points\":" + String(points) + ",";
+    json += "\"decoded\":" + String(decoded) + ",";
+    json += "\"blocks\":" + String(blocksUsed) + ",";
+    json += "\"bytesPerPoint\":" + String(bytesPerPoint, 2) + ",";
+    json += "\"compression\":" + String(bytesPerPoint > 0.0f ? sizeof(HistoryPoint) / bytesPerPoint : 0.0f, 2) + ",";
+    json += "\"mantissaBits\":" + String(HISTORY_MANTISSA_BITS) + ",";
+    json += "\"encodeNsPerPoint\":" + String(points > 0 ? encodeUs * 1000.0f / points : 0.0f, 0) + ",";
+    json += "\"decodeNsPerPoint\":" + String(points > 0 ? decodeUs * 1000.0f / points : 0.0f, 0);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,101 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+#include "simulation.h"
+#include "gorilla_codec.h"
+
+// One recorded point of the live run
+struct HistoryPoint {
+    uint32_t timeMs;         // millis() when recorded
+    float hour;              // Simulation hour, 6.0 to 6.0 + 24 * days
+    float powerGenerated;    // W
+    float powerLoad;         // W
+    float batteryLevel;      // %
+};
+
+enum HistoryMode {
+    HISTORY_LTTB,            // Largest-Triangle-Three-Buckets, one point per bucket
+    HISTORY_MINMAX           // Minimum and maximum of every bucket
+};
+
+enum HistoryField {
+    HISTORY_GENERATED,       // Series the downsampler keeps the shape of
+    HISTORY_LOAD,
+    HISTORY_SOC
+};
+
+// Receives the selected points in time order; returning false stops the query
+typedef std::function<bool(const HistoryPoint& point)> HistoryCallback;
+
+// One compressed block of the ring: its points and key range, for seeking
+struct HistoryBlock {
+    uint32_t first;          // Sequence number of the first point
+    uint16_t count;
+    uint16_t bits;           // Encoded length
+    float firstHour;
+    float lastHour;
+};
+
+// Time series of the live run, downsampled on the device for the charts.
+// Points are stored Gorilla-compressed in a ring of fixed-size blocks; queries
+// seek by block and decode through a small cache of recently used blocks.
+class History {
+public:
+    History(Simulation* simulationRef);
+    bool begin();
+    void sample();  // Record one point while a run is active (scheduler job)
+
+    // Any hour range reduced to about `points` points in a single pass
+    int query(float fromHour, float toHour, int points, HistoryMode mode, HistoryField field, const HistoryCallback& emit);
+
+    // Compressed blocks overlapping the hour range, as stored (no decoding)
+    int exportBlocks(float fromHour, float toHour, const std::function<bool(const HistoryBlock& block, const uint8_t* data)>& emit);
+
+    int getCount();
+    bool getRange(float& firstHour, float& lastHour);
+    String getJson();
+    String benchmark(int points, const std::function<void()>& pause = nullptr);  // Encode/decode throughput on synthetic data, no effect on the ring
+
+private:
+    Simulation* simulation;
+    uint8_t* storage;        // blockCapacity x HISTORY_BLOCK_SIZE
+    HistoryBlock* blocks;    // Ring, oldest block overwritten when full
+    int blockCapacity;
+    int blockHead;           // Oldest block
+    int blockCount;          // Including the open (last) block
+    GorillaEncoder encoder;  // Appends to the open block
+    int count;
+    uint32_t overwritten;
+
+    // Decoded blocks, least recently used one replaced
+    HistoryPoint* cache[HISTORY_CACHE_BLOCKS];
+    int cacheBlock[HISTORY_CACHE_BLOCKS];  // Ring index, -1 = empty
+    uint32_t cacheFirst[HISTORY_CACHE_BLOCKS];
+    uint16_t cacheCount[HISTORY_CACHE_BLOCKS];
+    uint32_t cacheUsed[HISTORY_CACHE_BLOCKS];
+    uint32_t cacheClock;
+    uint32_t decodedBlocks;
+
+    // LTTB: (hour, value) of the averaged next bucket, reused as its candidates one step later
+    float carryX[2][HISTORY_LTTB_CARRY];
+    float carryY[2][HISTORY_LTTB_CARRY];
+
+    // Point <-> codec record: simulated time (HISTORY_TIME_UNITS per hour) and millis() as
+    // delta-of-delta integers, the three series as XOR floats
+    static void toRecord(const HistoryPoint& point, uint32_t* ints, float* floats);
+    static void fromRecord(const uint32_t* ints, const float* floats, HistoryPoint& point);
+    void clear();
+    bool openBlock(const uint32_t* ints, const float* floats, float hour);
+    HistoryBlock& block(int index);  // 0 = oldest
+    uint8_t* blockData(int index);
+    int blockOf(uint32_t sequence);
+    const HistoryPoint* decoded(int index);
+    HistoryPoint at(int position);  // 0 = oldest
+    int firstAtOrAfter(float hour);
+    float value(const HistoryPoint& point, HistoryField field);
+};
+
+#endif // HISTORY_H
@@ -1,13 +1,28 @@
 #include "ina.h"
-#include "config.h"
+#include <Wire.h>
 
-INA::INA() : ina219(INA219_ADDR), found(false) {
+// INA219 registers
+#define INA219_REG_SHUNT 0x01
+#define INA219_REG_BUS 0x02
+#define INA219_REG_POWER 0x03
+#define INA219_REG_CURRENT 0x04
+#define INA219_REG_CALIBRATION 0x05
+
+// Scaling of the library default range (32 V, 2 A) set up by begin()
+#define INA219_CALIBRATION_VALUE 4096
+#define INA219_CURRENT_LSB 0.1          // mA
+#define INA219_POWER_LSB 2.0            // mW
+#define INA219_BUS_LSB 0.004            // V
+
+INA::INA() : ina219(INA219_ADDR), found(false), bursts(0), cacheHits(0), busErrors(0), recalibrations(0) {
+    memset(&latest, 0, sizeof(latest));
 }
 
 bool INA::begin() {
     found = ina219.begin();
     if (found) {
         Serial.println("INA219 initialized successfully!");
+        sample();
     } else {
         Serial.println("INA219 initialization failed!");
     }
@@ -18,20 +33,80 @@ bool INA::isFound() {
     return found;
 }
 
+bool INA::readRegister(uint8_t reg, uint16_t& value) {
+    Wire.beginTransmission(INA219_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)INA219_ADDR, (uint8_t)2) != 2) return false;
+    value = ((uint16_t)Wire.read() << 8) | Wire.read();
+    return true;
+}
+
+bool INA::writeRegister(uint8_t reg, uint16_t value) {
+    Wire.beginTransmission(INA219_ADDR);
+    Wire.write(reg);
+    Wire.write(value >> 8);
+    Wire.write(value & 0xFF);
+    return Wire.endTransmission() == 0;
+}
+
+bool INA::sample() {
+    if (!found) return false;
+    
+    // Back-to-back register reads; bus first (CNVR), power last (reading it clears CNVR).
+    // The library rewrites the calibration before every current read, here it is
+    // only rewritten when a chip reset has cleared it.
+    uint16_t bus, shunt, current, power;
+    if (!readRegister(INA219_REG_BUS, bus) || !readRegister(INA219_REG_SHUNT, shunt) ||
+        !readRegister(INA219_REG_CURRENT, current) || !readRegister(INA219_REG_POWER, power)) {
+        busErrors++;
+        return false;
+    }
+    
+    if (current == 0 && shunt != 0) {
+        writeRegister(INA219_REG_CALIBRATION, INA219_CALIBRATION_VALUE);
+        recalibrations++;
+    }
+    
+    bursts++;
+    latest.timeMs = millis();
+    latest.voltage = (bus >> 3) * INA219_BUS_LSB;
+    latest.current = max(0.0, (int16_t)current * INA219_CURRENT_LSB);
+    latest.power = power * INA219_POWER_LSB;
+    latest.converted = bus & 0x02;
+    latest.overflow = bus & 0x01;
+    return true;
+}
+
+InaSample INA::getSample(uint32_t maxAgeMs) {
+    if (found && (latest.timeMs == 0 || millis() - latest.timeMs > maxAgeMs)) {
+        sample();
+    } else {
+        cacheHits++;
+    }
+    return latest;
+}
+
 float INA::getBusVoltage() {
-    if (!found) return 0.0;
-    float voltage = ina219.getBusVoltage_V();
-    return voltage < 0.0 ? 0.0 : voltage;
+    return getSample().voltage;
 }
 
 float INA::getCurrent() {
-    if (!found) return 0.0;
-    float current = ina219.getCurrent_mA();
-    return current < 0.0 ? 0.0 : current;
+    return getSample().current;
 }
 
 float INA::getPower() {
-    if (!found) return 0.0;
-    float power = ina219.getPower_mW();
-    return power < 0.0 ? 0.0 : power;
+    return getSample().power;
+}
+
+String INA::getStatusJson() {
+    String json = "{";
+    json += "\"found\":" + String(found ? "true" : "false") + ",";
+    json += "\"ageMs\":" + String(latest.timeMs > 0 ? millis() - latest.timeMs : 0) + ",";
+    json += "\"bursts\":" + String(bursts) + ",";
+    json += "\"cacheHits\":" + String(cacheHits) + ",";
+    json += "\"busErrors\":" + String(busErrors) + ",";
+    json += "\"recalibrations\":" + String(recalibrations);
+    json += "}";
+    return json;
 }
@@ -3,19 +3,49 @@
 
 #include <Arduino.h>
 #include <Adafruit_INA219.h>
+#include "config.h"
+#include "sample_source.h"
 
-class INA {
+// One burst read of all INA219 measurement registers, taken at the same instant
+struct InaSample {
+    uint32_t timeMs;      // millis() of the burst (0 = never sampled)
+    float voltage;        // Bus voltage, V
+    float current;        // mA
+    float power;          // mW
+    bool converted;       // CNVR set: a new conversion since the previous burst
+    bool overflow;        // OVF set: shunt range exceeded, current/power invalid
+};
+
+// INA219 with a latest-sample cache: every consumer is served from the last
+// burst, the bus is only read again when the sample is older than allowed
+class INA : public SampleSource {
 public:
     INA();
     bool begin();
-    bool isFound();
-    float getBusVoltage();
-    float getCurrent();
-    float getPower();
+    bool isFound() override;
+    bool sample();  // Burst read now (sensor job), returns false on a bus error
+    InaSample getSample(uint32_t maxAgeMs = INA_MAX_AGE);
+
+    // SampleSource, served from the cache
+    float getBusVoltage() override;
+    float getCurrent() override;
+    float getPower() override;
+
+    String getStatusJson();
 
 private:
     Adafruit_INA219 ina219;
     bool found;
+    InaSample latest;
+
+    // Statistics
+    uint32_t bursts;
+    uint32_t cacheHits;
+    uint32_t busErrors;
+    uint32_t recalibrations;  // Chip reset detected, calibration register rewritten
+
+    bool readRegister(uint8_t reg, uint16_t& value);
+    bool writeRegister(uint8_t reg, uint16_t value);
 };
 
 #endif // INA_H
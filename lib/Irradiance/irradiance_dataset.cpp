@@ -0,0 +1,230 @@
+#include "irradiance_dataset.h"
+
+IrradianceDataset::IrradianceDataset() : bufferFill(0), bufferPos(0) {
+    memset(&header, 0, sizeof(header));
+}
+
+bool IrradianceDataset::import(const char* csvPath, const char* datasetPath, const std::function<void()>& onBlock) {
+    File in = LittleFS.open(csvPath, "r");
+    if (!in) {
+        Serial.print("Dataset import: cannot open ");
+        Serial.println(csvPath);
+        return false;
+    }
+
+    File out = LittleFS.open(datasetPath, "w");
+    if (!out) {
+        Serial.print("Dataset import: cannot create ");
+        Serial.println(datasetPath);
+        in.close();
+        return false;
+    }
+
+    unsigned long startMs = millis();
+    DatasetHeader head = {DATASET_MAGIC, DATASET_VERSION, 0, 0, 1, 0};
+    out.write((const uint8_t*)&head, sizeof(head));  // Patched once the count is known
+
+    // Parse line by line, output goes through a fixed block buffer
+    DatasetRecord block[DATASET_BUFFER_RECORDS];
+    uint16_t fill = 0;
+    DatasetRecord last = {0, 0};
+    uint32_t firstSeconds = 0;
+    uint16_t firstDayOfYear = 1;
+    uint32_t prevSeconds = 0;
+    uint32_t step = 0;
+    uint32_t gapRecords = 0;
+    uint32_t offGrid = 0;
+    char line[96];
+
+    auto emit = [&](const DatasetRecord& record) {
+        block[fill++] = record;
+        head.count++;
+        if (fill == DATASET_BUFFER_RECORDS) {
+            out.write((const uint8_t*)block, fill * sizeof(DatasetRecord));
+            fill = 0;
+            if (onBlock) onBlock();
+        }
+    };
+
+    while (in.available()) {
+        size_t length = in.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[length] = '\0';
+
+        // Skip header and comment lines
+        if (line[0] < '0' || line[0] > '9') continue;
+
+        char* comma = strchr(line, ',');
+        if (comma == nullptr) continue;
+        *comma = '\0';
+
+        uint32_t seconds;
+        uint16_t dayOfYear;
+        if (!parseTimestamp(line, seconds, dayOfYear)) continue;
+
+        float irradiance = 0.0;
+        float temperature = 25.0;
+        if (sscanf(comma + 1, "%f,%f", &irradiance, &temperature) < 1) continue;
+
+        // Quantize to the compact record format
+        float irradianceSteps = irradiance / DATASET_IRRADIANCE_LSB + 0.5;
+        float temperatureSteps = roundf(temperature / DATASET_TEMPERATURE_LSB);
+        DatasetRecord record;
+        record.irradiance = (uint8_t)constrain(irradianceSteps, 0.0f, 255.0f);
+        record.temperature = (int8_t)constrain(temperatureSteps, -128.0f, 127.0f);
+
+        if (head.count == 0) {
+            firstSeconds = seconds;
+            firstDayOfYear = dayOfYear;
+        } else {
+            if (seconds <= prevSeconds) continue;  // Duplicate or out of order
+            if (step == 0) step = min(seconds - prevSeconds, (uint32_t)65535);
+
+            // The grid is fixed by the first two records; anything between grid points is dropped
+            if ((seconds - firstSeconds) % step != 0) {
+                offGrid++;
+                continue;
+            }
+
+            // Keep the grid regular: missing records are filled with zero irradiance,
+            // so a gap never produces energy (the temperature is held, it has no effect at 0 W/m²)
+            DatasetRecord missing = {0, last.temperature};
+            while (prevSeconds + step < seconds) {
+                emit(missing);
+                gapRecords++;
+                prevSeconds += step;
+            }
+        }
+
+        emit(record);
+        last = record;
+        prevSeconds = seconds;
+    }
+
+    if (fill > 0) {
+        out.write((const uint8_t*)block, fill * sizeof(DatasetRecord));
+    }
+
+    head.stepSeconds = step > 0 ? step : 60;
+    head.startDay = firstDayOfYear;
+    head.startMinute = (firstSeconds % 86400) / 60;
+    out.seek(0);
+    out.write((const uint8_t*)&head, sizeof(head));
+    out.close();
+    in.close();
+
+    Serial.print("Dataset imported: ");
+    Serial.print(head.count);
+    Serial.print(" records, step ");
+    Serial.print(head.stepSeconds);
+    Serial.print(" s, ");
+    Serial.print(gapRecords);
+    Serial.print(" gap records, ");
+    Serial.print(offGrid);
+    Serial.print(" off-grid rows dropped, ");
+    Serial.print(millis() - startMs);
+    Serial.println(" ms");
+    return head.count > 0;
+}
+
+bool IrradianceDataset::parseTimestamp(const char* text, uint32_t& seconds, uint16_t& dayOfYear) {
+    // "YYYY-MM-DD HH:MM[:SS]" / "YYYY-MM-DDTHH:MM[:SS]" -> seconds since 1 Jan 1970, so the
+    // count keeps increasing across New Year and a file spanning several years stays ordered
+    int year, month, day, hour, minute, second = 0;
+    if (sscanf(text, "%d-%d-%d%*c%d:%d:%d", &year, &month, &day, &hour, &minute, &second) >= 5) {
+        static const uint16_t daysBeforeMonth[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+        if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) return false;
+
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        dayOfYear = daysBeforeMonth[month - 1] + day + (leap && month > 2 ? 1 : 0);
+
+        // Whole days before this year, leap days counted from 1970
+        int y = year - 1;
+        uint32_t days = (year - 1970) * 365UL + (y / 4 - 1969 / 4) - (y / 100 - 1969 / 100) + (y / 400 - 1969 / 400);
+        seconds = (days + dayOfYear - 1) * 86400UL + hour * 3600UL + minute * 60UL + second;
+        return true;
+    }
+
+    // Plain number: minutes since the start of the series (monotonic, may exceed one year)
+    char* end;
+    unsigned long minutes = strtoul(text, &end, 10);
+    if (end == text) return false;
+    seconds = minutes * 60UL;
+    dayOfYear = (minutes / 1440) % 365 + 1;
+    return true;
+}
+
+bool IrradianceDataset::open(const char* path) {
+    close();
+
+    file = LittleFS.open(path, "r");
+    if (!file) return false;
+
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != DATASET_MAGIC || header.version != DATASET_VERSION) {
+        Serial.print("Dataset: invalid file ");
+        Serial.println(path);
+        file.close();
+        memset(&header, 0, sizeof(header));
+        return false;
+    }
+
+    bufferFill = 0;
+    bufferPos = 0;
+    return true;
+}
+
+void IrradianceDataset::close() {
+    if (file) file.close();
+}
+
+bool IrradianceDataset::isOpen() {
+    return (bool)file;
+}
+
+bool IrradianceDataset::next(float& irradianceWm2, float& temperatureC) {
+    if (bufferPos >= bufferFill) {
+        // Refill one block; memory use is independent of the dataset size
+        size_t bytes = file ? file.read((uint8_t*)buffer, sizeof(buffer)) : 0;
+        bufferFill = bytes / sizeof(DatasetRecord);
+        bufferPos = 0;
+        if (bufferFill == 0) return false;
+    }
+
+    const DatasetRecord& record = buffer[bufferPos++];
+    irradianceWm2 = record.irradiance * DATASET_IRRADIANCE_LSB;
+    temperatureC = record.temperature * DATASET_TEMPERATURE_LSB;
+    return true;
+}
+
+void IrradianceDataset::rewind() {
+    if (file) file.seek(sizeof(header));
+    bufferFill = 0;
+    bufferPos = 0;
+}
+
+uint32_t IrradianceDataset::getCount() {
+    return header.count;
+}
+
+uint16_t IrradianceDataset::getStepSeconds() {
+    return header.stepSeconds;
+}
+
+uint16_t IrradianceDataset::getStartDay() {
+    return header.startDay;
+}
+
+uint16_t IrradianceDataset::getStartMinute() {
+    return header.startMinute;
+}
+
+String IrradianceDataset::getInfoJson() {
+    String json = "{";
+    json += "\"records\":" + String(header.count) + ",";
+    json += "\"stepSeconds\":" + String(header.stepSeconds) + ",";
+    json += "\"startDay\":" + String(header.startDay) + ",";
+    json += "\"startMinute\":" + String(header.startMinute) + ",";
+    json += "\"days\":" + String(header.count * (float)header.stepSeconds / 86400.0, 2);
+    json += "}";
+    return json;
+}
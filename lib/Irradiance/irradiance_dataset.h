@@ -0,0 +1,58 @@
+#ifndef IRRADIANCE_DATASET_H
+#define IRRADIANCE_DATASET_H
+
+#include <Arduino.h>
+#include <functional>
+#include <LittleFS.h>
+#include "config.h"
+
+// Compact dataset file: header followed by 2-byte records on a regular time grid
+#define DATASET_MAGIC 0x52494D53  // "SMIR" little endian
+#define DATASET_VERSION 1
+
+struct DatasetHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t stepSeconds;      // Time between records
+    uint32_t count;            // Number of records
+    uint16_t startDay;         // Day of year of the first record (1-366)
+    uint16_t startMinute;      // Minute of day of the first record
+};
+
+struct DatasetRecord {
+    uint8_t irradiance;        // W/m² / DATASET_IRRADIANCE_LSB
+    int8_t temperature;        // °C / DATASET_TEMPERATURE_LSB
+};
+
+// Measured irradiance/temperature series, streamed from LittleFS
+class IrradianceDataset {
+public:
+    IrradianceDataset();
+
+    // CSV (timestamp,irradiance_Wm2,temperature_C) -> compact binary, streaming;
+    // onBlock runs after every written block (e.g. to let other jobs run)
+    static bool import(const char* csvPath, const char* datasetPath, const std::function<void()>& onBlock = nullptr);
+
+    bool open(const char* path);
+    void close();
+    bool isOpen();
+    bool next(float& irradianceWm2, float& temperatureC);  // Sequential read
+    void rewind();
+
+    uint32_t getCount();
+    uint16_t getStepSeconds();
+    uint16_t getStartDay();
+    uint16_t getStartMinute();
+    String getInfoJson();
+
+private:
+    File file;
+    DatasetHeader header;
+    DatasetRecord buffer[DATASET_BUFFER_RECORDS];
+    uint16_t bufferFill;
+    uint16_t bufferPos;
+
+    static bool parseTimestamp(const char* text, uint32_t& seconds, uint16_t& dayOfYear);
+};
+
+#endif // IRRADIANCE_DATASET_H
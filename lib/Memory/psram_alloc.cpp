@@ -0,0 +1,9 @@
+#include "psram_alloc.h"
+#include <esp_heap_caps.h>
+
+void* allocateLarge(size_t bytes, size_t fallbackBytes, bool* inPsram) {
+    void* buffer = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (inPsram != nullptr) *inPsram = buffer != nullptr;
+    if (buffer == nullptr) buffer = malloc(fallbackBytes > 0 ? fallbackBytes : bytes);
+    return buffer;
+}
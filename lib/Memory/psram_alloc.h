@@ -0,0 +1,11 @@
+#ifndef PSRAM_ALLOC_H
+#define PSRAM_ALLOC_H
+
+#include <Arduino.h>
+
+// Large buffers: PSRAM when fitted, internal RAM otherwise (nullptr if neither has room).
+// fallbackBytes sizes the internal-RAM attempt (0 = same size), inPsram reports where
+// the buffer went. Release with free().
+void* allocateLarge(size_t bytes, size_t fallbackBytes = 0, bool* inPsram = nullptr);
+
+#endif // PSRAM_ALLOC_H
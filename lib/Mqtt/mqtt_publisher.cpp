@@ -0,0 +1,284 @@
+#include "mqtt_publisher.h"
+#include "psram_alloc.h"
+
+MqttPublisher::MqttPublisher(Simulation* simulationRef)
+    : simulation(simulationRef), client(network), brokerHost(nullptr), brokerPort(0), started(false), connected(false),
+      queue(nullptr), head(0), count(0), nextSequence(1), queueLock(portMUX_INITIALIZER_UNLOCKED),
+      inaVoltageSum(0.0), inaCurrentSum(0.0), inaCurrentMin(0.0), inaCurrentMax(0.0), inaReadings(0),
+      dropped(0), messages(0), published(0), bytes(0), failures(0), reconnects(0),
+      reconnectDelay(MQTT_RECONNECT_MIN), lastAttemptMs(0) {
+    unitId[0] = '\0';
+    topic[0] = '\0';
+}
+
+bool MqttPublisher::begin(const char* broker, uint16_t port) {
+    // Queue in PSRAM when fitted
+    queue = (MqttSample*)allocateLarge(MQTT_QUEUE_SIZE * sizeof(MqttSample));
+    if (queue == nullptr) {
+        Serial.println("MQTT: out of memory");
+        return false;
+    }
+
+    brokerHost = broker;
+    brokerPort = port;
+    snprintf(unitId, sizeof(unitId), "%08lx", (unsigned long)(uint32_t)ESP.getEfuseMac());
+    snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "%s/telemetry", unitId);
+
+    client.setServer(brokerHost, brokerPort);
+    client.setBufferSize(MQTT_PAYLOAD_MAX + 64);
+    client.setSocketTimeout(2);
+
+    // Network I/O on core 0, next to the WiFi stack
+    if (xTaskCreatePinnedToCore(taskEntry, "mqtt", 6144, this, 1, nullptr, 0) != pdPASS) {
+        Serial.println("MQTT: task start failed");
+        return false;
+    }
+    started = true;
+
+    Serial.print("MQTT publishing to ");
+    Serial.print(brokerHost);
+    Serial.print(":");
+    Serial.print(brokerPort);
+    Serial.print(" topic ");
+    Serial.println(topic);
+    return true;
+}
+
+void MqttPublisher::addInaReading(float voltage, float currentMa) {
+    if (inaReadings == 0 || currentMa < inaCurrentMin) inaCurrentMin = currentMa;
+    if (inaReadings == 0 || currentMa > inaCurrentMax) inaCurrentMax = currentMa;
+    inaVoltageSum += voltage;
+    inaCurrentSum += currentMa;
+    inaReadings++;
+}
+
+void MqttPublisher::sample() {
+    if (!started) return;
+
+    // Build the record outside the lock, the critical section is a plain copy
+    SimulationData data = simulation->getCurrentData();
+    MqttSample record;
+    record.timeMs = millis();
+    record.voltage = data.voltage;
+    record.current = data.current;
+    record.powerGenerated = data.powerGenerated;
+    record.powerLoad = data.powerLoad;
+    record.batteryLevel = data.batteryLevel;
+    record.inaVoltage = inaReadings > 0 ? inaVoltageSum / inaReadings : 0.0;
+    record.inaCurrentMean = inaReadings > 0 ? inaCurrentSum / inaReadings : 0.0;
+    record.inaCurrentMin = inaCurrentMin;
+    record.inaCurrentMax = inaCurrentMax;
+    record.totals = simulation->getTotals();
+    inaVoltageSum = 0.0;
+    inaCurrentSum = 0.0;
+    inaReadings = 0;
+
+    portENTER_CRITICAL(&queueLock);
+    record.sequence = nextSequence++;
+    if (count == MQTT_QUEUE_SIZE) {
+        count--;  // Full: overwrite the oldest record
+        dropped++;
+    }
+    queue[head] = record;
+    head = (head + 1) % MQTT_QUEUE_SIZE;
+    count++;
+    portEXIT_CRITICAL(&queueLock);
+}
+
+int MqttPublisher::peekBatch(MqttSample* batch, int maxCount) {
+    // Copy the oldest records without removing them; they are only removed
+    // once the broker has accepted the message
+    portENTER_CRITICAL(&queueLock);
+    int n = min((int)count, maxCount);
+    int tail = (head + MQTT_QUEUE_SIZE - count) % MQTT_QUEUE_SIZE;
+    for (int i = 0; i < n; i++) {
+        batch[i] = queue[(tail + i) % MQTT_QUEUE_SIZE];
+    }
+    portEXIT_CRITICAL(&queueLock);
+    return n;
+}
+
+void MqttPublisher::commit(uint32_t lastSequence) {
+    // Records may have been dropped meanwhile, so remove by sequence number
+    portENTER_CRITICAL(&queueLock);
+    while (count > 0) {
+        int tail = (head + MQTT_QUEUE_SIZE - count) % MQTT_QUEUE_SIZE;
+        if ((int32_t)(queue[tail].sequence - lastSequence) > 0) break;
+        count--;
+    }
+    portEXIT_CRITICAL(&queueLock);
+}
+
+bool MqttPublisher::ensureConnected() {
+    connected = client.connected();
+    if (connected) return true;
+
+    // Exponential back-off between attempts
+    if (lastAttemptMs != 0 && millis() - lastAttemptMs < reconnectDelay) return false;
+    lastAttemptMs = millis();
+
+    char clientId[32];
+    snprintf(clientId, sizeof(clientId), "solar-monitor-%s", unitId);
+    if (client.connect(clientId)) {
+        reconnects++;
+        reconnectDelay = MQTT_RECONNECT_MIN;
+        connected = true;
+        Serial.println("MQTT connected");
+        return true;
+    }
+
+    reconnectDelay = min((uint32_t)MQTT_RECONNECT_MAX, reconnectDelay * 2);
+    return false;
+}
+
+void MqttPublisher::publishPending() {
+    MqttSample batch[MQTT_BATCH_SIZE];
+    char payload[MQTT_PAYLOAD_MAX];
+
+    // Full batches only, except when the oldest record has waited a whole batch period
+    while (true) {
+        int n = peekBatch(batch, MQTT_BATCH_SIZE);
+        if (n == 0) return;
+        if (n < MQTT_BATCH_SIZE && millis() - batch[0].timeMs < (uint32_t)MQTT_BATCH_SIZE * MQTT_SAMPLE_PERIOD) return;
+
+        size_t length = encodeBatch(unitId, batch, n, payload, sizeof(payload));
+        if (length == 0 || !client.publish(topic, (const uint8_t*)payload, length)) {
+            // Socket not accepting data: keep the records, retry on the next pass
+            failures++;
+            return;
+        }
+
+        commit(batch[n - 1].sequence);
+        messages++;
+        published += n;
+        bytes += length;
+
+        // Back-pressure while catching up: one message per interval, keep-alive in between
+        client.loop();
+        vTaskDelay(pdMS_TO_TICKS(MQTT_DRAIN_INTERVAL));
+    }
+}
+
+void MqttPublisher::service() {
+    if (ensureConnected()) {
+        client.loop();
+        publishPending();
+    }
+}
+
+void MqttPublisher::taskEntry(void* param) {
+    MqttPublisher* publisher = (MqttPublisher*)param;
+    while (true) {
+        publisher->service();
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+size_t MqttPublisher::encodeBatch(const char* unitId, const MqttSample* samples, int count, char* out, size_t size) {
+    if (count <= 0) return 0;
+
+    // {"id":..,"t0":ms,"dt":[..],"v":[..],...,"tot":{..}} - one array per field,
+    // times relative to the first sample, totals of the newest record only
+    size_t used = 0;
+    auto append = [&](const char* format, auto... values) {
+        if (used >= size) return;
+        int written = snprintf(out + used, size - used, format, values...);
+        used = written < 0 ? size : used + written;
+    };
+    auto column = [&](const char* key, float MqttSample::*field, const char* format) {
+        append(",\"%s\":[", key);
+        for (int i = 0; i < count; i++) {
+            if (i > 0) append(",");
+            append(format, (double)(samples[i].*field));
+        }
+        append("]");
+    };
+
+    append("{\"id\":\"%s\",\"t0\":%lu,\"dt\":[", unitId, (unsigned long)samples[0].timeMs);
+    for (int i = 0; i < count; i++) {
+        append(i > 0 ? ",%lu" : "%lu", (unsigned long)(samples[i].timeMs - samples[0].timeMs));
+    }
+    append("]");
+    column("v", &MqttSample::voltage, "%.2f");
+    column("i", &MqttSample::current, "%.2f");
+    column("gen", &MqttSample::powerGenerated, "%.1f");
+    column("load", &MqttSample::powerLoad, "%.1f");
+    column("soc", &MqttSample::batteryLevel, "%.1f");
+    column("inaV", &MqttSample::inaVoltage, "%.3f");
+    column("inaI", &MqttSample::inaCurrentMean, "%.2f");
+    column("inaImin", &MqttSample::inaCurrentMin, "%.2f");
+    column("inaImax", &MqttSample::inaCurrentMax, "%.2f");
+
+    const EnergyTotals& totals = samples[count - 1].totals;
+    append(",\"tot\":{\"gen\":%.3f,\"use\":%.3f,\"imp\":%.3f,\"exp\":%.3f}}",
+           (double)totals.generated, (double)totals.consumed, (double)totals.fromGrid, (double)totals.toGrid);
+
+    return used < size ? used : 0;
+}
+
+String MqttPublisher::getJson() {
+    portENTER_CRITICAL(&queueLock);
+    int queued = count;
+    portEXIT_CRITICAL(&queueLock);
+
+    String json = "{";
+    json += "\"enabled\":" + String(started ? "true" : "false") + ",";
+    json += "\"connected\":" + String(connected ? "true" : "false") + ",";
+    json += "\"broker\":\"" + String(brokerHost ? brokerHost : "") + ":" + String(brokerPort) + "\",";
+    json += "\"topic\":\"" + String(topic) + "\",";
+    json += "\"queued\":" + String(queued) + ",";
+    json += "\"capacity\":" + String(MQTT_QUEUE_SIZE) + ",";
+    json += "\"dropped\":" + String(dropped) + ",";
+    json += "\"messages\":" + String(messages) + ",";
+    json += "\"samples\":" + String(published) + ",";
+    json += "\"bytes\":" + String(bytes) + ",";
+    json += "\"failures\":" + String(failures) + ",";
+    json += "\"reconnects\":" + String(reconnects);
+    json += "}";
+    return json;
+}
+
+String MqttPublisher::benchmark(int samples) {
+    // Encode synthetic batches the way the task does; heap is sampled around it
+    uint32_t freeBefore = ESP.getFreeHeap();
+    MqttSample batch[MQTT_BATCH_SIZE];
+    char payload[MQTT_PAYLOAD_MAX];
+
+    for (int i = 0; i < MQTT_BATCH_SIZE; i++) {
+        MqttSample& record = batch[i];
+        record.sequence = i;
+        record.timeMs = 100000 + i * MQTT_SAMPLE_PERIOD;
+        record.voltage = 190.0 + i;
+        record.current = 12.5;
+        record.powerGenerated = 2375.0 + i;
+        record.powerLoad = 1250.0;
+        record.batteryLevel = 64.2;
+        record.inaVoltage = 4.987;
+        record.inaCurrentMean = 83.41;
+        record.inaCurrentMin = 80.02;
+        record.inaCurrentMax = 86.75;
+        record.totals = {12.345, 9.876, 1.234, 3.456};
+    }
+
+    int batches = max(1, samples / MQTT_BATCH_SIZE);
+    size_t totalBytes = 0;
+    uint32_t startUs = micros();
+    for (int b = 0; b < batches; b++) {
+        totalBytes += encodeBatch("benchmark", batch, MQTT_BATCH_SIZE, payload, sizeof(payload));
+    }
+    uint32_t elapsedUs = micros() - startUs;
+    uint32_t encodedSamples = batches * MQTT_BATCH_SIZE;
+
+    String json = "{";
+    json += "\"samples\":" + String(encodedSamples) + ",";
+    json += "\"elapsedUs\":" + String(elapsedUs) + ",";
+    json += "\"samplesPerSecond\":" + String(elapsedUs > 0 ? encodedSamples * 1000000.0 / elapsedUs : 0.0, 0) + ",";
+    json += "\"bytesPerSample\":" + String((float)totalBytes / encodedSamples, 1) + ",";
+    json += "\"recordBytes\":" + String(sizeof(MqttSample)) + ",";
+    json += "\"queueBytes\":" + String(MQTT_QUEUE_SIZE * sizeof(MqttSample)) + ",";
+    json += "\"heapDelta\":" + String((int32_t)(freeBefore - ESP.getFreeHeap())) + ",";
+    json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
+    json += "\"minFreeHeap\":" + String(ESP.getMinFreeHeap());
+    json += "}";
+    return json;
+}
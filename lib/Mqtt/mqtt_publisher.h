@@ -0,0 +1,87 @@
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "config.h"
+#include "simulation.h"
+
+// One queued telemetry record: simulation state, INA aggregates, run totals
+struct MqttSample {
+    uint32_t sequence;
+    uint32_t timeMs;
+    float voltage;           // V
+    float current;           // A
+    float powerGenerated;    // W
+    float powerLoad;         // W
+    float batteryLevel;      // %
+    float inaVoltage;        // Mean bus voltage since the previous record, V
+    float inaCurrentMean;    // mA
+    float inaCurrentMin;
+    float inaCurrentMax;
+    EnergyTotals totals;     // kWh
+};
+
+// Batched MQTT telemetry. Sampling only copies into a bounded queue; connecting
+// and publishing run in their own task so a slow or missing broker never blocks
+// the main loop.
+class MqttPublisher {
+public:
+    MqttPublisher(Simulation* simulationRef);
+    bool begin(const char* broker, uint16_t port);
+    void addInaReading(float voltage, float currentMa);  // Sensor job, every reading
+    void sample();                                       // Queue one record (scheduler job)
+
+    String getJson();
+    String benchmark(int samples);  // Encode throughput and heap use, no network
+
+    // Columnar JSON batch, returns bytes written (0 if it does not fit)
+    static size_t encodeBatch(const char* unitId, const MqttSample* samples, int count, char* out, size_t size);
+
+    // Queue consumer side, run by the publish task (called directly by the host tests)
+    int peekBatch(MqttSample* batch, int maxCount);
+    void commit(uint32_t lastSequence);
+    void service();  // One task pass: connect if needed, publish what is due
+
+private:
+    Simulation* simulation;
+    WiFiClient network;
+    PubSubClient client;
+    const char* brokerHost;
+    uint16_t brokerPort;
+    char unitId[12];
+    char topic[48];
+    bool started;
+    volatile bool connected;  // Written by the task only, client is not shared
+
+    // Bounded ring, oldest record dropped when full
+    MqttSample* queue;
+    uint16_t head;
+    uint16_t count;
+    uint32_t nextSequence;
+    portMUX_TYPE queueLock;
+
+    // INA aggregates since the last record
+    float inaVoltageSum;
+    float inaCurrentSum;
+    float inaCurrentMin;
+    float inaCurrentMax;
+    uint16_t inaReadings;
+
+    // Statistics
+    uint32_t dropped;
+    uint32_t messages;
+    uint32_t published;      // Samples
+    uint32_t bytes;
+    uint32_t failures;       // Publish calls rejected by the client
+    uint32_t reconnects;
+    uint32_t reconnectDelay;
+    unsigned long lastAttemptMs;
+
+    bool ensureConnected();
+    void publishPending();
+    static void taskEntry(void* param);
+};
+
+#endif // MQTT_PUBLISHER_H
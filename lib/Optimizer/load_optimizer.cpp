@@ -0,0 +1,207 @@
+#include "load_optimizer.h"
+#include "psram_alloc.h"
+
+#define JOB_STATES_INFEASIBLE 0xFF
+
+namespace {
+
+// One hour of the battery model of Simulation::calculateBattery():
+// 85% charging efficiency, surplus above full goes to the grid, deficit below empty comes from it
+inline void batteryHour(float& energyWh, float netWh, float capacityWh, float& importWh, float& exportWh) {
+    importWh = 0.0f;
+    exportWh = 0.0f;
+    if (capacityWh <= 0.0f) {
+        if (netWh < 0.0f) importWh = -netWh;
+        else exportWh = netWh;
+        return;
+    }
+    energyWh += netWh > 0.0f ? netWh * 0.85f : netWh;
+    if (energyWh < 0.0f) {
+        importWh = -energyWh;
+        energyWh = 0.0f;
+    } else if (energyWh > capacityWh) {
+        exportWh = energyWh - capacityWh;
+        energyWh = capacityWh;
+    }
+}
+
+inline float hourCost(OptimizerObjective objective, const LoadForecast& forecast, int slot, float importWh, float exportWh) {
+    if (objective == OPTIMIZE_AUTARKY) return importWh;
+    return (importWh * forecast.importRate[slot] - exportWh * forecast.exportRate[slot]) / 1000.0f;
+}
+
+}  // namespace
+
+LoadOptimizer::LoadOptimizer() : decisions(nullptr), value(nullptr), valueNext(nullptr) {
+}
+
+LoadOptimizer::~LoadOptimizer() {
+    free(decisions);
+    free(value);
+    free(valueNext);
+}
+
+bool LoadOptimizer::begin() {
+    // Fixed worst-case tables, allocated once: solving never touches the heap
+    size_t states = OPTIMIZER_MAX_JOB_STATES * OPTIMIZER_SOC_BUCKETS;
+    decisions = (uint8_t*)allocateLarge(OPTIMIZER_HOURS * states);
+    value = (float*)malloc(states * sizeof(float));
+    valueNext = (float*)malloc(states * sizeof(float));
+    if (decisions == nullptr || value == nullptr || valueNext == nullptr) {
+        Serial.println("Load optimizer: out of memory");
+        return false;
+    }
+    return true;
+}
+
+bool LoadOptimizer::solve(const LoadForecast& forecast, OptimizerObjective objective, LoadPlan& plan) {
+    plan.valid = false;
+    plan.solveUs = 0;
+    if (decisions == nullptr || forecast.jobCount > OPTIMIZER_MAX_JOBS) return false;
+    uint32_t startUs = micros();
+    
+    // Job progress in mixed radix: digit j = hours job j still has to run (hours..0)
+    int jobCount = forecast.jobCount;
+    int radix[OPTIMIZER_MAX_JOBS];
+    int jobStates = 1;
+    for (int j = 0; j < jobCount; j++) {
+        radix[j] = jobStates;
+        jobStates *= forecast.jobs[j].hours + 1;
+    }
+    if (jobStates > OPTIMIZER_MAX_JOB_STATES) return false;
+    int startState = 0;
+    for (int j = 0; j < jobCount; j++) startState += forecast.jobs[j].hours * radix[j];
+    
+    // SoC grid
+    bool battery = forecast.capacityWh > 0.0f;
+    int buckets = battery ? OPTIMIZER_SOC_BUCKETS : 1;
+    float bucketWh = battery ? forecast.capacityWh / (buckets - 1) : 0.0f;
+    const float infeasible = 1e30f;
+    
+    // Transition of one hour: jobs started in `starts`, false if not allowed
+    auto transition = [&](int slot, int state, int starts, int& nextState, float& deferredWatts, uint8_t& runningLoads) {
+        int hour = (forecast.firstHour + slot) % 24;
+        nextState = 0;
+        deferredWatts = 0.0f;
+        runningLoads = 0;
+        for (int j = 0; j < jobCount; j++) {
+            const DeferrableLoad& job = forecast.jobs[j];
+            int remaining = (state / radix[j]) % (job.hours + 1);
+            bool start = starts & (1 << j);
+            bool runs = false;
+            if (remaining == job.hours) {
+                if (start) {
+                    if (hour < job.earliest || hour + job.hours > job.deadline) return false;
+                    runs = true;
+                } else if (hour + job.hours >= job.deadline) {
+                    return false;  // Last possible start has passed
+                }
+            } else if (start) {
+                return false;
+            } else {
+                runs = remaining > 0;  // Runs are not interrupted
+            }
+            if (runs) {
+                // One appliance cannot run two jobs at once
+                if (runningLoads & (1 << job.load)) return false;
+                runningLoads |= 1 << job.load;
+                deferredWatts += forecast.jobWatts[j];
+                remaining--;
+            }
+            nextState += remaining * radix[j];
+        }
+        return true;
+    };
+    
+    // Terminal: every job must have finished
+    for (int state = 0; state < jobStates; state++) {
+        for (int b = 0; b < buckets; b++) {
+            valueNext[state * buckets + b] = state == 0 ? 0.0f : infeasible;
+        }
+    }
+    
+    int startOptions = 1 << jobCount;
+    for (int slot = OPTIMIZER_HOURS - 1; slot >= 0; slot--) {
+        uint8_t* decision = decisions + (size_t)slot * jobStates * buckets;
+        for (int state = 0; state < jobStates; state++) {
+            for (int b = 0; b < buckets; b++) {
+                float best = infeasible;
+                uint8_t bestStarts = JOB_STATES_INFEASIBLE;
+                for (int starts = 0; starts < startOptions; starts++) {
+                    int nextState;
+                    float deferredWatts;
+                    uint8_t runningLoads;
+                    if (!transition(slot, state, starts, nextState, deferredWatts, runningLoads)) continue;
+                    
+                    float energyWh = b * bucketWh;
+                    float importWh, exportWh;
+                    float netWh = forecast.generated[slot] - forecast.baseLoad[slot] - deferredWatts;
+                    batteryHour(energyWh, netWh, forecast.capacityWh, importWh, exportWh);
+                    int nextBucket = battery ? (int)(energyWh / bucketWh + 0.5f) : 0;
+                    
+                    float cost = hourCost(objective, forecast, slot, importWh, exportWh) + valueNext[nextState * buckets + nextBucket];
+                    if (cost < best) {
+                        best = cost;
+                        bestStarts = starts;
+                    }
+                }
+                value[state * buckets + b] = best;
+                decision[state * buckets + b] = bestStarts;
+            }
+        }
+        float* swap = value;
+        value = valueNext;
+        valueNext = swap;
+    }
+    
+    // Replay the decisions from the initial SoC
+    int state = startState;
+    int bucket = battery ? constrain((int)(forecast.initialSoC / 100.0f * (buckets - 1) + 0.5f), 0, buckets - 1) : 0;
+    if (valueNext[state * buckets + bucket] >= infeasible) {
+        plan.solveUs = micros() - startUs;
+        return false;
+    }
+    
+    float loadWatts[OPTIMIZER_HOURS];
+    memset(plan.loads, 0, sizeof(plan.loads));
+    plan.controlled = 0;
+    for (int j = 0; j < jobCount; j++) plan.controlled |= 1 << forecast.jobs[j].load;
+    
+    for (int slot = 0; slot < OPTIMIZER_HOURS; slot++) {
+        uint8_t starts = decisions[((size_t)slot * jobStates + state) * buckets + bucket];
+        int nextState;
+        float deferredWatts;
+        uint8_t runningLoads;
+        transition(slot, state, starts, nextState, deferredWatts, runningLoads);
+        plan.loads[(forecast.firstHour + slot) % 24] = runningLoads;
+        loadWatts[slot] = forecast.baseLoad[slot] + deferredWatts;
+        
+        if (battery) {
+            float energyWh = bucket * bucketWh;
+            float importWh, exportWh;
+            batteryHour(energyWh, forecast.generated[slot] - loadWatts[slot], forecast.capacityWh, importWh, exportWh);
+            bucket = (int)(energyWh / bucketWh + 0.5f);
+        }
+        state = nextState;
+    }
+    
+    // Report energy with the continuous SoC, like the simulation will see it
+    evaluate(forecast, loadWatts, plan);
+    plan.valid = true;
+    plan.solveUs = micros() - startUs;
+    return true;
+}
+
+void LoadOptimizer::evaluate(const LoadForecast& forecast, const float* loadWatts, LoadPlan& result) {
+    float energyWh = forecast.initialSoC / 100.0f * forecast.capacityWh;
+    result.importKWh = 0.0f;
+    result.exportKWh = 0.0f;
+    result.cost = 0.0f;
+    for (int slot = 0; slot < OPTIMIZER_HOURS; slot++) {
+        float importWh, exportWh;
+        batteryHour(energyWh, forecast.generated[slot] - loadWatts[slot], forecast.capacityWh, importWh, exportWh);
+        result.importKWh += importWh / 1000.0f;
+        result.exportKWh += exportWh / 1000.0f;
+        result.cost += hourCost(OPTIMIZE_COST, forecast, slot, importWh, exportWh);
+    }
+}
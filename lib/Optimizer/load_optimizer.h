@@ -0,0 +1,64 @@
+#ifndef LOAD_OPTIMIZER_H
+#define LOAD_OPTIMIZER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum OptimizerObjective {
+    OPTIMIZE_AUTARKY,        // Minimize energy drawn from the grid
+    OPTIMIZE_COST            // Minimize import cost minus export revenue
+};
+
+// Appliance that must run once for `hours` consecutive hours inside [earliest, deadline)
+struct DeferrableLoad {
+    uint8_t load;            // Index into LOAD_TABLE
+    uint8_t hours;
+    uint8_t earliest;        // Hour of day
+    uint8_t deadline;        // Hour of day by which the run has finished
+};
+
+// Inputs for one planning horizon of OPTIMIZER_HOURS hours (index 0 = firstHour)
+struct LoadForecast {
+    int firstHour;                       // Hour of day of slot 0
+    float generated[OPTIMIZER_HOURS];    // Expected generation, W
+    float baseLoad[OPTIMIZER_HOURS];     // Loads that are not shifted, W
+    float importRate[OPTIMIZER_HOURS];   // Per kWh
+    float exportRate[OPTIMIZER_HOURS];
+    float capacityWh;                    // 0 = no battery
+    float initialSoC;                    // %
+    const DeferrableLoad* jobs;
+    int jobCount;
+    float jobWatts[OPTIMIZER_MAX_JOBS];
+};
+
+// Optimized schedule of the deferrable loads
+struct LoadPlan {
+    bool valid;
+    uint8_t controlled;                  // Load bits set by the plan (others follow the fixed schedule)
+    uint8_t loads[24];                   // Load bits on, per hour of day
+    float importKWh;                     // Expected over the horizon
+    float exportKWh;
+    float cost;                          // Import cost minus export revenue
+    uint32_t solveUs;
+};
+
+// Dynamic program over (hour, battery SoC bucket, job progress). Cost-to-go is
+// computed backwards with two value layers; only the chosen start decisions are
+// kept per state, and the plan is replayed forwards from the initial SoC.
+class LoadOptimizer {
+public:
+    LoadOptimizer();
+    ~LoadOptimizer();
+    bool begin();
+    bool solve(const LoadForecast& forecast, OptimizerObjective objective, LoadPlan& plan);
+
+    // Energy and cost of a given total load per slot, same battery model (continuous SoC)
+    static void evaluate(const LoadForecast& forecast, const float* loadWatts, LoadPlan& result);
+
+private:
+    uint8_t* decisions;      // [hour][job state][SoC bucket]: jobs started, 0xFF = infeasible
+    float* value;            // Cost-to-go of the next hour [job state][SoC bucket]
+    float* valueNext;
+};
+
+#endif // LOAD_OPTIMIZER_H
@@ -0,0 +1,168 @@
+#include "replay_source.h"
+
+ReplaySource::ReplaySource()
+    : active(false), binary(false), loop(false), speed(1.0), startMs(0), firstMs(0), finished(false), recordCount(0), skippedLines(0), hasNext(false) {
+    current = {0, 0.0, 0.0, 0.0};
+    next = current;
+}
+
+bool ReplaySource::start(const char* path, float speed, bool loop) {
+    stop();
+
+    file = LittleFS.open(path, "r");
+    if (!file) {
+        Serial.print("Replay: cannot open ");
+        Serial.println(path);
+        return false;
+    }
+
+    // Binary traces start with the magic word, everything else is parsed as CSV
+    uint32_t header[2] = {0, 0};
+    binary = file.read((uint8_t*)header, sizeof(header)) == sizeof(header) &&
+             header[0] == TRACE_MAGIC && header[1] == TRACE_VERSION;
+
+    this->speed = speed > 0.0 ? speed : 1.0;
+    this->loop = loop;
+    skippedLines = 0;
+
+    if (!rewind()) {
+        Serial.println("Replay: trace contains no records");
+        file.close();
+        return false;
+    }
+
+    active = true;
+    Serial.print("Replay started: ");
+    Serial.print(path);
+    Serial.print(binary ? " (binary)" : " (CSV)");
+    Serial.print(" at ");
+    Serial.print(this->speed, 1);
+    Serial.println("x");
+    return true;
+}
+
+void ReplaySource::stop() {
+    if (file) file.close();
+    if (active) Serial.println("Replay stopped");
+    active = false;
+}
+
+bool ReplaySource::isActive() {
+    return active;
+}
+
+bool ReplaySource::isFound() {
+    return active;
+}
+
+float ReplaySource::getBusVoltage() {
+    advance();
+    return current.voltage;
+}
+
+float ReplaySource::getCurrent() {
+    advance();
+    return current.current;
+}
+
+float ReplaySource::getPower() {
+    advance();
+    return current.power;
+}
+
+void ReplaySource::advance() {
+    if (!active || finished) return;
+
+    // Trace time that corresponds to now, always measured from the fixed start
+    // so rounding never accumulates across records
+    uint32_t traceMs = firstMs + (uint32_t)((double)(millis() - startMs) * speed);
+
+    // Skip every record that is already due, keeping only one lookahead
+    while (hasNext && next.timeMs <= traceMs) {
+        current = next;
+        recordCount++;
+        hasNext = readRecord(next);
+    }
+
+    if (!hasNext) {
+        if (loop) {
+            rewind();
+        } else {
+            finished = true;
+            Serial.println("Replay finished");
+        }
+    }
+}
+
+bool ReplaySource::rewind() {
+    file.seek(binary ? 2 * sizeof(uint32_t) : 0);
+    recordCount = 0;
+    finished = false;
+
+    if (!readRecord(current)) return false;
+    hasNext = readRecord(next);
+    firstMs = current.timeMs;
+    startMs = millis();
+    return true;
+}
+
+bool ReplaySource::readRecord(TraceRecord& record) {
+    return binary ? readBinaryRecord(record) : readCsvRecord(record);
+}
+
+bool ReplaySource::readBinaryRecord(TraceRecord& record) {
+    return file.read((uint8_t*)&record, sizeof(record)) == sizeof(record);
+}
+
+bool ReplaySource::readCsvRecord(TraceRecord& record) {
+    while (file.available()) {
+        // Whole lines only: one that does not fit the buffer is read to its end and skipped
+        size_t length = 0;
+        bool overlong = false;
+        int c;
+        while ((c = file.read()) >= 0 && c != '\n') {
+            if (length < sizeof(lineBuffer) - 1) {
+                lineBuffer[length++] = (char)c;
+            } else {
+                overlong = true;
+            }
+        }
+        lineBuffer[length] = '\0';
+        if (overlong) {
+            skippedLines++;
+            continue;
+        }
+
+        // Skip header and comment lines
+        if (lineBuffer[0] < '0' || lineBuffer[0] > '9') continue;
+
+        unsigned long timeMs = 0;
+        float voltage = 0.0, currentMA = 0.0, powerMW = 0.0;
+        int fields = sscanf(lineBuffer, "%lu,%f,%f,%f", &timeMs, &voltage, &currentMA, &powerMW);
+        if (fields < 3) {
+            skippedLines++;
+            continue;
+        }
+
+        record.timeMs = timeMs;
+        record.voltage = voltage;
+        record.current = currentMA;
+        record.power = fields == 4 ? powerMW : voltage * currentMA;
+        return true;
+    }
+    return false;
+}
+
+String ReplaySource::getStatusJson() {
+    String json = "{";
+    json += "\"active\":" + String(active ? "true" : "false") + ",";
+    json += "\"format\":\"" + String(binary ? "binary" : "csv") + "\",";
+    json += "\"speed\":" + String(speed, 2) + ",";
+    json += "\"loop\":" + String(loop ? "true" : "false") + ",";
+    json += "\"finished\":" + String(finished ? "true" : "false") + ",";
+    json += "\"records\":" + String(recordCount) + ",";
+    json += "\"skippedLines\":" + String(skippedLines) + ",";
+    json += "\"traceMs\":" + String(current.timeMs);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,60 @@
+#ifndef REPLAY_SOURCE_H
+#define REPLAY_SOURCE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "sample_source.h"
+
+// Binary trace: "SMTR" magic + version, followed by packed records
+#define TRACE_MAGIC 0x52544D53  // "SMTR" little endian
+#define TRACE_VERSION 1
+
+struct TraceRecord {
+    uint32_t timeMs;   // Time since trace start
+    float voltage;     // V
+    float current;     // mA
+    float power;       // mW
+};
+
+// Streams a recorded INA219 trace from LittleFS, one record ahead
+// CSV lines: time_ms,voltage_V,current_mA,power_mW (header lines are skipped)
+// Without loop the last record is held once the trace has run out
+class ReplaySource : public SampleSource {
+public:
+    ReplaySource();
+    bool start(const char* path, float speed, bool loop);
+    void stop();
+    bool isActive();
+
+    // SampleSource
+    bool isFound() override;
+    float getBusVoltage() override;
+    float getCurrent() override;
+    float getPower() override;
+
+    String getStatusJson();
+
+private:
+    File file;
+    bool active;
+    bool binary;
+    bool loop;
+    float speed;            // 1.0 = original speed
+    unsigned long startMs;  // millis() when the first record was presented
+    uint32_t firstMs;       // Trace time of the first record
+    bool finished;          // End of a non-looped trace reached, last record held
+    uint32_t recordCount;   // Records consumed so far
+    uint32_t skippedLines;  // CSV data lines too long for lineBuffer or with too few fields
+    TraceRecord current;    // Record currently presented
+    TraceRecord next;       // Lookahead record
+    bool hasNext;
+    char lineBuffer[80];
+
+    void advance();
+    bool rewind();
+    bool readRecord(TraceRecord& record);
+    bool readBinaryRecord(TraceRecord& record);
+    bool readCsvRecord(TraceRecord& record);
+};
+
+#endif // REPLAY_SOURCE_H
@@ -0,0 +1,264 @@
+#include "rollup_store.h"
+#include "psram_alloc.h"
+#include <esp_timer.h>
+
+static const uint32_t TIER_SECONDS[ROLLUP_TIERS] = {1, 60, 3600};
+
+RollupStore::RollupStore() : lastSampleMs(0), hasSample(false), samples(0) {
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        rings[t].buckets = nullptr;
+        rings[t].capacity = 0;
+        rings[t].head = 0;
+        rings[t].count = 0;
+        rings[t].dropped = 0;
+        open[t].samples = 0;
+    }
+}
+
+bool RollupStore::begin() {
+    // Full retention in PSRAM when fitted, short rings in internal RAM otherwise
+    const int capacities[ROLLUP_TIERS] = {ROLLUP_SECONDS, ROLLUP_MINUTES, ROLLUP_HOURS};
+    const int internal[ROLLUP_TIERS] = {ROLLUP_SECONDS_INTERNAL, ROLLUP_MINUTES_INTERNAL, ROLLUP_HOURS_INTERNAL};
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        Ring& ring = rings[t];
+        bool inPsram = false;
+        ring.buckets = (RollupBucket*)allocateLarge(capacities[t] * sizeof(RollupBucket), internal[t] * sizeof(RollupBucket), &inPsram);
+        ring.capacity = inPsram ? capacities[t] : internal[t];
+        if (ring.buckets == nullptr) {
+            Serial.println("Rollup: out of memory");
+            ring.capacity = 0;
+            return false;
+        }
+    }
+    
+    Serial.print("Rollup: retention ");
+    Serial.print(rings[ROLLUP_SECOND].capacity);
+    Serial.print(" s, ");
+    Serial.print(rings[ROLLUP_MINUTE].capacity / 60);
+    Serial.print(" h, ");
+    Serial.print(rings[ROLLUP_HOUR].capacity / 24);
+    Serial.println(" days");
+    return true;
+}
+
+uint32_t RollupStore::now() {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+const char* RollupStore::tierName(RollupTier tier) {
+    switch (tier) {
+        case ROLLUP_MINUTE: return "minute";
+        case ROLLUP_HOUR: return "hour";
+        default: return "second";
+    }
+}
+
+void RollupStore::merge(RollupBucket& into, const RollupBucket& bucket) {
+    if (bucket.samples == 0) return;
+    if (into.samples == 0) {
+        into.samples = 0;
+        into.energy = 0.0;
+        for (int c = 0; c < ROLLUP_CHANNELS; c++) {
+            into.min[c] = bucket.min[c];
+            into.max[c] = bucket.max[c];
+            into.mean[c] = 0.0;
+        }
+    }
+    for (int c = 0; c < ROLLUP_CHANNELS; c++) {
+        into.min[c] = min(into.min[c], bucket.min[c]);
+        into.max[c] = max(into.max[c], bucket.max[c]);
+        into.mean[c] += bucket.mean[c] * bucket.samples;
+    }
+    into.samples += bucket.samples;
+    into.energy += bucket.energy;
+}
+
+void RollupStore::finish(const RollupBucket& open, RollupBucket& bucket) {
+    bucket = open;
+    for (int c = 0; c < ROLLUP_CHANNELS; c++) {
+        bucket.mean[c] = open.samples > 0 ? open.mean[c] / open.samples : 0.0f;
+    }
+}
+
+void RollupStore::push(int tier, const RollupBucket& bucket) {
+    Ring& ring = rings[tier];
+    if (ring.capacity == 0) return;
+    ring.buckets[ring.head] = bucket;
+    ring.head = (ring.head + 1) % ring.capacity;
+    if (ring.count < ring.capacity) {
+        ring.count++;
+    } else {
+        ring.dropped++;
+    }
+}
+
+void RollupStore::close(int tier) {
+    RollupBucket bucket;
+    finish(open[tier], bucket);
+    push(tier, bucket);
+    open[tier].samples = 0;
+    
+    // One level up: the coarser bucket starts with its first finer bucket
+    if (tier + 1 < ROLLUP_TIERS) {
+        RollupBucket& parent = open[tier + 1];
+        if (parent.samples == 0) parent.start = bucket.start / TIER_SECONDS[tier + 1] * TIER_SECONDS[tier + 1];
+        merge(parent, bucket);
+    }
+}
+
+void RollupStore::addSample(const InaSample& sample) {
+    if (sample.overflow) return;  // Current and power invalid
+    uint32_t second = now();
+    
+    // Close every open bucket the sample no longer falls into, finest first, so
+    // each closed bucket reaches its parent before the parent is checked
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        if (open[t].samples > 0 && second / TIER_SECONDS[t] != open[t].start / TIER_SECONDS[t]) close(t);
+    }
+    
+    float values[ROLLUP_CHANNELS] = {sample.voltage, sample.current, sample.power / 1000.0f};
+    RollupBucket& bucket = open[ROLLUP_SECOND];
+    if (bucket.samples == 0) {
+        bucket.start = second;
+        bucket.energy = 0.0;
+        for (int c = 0; c < ROLLUP_CHANNELS; c++) {
+            bucket.min[c] = values[c];
+            bucket.max[c] = values[c];
+            bucket.mean[c] = 0.0;
+        }
+    }
+    for (int c = 0; c < ROLLUP_CHANNELS; c++) {
+        bucket.min[c] = min(bucket.min[c], values[c]);
+        bucket.max[c] = max(bucket.max[c], values[c]);
+        bucket.mean[c] += values[c];
+    }
+    bucket.samples++;
+    
+    // Energy over the interval since the previous sample; a long gap is missing data
+    uint32_t elapsedMs = sample.timeMs - lastSampleMs;
+    if (hasSample && elapsedMs <= ROLLUP_MAX_GAP_MS) {
+        bucket.energy += values[ROLLUP_POWER] * elapsedMs / 3600000.0f;
+    }
+    lastSampleMs = sample.timeMs;
+    hasSample = true;
+    samples++;
+}
+
+const RollupBucket& RollupStore::at(int tier, int position) {
+    const Ring& ring = rings[tier];
+    return ring.buckets[(ring.head - ring.count + position + ring.capacity) % ring.capacity];
+}
+
+int RollupStore::firstAtOrAfter(int tier, uint32_t second) {
+    int low = 0;
+    int high = rings[tier].count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (at(tier, middle).start < second) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+bool RollupStore::covers(int tier, uint32_t second) {
+    // Nothing dropped yet: the tier reaches back to boot like the finer ones
+    const Ring& ring = rings[tier];
+    return ring.dropped == 0 || (ring.count > 0 && at(tier, 0).start <= second);
+}
+
+RollupTier RollupStore::selectTier(uint32_t fromSec, uint32_t width) {
+    // Coarsest tier that resolves the width and still holds the start of the range
+    for (int t = ROLLUP_TIERS - 1; t >= 0; t--) {
+        if (TIER_SECONDS[t] <= width && covers(t, fromSec)) return (RollupTier)t;
+    }
+    // Otherwise the finest one that holds it, or the longest retention
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        if (covers(t, fromSec)) return (RollupTier)t;
+    }
+    return ROLLUP_HOUR;
+}
+
+int RollupStore::query(uint32_t fromSec, uint32_t toSec, int points, RollupTier& tier, uint32_t& width, const RollupCallback& emit) {
+    if (toSec <= fromSec || points < 1) return 0;
+    width = max((uint32_t)1, (toSec - fromSec + points - 1) / points);
+    tier = selectTier(fromSec, width);
+    uint32_t tierSeconds = TIER_SECONDS[tier];
+    
+    // Output buckets are whole multiples of the tier, aligned to it
+    width = max(tierSeconds, (width + tierSeconds - 1) / tierSeconds * tierSeconds);
+    fromSec = fromSec / tierSeconds * tierSeconds;
+    
+    RollupBucket output;
+    output.samples = 0;
+    uint32_t outputIndex = 0;
+    int sent = 0;
+    auto add = [&](const RollupBucket& bucket) {
+        if (bucket.start < fromSec || bucket.start >= toSec) return true;
+        uint32_t index = (bucket.start - fromSec) / width;
+        if (output.samples > 0 && index != outputIndex) {
+            RollupBucket finished;
+            finish(output, finished);
+            output.samples = 0;
+            if (!emit(finished)) return false;
+            sent++;
+        }
+        if (output.samples == 0) {
+            outputIndex = index;
+            output.start = fromSec + index * width;
+        }
+        merge(output, bucket);
+        return true;
+    };
+    
+    int count = rings[tier].count;
+    for (int i = firstAtOrAfter(tier, fromSec); i < count; i++) {
+        if (at(tier, i).start >= toSec) break;
+        if (!add(at(tier, i))) return sent;
+    }
+    
+    // The bucket still being filled, plus what the finer tiers have not handed up yet
+    RollupBucket pending;
+    pending.samples = 0;
+    for (int t = tier; t >= 0; t--) {
+        if (open[t].samples == 0) continue;
+        RollupBucket finer;
+        finish(open[t], finer);
+        if (pending.samples == 0) pending.start = finer.start / tierSeconds * tierSeconds;
+        merge(pending, finer);
+    }
+    if (pending.samples > 0) {
+        RollupBucket partial;
+        finish(pending, partial);
+        if (!add(partial)) return sent;
+    }
+    
+    if (output.samples > 0) {
+        RollupBucket finished;
+        finish(output, finished);
+        if (emit(finished)) sent++;
+    }
+    return sent;
+}
+
+String RollupStore::getJson() {
+    String json = "{";
+    json += "\"now\":" + String(now()) + ",";
+    json += "\"samples\":" + String(samples) + ",";
+    json += "\"tiers\":[";
+    for (int t = 0; t < ROLLUP_TIERS; t++) {
+        const Ring& ring = rings[t];
+        if (t > 0) json += ",";
+        json += "{\"name\":\"" + String(tierName((RollupTier)t)) + "\",";
+        json += "\"bucketSeconds\":" + String(TIER_SECONDS[t]) + ",";
+        json += "\"count\":" + String(ring.count) + ",";
+        json += "\"capacity\":" + String(ring.capacity) + ",";
+        json += "\"retentionSeconds\":" + String((uint32_t)ring.capacity * TIER_SECONDS[t]) + ",";
+        json += "\"oldest\":" + String(ring.count > 0 ? at(t, 0).start : 0) + ",";
+        json += "\"dropped\":" + String(ring.dropped) + "}";
+    }
+    json += "]}";
+    return json;
+}
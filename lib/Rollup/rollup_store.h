@@ -0,0 +1,77 @@
+#ifndef ROLLUP_STORE_H
+#define ROLLUP_STORE_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+#include "ina.h"
+
+enum RollupTier {
+    ROLLUP_SECOND,
+    ROLLUP_MINUTE,
+    ROLLUP_HOUR,
+    ROLLUP_TIERS
+};
+
+enum RollupChannel {
+    ROLLUP_VOLTAGE,          // Bus voltage, V
+    ROLLUP_CURRENT,          // mA
+    ROLLUP_POWER,            // W
+    ROLLUP_CHANNELS
+};
+
+// Aggregate of all INA samples in one interval of a tier
+struct RollupBucket {
+    uint32_t start;          // Uptime seconds, aligned to the tier
+    uint32_t samples;
+    float min[ROLLUP_CHANNELS];
+    float max[ROLLUP_CHANNELS];
+    float mean[ROLLUP_CHANNELS];  // Running sum while the bucket is open
+    float energy;            // Wh
+};
+
+// Receives the buckets of a query in time order; returning false stops it
+typedef std::function<bool(const RollupBucket& bucket)> RollupCallback;
+
+// Long-term measurement retention: raw INA samples are reduced into 1 s, 1 min
+// and 1 h buckets, each tier a bounded ring. Every closed bucket is merged into
+// the next coarser one, so the tiers are maintained in O(1) per sample.
+class RollupStore {
+public:
+    RollupStore();
+    bool begin();
+    void addSample(const InaSample& sample);  // Sensor job
+
+    // Buckets of `width` seconds over [from, to), merged from the coarsest tier that
+    // resolves the width and still holds `from`; width and tier are returned
+    int query(uint32_t fromSec, uint32_t toSec, int points, RollupTier& tier, uint32_t& width, const RollupCallback& emit);
+    RollupTier selectTier(uint32_t fromSec, uint32_t width);
+
+    static uint32_t now();  // Uptime seconds (64-bit timer, no millis() wrap)
+    static const char* tierName(RollupTier tier);
+    String getJson();
+
+private:
+    struct Ring {
+        RollupBucket* buckets;
+        int capacity;
+        int head;            // Next write position
+        int count;
+        uint32_t dropped;    // Buckets overwritten (the tier no longer reaches back to boot)
+    };
+    Ring rings[ROLLUP_TIERS];
+    RollupBucket open[ROLLUP_TIERS];  // Accumulating, samples = 0 when empty
+    uint32_t lastSampleMs;
+    bool hasSample;
+    uint32_t samples;
+
+    void close(int tier);
+    void push(int tier, const RollupBucket& bucket);
+    const RollupBucket& at(int tier, int position);  // 0 = oldest
+    int firstAtOrAfter(int tier, uint32_t second);
+    bool covers(int tier, uint32_t second);
+    static void merge(RollupBucket& into, const RollupBucket& bucket);  // Closed bucket into an open one
+    static void finish(const RollupBucket& open, RollupBucket& bucket); // Open bucket to means
+};
+
+#endif // ROLLUP_STORE_H
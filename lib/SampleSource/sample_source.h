@@ -0,0 +1,16 @@
+#ifndef SAMPLE_SOURCE_H
+#define SAMPLE_SOURCE_H
+
+#include <Arduino.h>
+
+// Source of INA219-style measurements (live sensor or recorded trace)
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+    virtual bool isFound() = 0;
+    virtual float getBusVoltage() = 0;  // V
+    virtual float getCurrent() = 0;     // mA
+    virtual float getPower() = 0;       // mW
+};
+
+#endif // SAMPLE_SOURCE_H
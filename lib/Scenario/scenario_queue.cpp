@@ -0,0 +1,282 @@
+#include "scenario_queue.h"
+#include "psram_alloc.h"
+
+ScenarioQueue::ScenarioQueue(Tariff* tariffRef, PvModel* pvRef)
+    : tariff(tariffRef), pv(pvRef), jobs(nullptr), nextId(1), cancelId(0), completed(0), worker(nullptr) {
+    lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool ScenarioQueue::begin() {
+    // Job store and the kernel's day buffers in PSRAM when fitted
+    size_t bytes = SCENARIO_QUEUE_SIZE * sizeof(ScenarioJob);
+    jobs = (ScenarioJob*)allocateLarge(bytes);
+    if (jobs == nullptr) {
+        Serial.println("Scenarios: job store allocation failed");
+        return false;
+    }
+    for (int i = 0; i < SCENARIO_QUEUE_SIZE; i++) jobs[i].status = SCENARIO_FREE;
+    
+    // Below the loop task (priority 1) on the same core: runs only while the
+    // scheduler is idle, sampling and the web server always preempt it
+    if (xTaskCreatePinnedToCore(taskEntry, "scenarios", SCENARIO_WORKER_STACK, this, SCENARIO_WORKER_PRIORITY, &worker, 1) != pdPASS) {
+        Serial.println("Scenarios: worker start failed");
+        return false;
+    }
+    
+    Serial.print("Scenarios: ");
+    Serial.print(SCENARIO_QUEUE_SIZE);
+    Serial.println(" job slots");
+    return true;
+}
+
+int32_t ScenarioQueue::submit(const ScenarioSpec& spec) {
+    if (jobs == nullptr) return -1;
+    
+    portENTER_CRITICAL(&lock);
+    // Free slot, else the oldest finished job
+    ScenarioJob* slot = nullptr;
+    for (int i = 0; i < SCENARIO_QUEUE_SIZE; i++) {
+        ScenarioJob& job = jobs[i];
+        if (job.status == SCENARIO_FREE) {
+            slot = &job;
+            break;
+        }
+        bool finished = job.status != SCENARIO_QUEUED && job.status != SCENARIO_RUNNING;
+        if (finished && (slot == nullptr || job.id < slot->id)) slot = &job;
+    }
+    int32_t id = -1;
+    if (slot != nullptr) {
+        id = nextId++;
+        slot->id = id;
+        slot->status = SCENARIO_QUEUED;
+        slot->spec = spec;
+        slot->progress = 0.0;
+        slot->submittedMs = millis();
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (id > 0) xTaskNotifyGive(worker);
+    return id;
+}
+
+bool ScenarioQueue::cancel(uint32_t id) {
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    ScenarioJob* job = find(id);
+    if (job != nullptr && job->status == SCENARIO_QUEUED) {
+        job->status = SCENARIO_CANCELLED;
+        found = true;
+    } else if (job != nullptr && job->status == SCENARIO_RUNNING) {
+        cancelId = id;  // Seen by the worker at its next step
+        found = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
+
+ScenarioJob* ScenarioQueue::find(uint32_t id) {
+    if (jobs == nullptr) return nullptr;
+    for (int i = 0; i < SCENARIO_QUEUE_SIZE; i++) {
+        if (jobs[i].status != SCENARIO_FREE && jobs[i].id == id) return &jobs[i];
+    }
+    return nullptr;
+}
+
+ScenarioJob* ScenarioQueue::takeNext() {
+    portENTER_CRITICAL(&lock);
+    ScenarioJob* next = nullptr;
+    for (int i = 0; i < SCENARIO_QUEUE_SIZE; i++) {
+        ScenarioJob& job = jobs[i];
+        if (job.status != SCENARIO_QUEUED) continue;
+        if (next == nullptr || job.spec.priority > next->spec.priority ||
+            (job.spec.priority == next->spec.priority && job.id < next->id)) {
+            next = &job;
+        }
+    }
+    // A running slot is never reused, so the worker may keep the pointer
+    if (next != nullptr) next->status = SCENARIO_RUNNING;
+    portEXIT_CRITICAL(&lock);
+    return next;
+}
+
+void ScenarioQueue::finish(ScenarioJob* job, ScenarioStatus status, const ScenarioResult& result) {
+    portENTER_CRITICAL(&lock);
+    job->result = result;
+    job->status = status;
+    if (status == SCENARIO_DONE) job->progress = 1.0;
+    if (cancelId == job->id) cancelId = 0;
+    completed++;
+    portEXIT_CRITICAL(&lock);
+}
+
+ScenarioStatus ScenarioQueue::run(ScenarioJob* job, DayBuffers* buffers, ScenarioResult& result) {
+    const ScenarioSpec& spec = job->spec;
+    
+    // Fresh simulation with the scenario's configuration; the live one is never touched.
+    // No sample source: batch runs only use the sun model or a dataset. No panel array
+    // either: its scratch buffers are used by the main loop, so jobs use identical panels.
+    Simulation run(nullptr, nullptr, tariff, pv);
+    SimulationState state;
+    run.saveState(state);
+    for (int i = 0; i < SIM_PANELS; i++) state.panels[i] = i < spec.panels;
+    for (int i = 0; i < SIM_CELLS; i++) state.cells[i] = i < spec.cells;
+    state.autoToggleLoads = spec.autoToggleLoads;
+    run.restoreState(state);
+    run.setSeed(spec.seed);
+    
+    uint32_t totalSteps = 1;
+    uint32_t steps = 0;
+    auto onStep = [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        job->progress = (float)++steps / totalSteps;
+        return cancelId != job->id;
+    };
+    
+    unsigned long startMs = millis();
+    if (spec.mode == SCENARIO_DATASET) {
+        IrradianceDataset dataset;
+        if (!dataset.open(spec.file)) return SCENARIO_FAILED;
+        totalSteps = max((uint32_t)1, dataset.getCount());
+        result.steps = run.runDataset(dataset, onStep);
+        dataset.close();
+    } else if (spec.mode == SCENARIO_KERNEL) {
+        if (buffers == nullptr) return SCENARIO_FAILED;
+        totalSteps = spec.days;  // Called once per day
+        result.steps = run.runDaysKernel(spec.startDay, spec.days, spec.stepMinutes, *buffers, onStep);
+    } else {
+        totalSteps = (uint32_t)spec.days * (1440 / spec.stepMinutes);
+        result.steps = run.runDays(spec.startDay, spec.days, spec.stepMinutes, onStep);
+    }
+    result.elapsedMs = millis() - startMs;
+    
+    run.saveState(state);
+    result.batteryLevel = state.batteryLevel;
+    result.totals = run.getTotals();
+    result.costZAR = state.totalCostZAR;
+    result.revenueZAR = state.totalRevenueZAR;
+    memcpy(result.monthly, state.monthly, sizeof(result.monthly));
+    return cancelId == job->id ? SCENARIO_CANCELLED : SCENARIO_DONE;
+}
+
+void ScenarioQueue::taskEntry(void* param) {
+    ScenarioQueue* queue = (ScenarioQueue*)param;
+    
+    // Allocated once for the worker's lifetime (kernel mode only)
+    DayBuffers* buffers = (DayBuffers*)allocateLarge(sizeof(DayBuffers));
+    
+    for (;;) {
+        ScenarioJob* job = queue->takeNext();
+        if (job == nullptr) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // Woken by submit()
+            continue;
+        }
+        
+        ScenarioResult result;
+        memset(&result, 0, sizeof(result));
+        ScenarioStatus status = queue->run(job, buffers, result);
+        queue->finish(job, status, result);
+    }
+}
+
+const char* ScenarioQueue::statusName(ScenarioStatus status) {
+    switch (status) {
+        case SCENARIO_QUEUED: return "queued";
+        case SCENARIO_RUNNING: return "running";
+        case SCENARIO_DONE: return "done";
+        case SCENARIO_CANCELLED: return "cancelled";
+        case SCENARIO_FAILED: return "failed";
+        default: return "free";
+    }
+}
+
+const char* ScenarioQueue::modeName(ScenarioMode mode) {
+    switch (mode) {
+        case SCENARIO_KERNEL: return "kernel";
+        case SCENARIO_DATASET: return "dataset";
+        default: return "days";
+    }
+}
+
+String ScenarioQueue::getJson() {
+    // Summaries copied under the lock, formatted outside it
+    struct Summary {
+        uint32_t id;
+        ScenarioStatus status;
+        ScenarioMode mode;
+        uint8_t priority;
+        float progress;
+    } summaries[SCENARIO_QUEUE_SIZE];
+    int count = 0;
+    
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; jobs != nullptr && i < SCENARIO_QUEUE_SIZE; i++) {
+        const ScenarioJob& job = jobs[i];
+        if (job.status == SCENARIO_FREE) continue;
+        summaries[count++] = {job.id, job.status, job.spec.mode, job.spec.priority, job.progress};
+    }
+    uint32_t done = completed;
+    portEXIT_CRITICAL(&lock);
+    
+    String json = "{";
+    json += "\"slots\":" + String(SCENARIO_QUEUE_SIZE) + ",";
+    json += "\"completed\":" + String(done) + ",";
+    json += "\"jobs\":[";
+    for (int i = 0; i < count; i++) {
+        const Summary& job = summaries[i];
+        if (i > 0) json += ",";
+        json += "{\"id\":" + String(job.id) + ",";
+        json += "\"status\":\"" + String(statusName(job.status)) + "\",";
+        json += "\"mode\":\"" + String(modeName(job.mode)) + "\",";
+        json += "\"priority\":" + String(job.priority) + ",";
+        json += "\"progress\":" + String(job.progress, 3) + "}";
+    }
+    json += "]}";
+    return json;
+}
+
+String ScenarioQueue::getJobJson(uint32_t id) {
+    ScenarioJob job;
+    portENTER_CRITICAL(&lock);
+    ScenarioJob* stored = find(id);
+    if (stored != nullptr) job = *stored;
+    portEXIT_CRITICAL(&lock);
+    if (stored == nullptr) return "";
+    
+    const ScenarioSpec& spec = job.spec;
+    String json = "{";
+    json += "\"id\":" + String(job.id) + ",";
+    json += "\"status\":\"" + String(statusName(job.status)) + "\",";
+    json += "\"progress\":" + String(job.progress, 3) + ",";
+    json += "\"spec\":{\"mode\":\"" + String(modeName(spec.mode)) + "\",";
+    json += "\"priority\":" + String(spec.priority) + ",";
+    json += "\"days\":" + String(spec.days) + ",";
+    json += "\"startDay\":" + String(spec.startDay) + ",";
+    json += "\"step\":" + String(spec.stepMinutes) + ",";
+    json += "\"seed\":" + String(spec.seed) + ",";
+    json += "\"panels\":" + String(spec.panels) + ",";
+    json += "\"cells\":" + String(spec.cells) + ",";
+    json += "\"autoToggleLoads\":" + String(spec.autoToggleLoads ? "true" : "false") + ",";
+    json += "\"file\":\"" + String(spec.file) + "\"}";
+    
+    if (job.status == SCENARIO_DONE || job.status == SCENARIO_CANCELLED) {
+        const ScenarioResult& result = job.result;
+        json += ",\"result\":{";
+        json += "\"steps\":" + String(result.steps) + ",";
+        json += "\"elapsedMs\":" + String(result.elapsedMs) + ",";
+        json += "\"batteryLevel\":" + String(result.batteryLevel, 2) + ",";
+        json += "\"energyGenerated\":" + String(result.totals.generated, 2) + ",";
+        json += "\"energyConsumed\":" + String(result.totals.consumed, 2) + ",";
+        json += "\"energyFromGrid\":" + String(result.totals.fromGrid, 2) + ",";
+        json += "\"energyToGrid\":" + String(result.totals.toGrid, 2) + ",";
+        json += "\"costZAR\":" + String(result.costZAR, 2) + ",";
+        json += "\"revenueZAR\":" + String(result.revenueZAR, 2) + ",";
+        json += "\"monthly\":[";
+        for (int m = 0; m < 12; m++) {
+            if (m > 0) json += ",";
+            json += "[" + String(result.monthly[m].generated, 2) + "," + String(result.monthly[m].consumed, 2) + "," +
+                    String(result.monthly[m].fromGrid, 2) + "," + String(result.monthly[m].toGrid, 2) + "]";
+        }
+        json += "]}";
+    }
+    json += "}";
+    return json;
+}
@@ -0,0 +1,88 @@
+#ifndef SCENARIO_QUEUE_H
+#define SCENARIO_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "simulation.h"
+#include "tariff.h"
+
+enum ScenarioMode {
+    SCENARIO_DAYS,     // Sun model, one step at a time (runDays)
+    SCENARIO_KERNEL,   // Sun model, whole-day kernel
+    SCENARIO_DATASET   // Measured irradiance dataset
+};
+
+enum ScenarioStatus {
+    SCENARIO_FREE,
+    SCENARIO_QUEUED,
+    SCENARIO_RUNNING,
+    SCENARIO_DONE,
+    SCENARIO_CANCELLED,
+    SCENARIO_FAILED
+};
+
+// One batch run: configuration, period, noise seed and mode
+struct ScenarioSpec {
+    ScenarioMode mode;
+    uint8_t priority;        // Higher runs first, FIFO within a priority
+    int days;
+    int startDay;            // Day of year (sun model modes)
+    int stepMinutes;
+    uint32_t seed;           // 0 = hardware RNG
+    int panels;              // Active panels / cells, counted from 1
+    int cells;
+    bool autoToggleLoads;
+    char file[32];           // Dataset path (dataset mode)
+};
+
+struct ScenarioResult {
+    uint32_t steps;
+    uint32_t elapsedMs;
+    float batteryLevel;      // Final SoC, %
+    EnergyTotals totals;     // kWh
+    float costZAR;           // Import cost at time-of-use rates
+    float revenueZAR;        // Export revenue
+    EnergyTotals monthly[12];
+};
+
+struct ScenarioJob {
+    uint32_t id;
+    ScenarioStatus status;
+    ScenarioSpec spec;
+    float progress;          // 0-1, written by the worker
+    unsigned long submittedMs;
+    ScenarioResult result;
+};
+
+// Queued batch scenarios, worked off by a background task below the main
+// loop's priority. Finished jobs stay in the store until their slot is
+// needed for a new submission (oldest first).
+class ScenarioQueue {
+public:
+    ScenarioQueue(Tariff* tariffRef, PvModel* pvRef);
+    bool begin();                             // Allocate the store and start the worker
+    int32_t submit(const ScenarioSpec& spec); // Job ID, -1 when the store is full
+    bool cancel(uint32_t id);                 // Queued or running
+    String getJson();                         // All jobs without results
+    String getJobJson(uint32_t id);           // One job with its result, "" if unknown
+
+private:
+    Tariff* tariff;
+    PvModel* pv;
+    ScenarioJob* jobs;
+    uint32_t nextId;
+    volatile uint32_t cancelId;               // Running job to stop, 0 = none
+    uint32_t completed;
+    TaskHandle_t worker;
+    portMUX_TYPE lock;
+
+    ScenarioJob* find(uint32_t id);
+    ScenarioJob* takeNext();                  // Highest priority queued job, marked running
+    void finish(ScenarioJob* job, ScenarioStatus status, const ScenarioResult& result);
+    ScenarioStatus run(ScenarioJob* job, DayBuffers* buffers, ScenarioResult& result);
+    static void taskEntry(void* param);
+    static const char* statusName(ScenarioStatus status);
+    static const char* modeName(ScenarioMode mode);
+};
+
+#endif // SCENARIO_QUEUE_H
@@ -0,0 +1,127 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler() : jobCount(0), activeJob(-1), pending(false), idleUs(0), statsStartMs(0), reportedOverruns(0) {
+}
+
+bool Scheduler::addJob(const char* name, uint32_t periodMs, uint32_t budgetUs, std::function<void()> run) {
+    if (jobCount >= SCHEDULER_MAX_JOBS) return false;
+
+    SchedulerJob& job = jobs[jobCount++];
+    job.name = name;
+    job.run = run;
+    job.periodUs = periodMs * 1000;
+    job.budgetUs = budgetUs;
+    job.nextDueUs = micros();
+    job.runs = 0;
+    job.overruns = 0;
+    job.missed = 0;
+    job.lastUs = 0;
+    job.maxUs = 0;
+
+    if (jobCount == 1) statsStartMs = millis();
+    return true;
+}
+
+void Scheduler::run() {
+    // Jobs are checked in the order they were added (first = highest priority)
+    for (int i = 0; i < jobCount; i++) {
+        uint32_t now = micros();
+        if ((int32_t)(now - jobs[i].nextDueUs) < 0) continue;
+
+        activeJob = i;
+        runJob(jobs[i], now);
+        activeJob = -1;
+    }
+
+    // Block until the earliest deadline so the idle task can put the CPU to sleep
+    uint32_t now = micros();
+    int32_t waitUs = INT32_MAX;
+    for (int i = 0; i < jobCount; i++) {
+        int32_t untilDue = (int32_t)(jobs[i].nextDueUs - now);
+        if (untilDue < waitUs) waitUs = untilDue;
+    }
+
+    if (waitUs >= 1000) {
+        vTaskDelay(pdMS_TO_TICKS(waitUs / 1000));
+        idleUs += micros() - now;
+    }
+}
+
+uint32_t Scheduler::runPending() {
+    // Called from a job that has to work for longer than one period (batch runs,
+    // exports, benchmarks) between chunks of its work. Sampling, history and the
+    // checkpoint keep their deadlines; the calling job itself is never re-entered.
+    if (activeJob < 0 || pending) return 0;
+
+    uint32_t startUs = micros();
+    pending = true;
+    for (int i = 0; i < jobCount; i++) {
+        uint32_t now = micros();
+        if (i == activeJob || (int32_t)(now - jobs[i].nextDueUs) < 0) continue;
+        runJob(jobs[i], now);
+    }
+    pending = false;
+    return micros() - startUs;
+}
+
+void Scheduler::runJob(SchedulerJob& job, uint32_t now) {
+    job.run();
+
+    uint32_t duration = micros() - now;
+    job.runs++;
+    job.lastUs = duration;
+    if (duration > job.maxUs) job.maxUs = duration;
+    if (duration > job.budgetUs) job.overruns++;
+
+    // Fixed-rate release; if a whole period was lost, resync instead of bursting
+    job.nextDueUs += job.periodUs;
+    if ((int32_t)(micros() - job.nextDueUs) >= (int32_t)job.periodUs) {
+        job.missed++;
+        job.nextDueUs = micros() + job.periodUs;
+    }
+}
+
+void Scheduler::printReport() {
+    uint32_t overruns = 0;
+    for (int i = 0; i < jobCount; i++) overruns += jobs[i].overruns;
+    if (overruns == reportedOverruns) return;
+    reportedOverruns = overruns;
+
+    Serial.println("Scheduler overruns:");
+    for (int i = 0; i < jobCount; i++) {
+        if (jobs[i].overruns == 0) continue;
+        Serial.print("  ");
+        Serial.print(jobs[i].name);
+        Serial.print(": ");
+        Serial.print(jobs[i].overruns);
+        Serial.print("/");
+        Serial.print(jobs[i].runs);
+        Serial.print(" runs over ");
+        Serial.print(jobs[i].budgetUs);
+        Serial.print(" us (max ");
+        Serial.print(jobs[i].maxUs);
+        Serial.println(" us)");
+    }
+}
+
+String Scheduler::getJson() {
+    uint64_t elapsedUs = (uint64_t)(millis() - statsStartMs) * 1000;
+
+    String json = "{";
+    json += "\"idle\":" + String(elapsedUs > 0 ? (double)idleUs / elapsedUs : 0.0, 3) + ",";
+    json += "\"jobs\":[";
+    for (int i = 0; i < jobCount; i++) {
+        const SchedulerJob& job = jobs[i];
+        if (i > 0) json += ",";
+        json += "{\"name\":\"" + String(job.name) + "\"";
+        json += ",\"periodMs\":" + String(job.periodUs / 1000);
+        json += ",\"budgetUs\":" + String(job.budgetUs);
+        json += ",\"runs\":" + String(job.runs);
+        json += ",\"overruns\":" + String(job.overruns);
+        json += ",\"missed\":" + String(job.missed);
+        json += ",\"lastUs\":" + String(job.lastUs);
+        json += ",\"maxUs\":" + String(job.maxUs) + "}";
+    }
+    json += "]}";
+    return json;
+}
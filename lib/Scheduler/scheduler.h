@@ -0,0 +1,45 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+
+// Periodic job with a deadline (next release) and a run-time budget
+struct SchedulerJob {
+    const char* name;
+    std::function<void()> run;
+    uint32_t periodUs;
+    uint32_t budgetUs;
+    uint32_t nextDueUs;    // micros() of the next release
+    uint32_t runs;
+    uint32_t overruns;     // Runs that exceeded the budget
+    uint32_t missed;       // Releases skipped because the job fell a full period behind
+    uint32_t lastUs;       // Duration of the last run
+    uint32_t maxUs;        // Longest run
+};
+
+// Cooperative deadline scheduler for the main loop
+class Scheduler {
+public:
+    Scheduler();
+    bool addJob(const char* name, uint32_t periodMs, uint32_t budgetUs, std::function<void()> run);
+    void run();  // Run due jobs, then idle until the next deadline
+    uint32_t runPending();  // From inside a long job: run the other due jobs now, returns the us they took
+
+    void printReport();  // Log overruns since the last report
+    String getJson();
+
+private:
+    SchedulerJob jobs[SCHEDULER_MAX_JOBS];
+    int jobCount;
+    int activeJob;            // Job currently inside run(), -1 = none
+    bool pending;             // runPending() in progress, no nesting
+    uint64_t idleUs;          // Time spent blocked between deadlines
+    unsigned long statsStartMs;
+    uint32_t reportedOverruns;
+
+    void runJob(SchedulerJob& job, uint32_t now);
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,174 @@
+#include "simulation.h"
+
+// Whole-day batch kernel: every per-step quantity except the battery state is
+// computed for the full day into struct-of-arrays buffers, then the SoC
+// recurrence and energy accounting run once over the finished arrays.
+
+// ESP-DSP ships with the ESP32-S3 Arduino core and uses the S3 SIMD unit
+#if __has_include(<dsps_mulc.h>)
+#include <dsps_mulc.h>
+#define DAY_KERNEL_DSP 1
+#else
+#define DAY_KERNEL_DSP 0
+#endif
+
+namespace {
+
+// xorshift32: a few cycles per number instead of the hardware RNG behind random()
+inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Uniform in [-1, 1)
+inline float randomSigned(uint32_t& state) {
+    return (int32_t)nextRandom(state) * (1.0f / 2147483648.0f);
+}
+
+// Uniform in [0, 1)
+inline float randomUnit(uint32_t& state) {
+    return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// out = a * c (may run in place)
+void scale(const float* a, float c, float* out, int n) {
+#if DAY_KERNEL_DSP
+    dsps_mulc_f32(a, out, n, c, 1, 1);
+#else
+    for (int i = 0; i < n; i++) out[i] = a[i] * c;
+#endif
+}
+
+}  // namespace
+
+bool Simulation::usesSimd() {
+    return DAY_KERNEL_DSP;
+}
+
+uint32_t Simulation::runDaysKernel(int firstDay, int days, int stepMinutes, DayBuffers& buffers, const StepCallback& onDay) {
+    // Same model as runDays(), called on a copy of the live simulation
+    resetRun();
+    running = true;
+
+    if (stepMinutes < 1) stepMinutes = 1;
+    if (stepMinutes > 1440) stepMinutes = 1440;
+    while (1440 % stepMinutes != 0) stepMinutes--;  // Same rounding as runDays()
+    simDays = days;
+    int stepsPerDay = min(1440 / stepMinutes, SIM_MAX_DAY_STEPS);
+    float stepHours = stepMinutes / 60.0f;
+    uint32_t steps = 0;
+    uint32_t rng = seed != 0 ? seed : (uint32_t)random(1, 0x7FFFFFFF);
+    bool stopped = false;
+
+    float* irradiance = buffers.irradiance;
+    float* generated = buffers.generated;
+    float* load = buffers.load;
+    float* voltages = buffers.voltage;
+    float* currents = buffers.current;
+    float* scratch = buffers.scratch;
+
+    // Load per hour of day: auto toggle schedule or the manually set loads
+    float loadProfile[24];
+    for (int h = 0; h < 24; h++) {
+        if (autoToggleLoads) applyLoadSchedule(h);
+        loadProfile[h] = activeLoadWatts;
+    }
+
+    // Active panels behind the MPP tracker
+    float arrayScale = activePanelsSnapshot * PV_MPPT_EFFICIENCY;
+
+    for (int d = 0; d < days && !stopped; d++) {
+        int dayOfYear = (firstDay - 1 + d) % 365 + 1;
+        currentSun = SunModel::forDay(SITE_LATITUDE, dayOfYear);
+        currentMonth = SunModel::monthOfDay(dayOfYear);
+        EnergyTotals& month = monthly[currentMonth];
+
+        float generatedBefore = totalEnergyGenerated;
+        float consumedBefore = totalEnergyConsumed;
+        float fromGridBefore = totalEnergyFromGrid;
+        float toGridBefore = totalEnergyToGrid;
+
+        // Clear-sky half-sine by rotating (cos, sin) one step at a time instead of sin() per step
+        float dayLength = currentSun.sunset - currentSun.sunrise;
+        float stepAngle = dayLength > 0.0f ? PI * stepHours / dayLength : 0.0f;
+        float rotateCos = cosf(stepAngle);
+        float rotateSin = sinf(stepAngle);
+        float c = 0.0f;
+        float s = 0.0f;
+        bool daylight = false;
+
+        for (int i = 0; i < stepsPerDay; i++) {
+            float hour = (i + 0.5f) * stepHours;  // Interval midpoint
+            if (hour < currentSun.sunrise || hour >= currentSun.sunset) {
+                irradiance[i] = 0.0f;
+                continue;
+            }
+            if (!daylight) {
+                float angle = (hour - currentSun.sunrise) / dayLength * PI;
+                c = cosf(angle);
+                s = sinf(angle);
+                daylight = true;
+            }
+            irradiance[i] = currentSun.peak * s;
+            float nextC = c * rotateCos - s * rotateSin;
+            s = s * rotateCos + c * rotateSin;
+            c = nextC;
+        }
+
+        // Weather and load noise: ±12% jitter, 10% chance of a 40-80% cloud drop, ±3% load
+        for (int i = 0; i < stepsPerDay; i++) {
+            float factor = 1.0f + 0.12f * randomSigned(rng);
+            if (randomUnit(rng) < 0.1f) factor *= 0.6f - 0.4f * randomUnit(rng);
+            irradiance[i] = constrain(irradiance[i] * factor, 0.0f, 1.0f);
+
+            int hourIndex = (i * stepMinutes + stepMinutes / 2) / 60 % 24;
+            load[i] = loadProfile[hourIndex] * (1.0f + 0.03f * randomSigned(rng));
+        }
+
+        // Generation: MPP per panel from the PV table (cell temperature from irradiance), x panels,
+        // or the per-panel array (vectorized over panels instead of steps)
+        if (usesPanelArray()) {
+            for (int i = 0; i < stepsPerDay; i++) {
+                generated[i] = solarPower(irradiance[i] * 1000.0f, PV_AMBIENT_TEMPERATURE, (i + 0.5f) * stepHours, voltages[i]);
+            }
+        } else {
+            scale(irradiance, 1000.0f, scratch, stepsPerDay);  // W/m²
+            pv->lookupSteps(scratch, PV_AMBIENT_TEMPERATURE, scratch, voltages, stepsPerDay);
+            scale(scratch, arrayScale, generated, stepsPerDay);
+        }
+        for (int i = 0; i < stepsPerDay; i++) {
+            currents[i] = generated[i] > 0.0f && voltages[i] > 0.0f ? generated[i] / voltages[i] : 0.0f;
+        }
+
+        // Sequential part: battery SoC, grid flows, tariff and hourly bins
+        for (int i = 0; i < stepsPerDay; i++) {
+            simCurrentHour = (i + 0.5f) * stepHours;
+            currentData.powerGenerated = generated[i];
+            currentData.powerLoad = load[i];
+            calculateBattery(stepHours);
+        }
+        steps += stepsPerDay;
+
+        month.generated += totalEnergyGenerated - generatedBefore;
+        month.consumed += totalEnergyConsumed - consumedBefore;
+        month.fromGrid += totalEnergyFromGrid - fromGridBefore;
+        month.toGrid += totalEnergyToGrid - toGridBefore;
+        
+        // Once per day, with the last step of the day
+        if (onDay && !onDay(dayOfYear, simCurrentHour, currentData)) stopped = true;
+    }
+
+    // Leave the last step in currentData, like the stepped run does
+    if (stepsPerDay > 0 && days > 0) {
+        int last = stepsPerDay - 1;
+        currentData.irradiance = irradiance[last];
+        currentData.voltage = currents[last] > 0.0f ? voltages[last] : 0.0f;
+        currentData.current = currents[last];
+        if (autoToggleLoads) applyLoadSchedule((int)simCurrentHour);
+    }
+
+    running = false;
+    return steps;
+}
@@ -0,0 +1,276 @@
+#include "panel_array.h"
+#include "psram_alloc.h"
+
+// ESP-DSP ships with the ESP32-S3 Arduino core and uses the S3 SIMD unit
+#if __has_include(<dsps_mulc.h>) && __has_include(<dsps_mul.h>) && __has_include(<dsps_add.h>) && __has_include(<dsps_addc.h>)
+#include <dsps_mulc.h>
+#include <dsps_mul.h>
+#include <dsps_add.h>
+#include <dsps_addc.h>
+#define PANEL_ARRAY_DSP 1
+#else
+#define PANEL_ARRAY_DSP 0
+#endif
+
+// Floats and bytes per panel in the single allocation
+#define PANEL_ARRAY_FLOATS 7
+#define PANEL_ARRAY_BYTES 1
+
+PanelArray::PanelArray(PvModel* pvRef)
+    : pv(pvRef), count(0), perString(1), orientCos(nullptr), orientSin(nullptr), gain(nullptr), azimuth(nullptr),
+      shading(nullptr), fault(nullptr), effective(nullptr), scratch(nullptr), lastPower(0.0), lastUs(0) {
+}
+
+PanelArray::~PanelArray() {
+    release();
+}
+
+bool PanelArray::allocate(int panels) {
+    // One block, floats first so every array stays 4-byte aligned
+    size_t bytes = (size_t)panels * (PANEL_ARRAY_FLOATS * sizeof(float) + PANEL_ARRAY_BYTES);
+    float* block = (float*)allocateLarge(bytes);
+    if (block == nullptr) return false;
+    
+    orientCos = block;
+    orientSin = orientCos + panels;
+    gain = orientSin + panels;
+    azimuth = gain + panels;
+    shading = azimuth + panels;
+    effective = shading + panels;
+    scratch = effective + panels;
+    fault = (uint8_t*)(scratch + panels);
+    return true;
+}
+
+void PanelArray::release() {
+    free(orientCos);  // Start of the block
+    orientCos = nullptr;
+    orientSin = nullptr;
+    gain = nullptr;
+    azimuth = nullptr;
+    shading = nullptr;
+    effective = nullptr;
+    scratch = nullptr;
+    fault = nullptr;
+    count = 0;
+}
+
+bool PanelArray::configure(int panels, int panelsPerString) {
+    if (panels < 1 || panels > PANEL_ARRAY_MAX) return false;
+    if (panelsPerString < 1 || panelsPerString > PANEL_ARRAY_MAX_STRING || panels % panelsPerString != 0) return false;
+    
+    release();
+    if (!allocate(panels)) return false;
+    count = panels;
+    perString = panelsPerString;
+    for (int i = 0; i < count; i++) {
+        orientCos[i] = 0.0;
+        orientSin[i] = 0.0;
+        azimuth[i] = 0.0;
+        shading[i] = 0.0;
+        fault[i] = PANEL_OK;
+        gain[i] = 1.0;
+    }
+    lastPower = 0.0;
+    return true;
+}
+
+void PanelArray::clear() {
+    release();
+    lastPower = 0.0;
+}
+
+void PanelArray::updateGain(int index) {
+    float factor = 1.0;
+    if (fault[index] == PANEL_DEGRADED) factor = PANEL_ARRAY_DEGRADED;
+    else if (fault[index] != PANEL_OK) factor = 0.0;
+    gain[index] = (1.0f - shading[index]) * factor;
+}
+
+void PanelArray::setPanels(int from, int to, float azimuthDeg, float shadingFraction, PanelFault panelFault) {
+    from = max(from, 0);
+    to = min(to, count - 1);
+    float w = PANEL_ARRAY_TILT_WEIGHT;
+    float c = cosf(azimuthDeg * DEG_TO_RAD);
+    float s = sinf(azimuthDeg * DEG_TO_RAD);
+    shadingFraction = constrain(shadingFraction, 0.0f, 1.0f);
+    for (int i = from; i <= to; i++) {
+        azimuth[i] = azimuthDeg;
+        orientCos[i] = w * (c - 1.0f);
+        orientSin[i] = w * s;
+        shading[i] = shadingFraction;
+        fault[i] = panelFault;
+        updateGain(i);
+    }
+}
+
+int PanelArray::getCount() {
+    return count;
+}
+
+float PanelArray::stringPower(int first, float ambientC, float& voltage) {
+    const float* g = effective + first;
+    voltage = 0.0;
+    
+    // An open panel breaks the series path, a bypassed one only drops out
+    float low = g[0];
+    float high = g[0];
+    for (int i = 0; i < perString; i++) {
+        if (fault[first + i] == PANEL_OPEN) return 0.0;
+        low = min(low, g[i]);
+        high = max(high, g[i]);
+    }
+    if (high <= 0.0f) return 0.0;
+    
+    float panelPower = 0.0;
+    float panelVoltage = 0.0;
+    if (high - low <= 0.001f * high) {
+        // Uniform string: every panel at the same MPP
+        pv->lookup(low, PvModel::cellTemperature(ambientC, low), panelPower, panelVoltage);
+        voltage = perString * panelVoltage;
+        return perString * panelPower;
+    }
+    
+    // Mismatched string: bypass diodes let the tracker run the k brightest panels at
+    // the current of the k-th one. The global MPP is the best k (insertion sort,
+    // strings are short)
+    float* sorted = scratch + first;
+    for (int i = 0; i < perString; i++) {
+        float value = max(g[i], 0.0f);
+        int j = i;
+        while (j > 0 && sorted[j - 1] < value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    float best = 0.0;
+    for (int k = 0; k < perString && sorted[k] > 0.0f; k++) {
+        // (k + 1) x P(sorted[k]) cannot beat best once perString x P(sorted[k]) does not
+        pv->lookup(sorted[k], PvModel::cellTemperature(ambientC, sorted[k]), panelPower, panelVoltage);
+        if (perString * panelPower <= best) break;
+        float power = (k + 1) * panelPower;
+        if (power > best) {
+            best = power;
+            voltage = (k + 1) * panelVoltage;
+        }
+    }
+    return best;
+}
+
+float PanelArray::compute(float irradianceWm2, float ambientC, float hourAngle, float& voltage, const bool* switched, int switchedCount) {
+    voltage = 0.0;
+    lastPower = 0.0;
+    if (count == 0 || irradianceWm2 <= 0.0f) return 0.0;
+    uint32_t start = micros();
+    
+    // Plane-of-array irradiance relative to an equator-facing panel:
+    // G x gain x (1 + w x (cos(hourAngle - azimuth) - cos(hourAngle))), expanded into the two per-panel terms
+    float c = cosf(hourAngle);
+    float s = sinf(hourAngle);
+#if PANEL_ARRAY_DSP
+    dsps_mulc_f32(orientCos, effective, count, c, 1, 1);
+    dsps_mulc_f32(orientSin, scratch, count, s, 1, 1);
+    dsps_add_f32(effective, scratch, effective, count, 1, 1, 1);
+    dsps_addc_f32(effective, effective, count, 1.0f, 1, 1);
+    dsps_mul_f32(effective, gain, effective, count, 1, 1, 1);
+    dsps_mulc_f32(effective, effective, count, irradianceWm2, 1, 1);
+#else
+    for (int i = 0; i < count; i++) {
+        effective[i] = irradianceWm2 * gain[i] * (1.0f + c * orientCos[i] + s * orientSin[i]);
+    }
+#endif
+    
+    // Switched-off panels receive nothing (they drop out like a bypassed panel)
+    for (int i = 0; switched != nullptr && i < min(switchedCount, count); i++) {
+        if (!switched[i]) effective[i] = 0.0f;
+    }
+    
+    // Strings in parallel, each behind its own tracker
+    float total = 0.0;
+    for (int first = 0; first < count; first += perString) {
+        float stringVoltage = 0.0;
+        total += stringPower(first, ambientC, stringVoltage);
+        voltage = max(voltage, stringVoltage);
+    }
+    
+    lastPower = total * PV_MPPT_EFFICIENCY;
+    lastUs = micros() - start;
+    return lastPower;
+}
+
+String PanelArray::getJson() {
+    int shaded = 0;
+    int faults[4] = {0, 0, 0, 0};
+    for (int i = 0; i < count; i++) {
+        if (shading[i] > 0.0f) shaded++;
+        faults[fault[i]]++;
+    }
+    
+    String json = "{";
+    json += "\"active\":" + String(count > 0 ? "true" : "false") + ",";
+    json += "\"panels\":" + String(count) + ",";
+    json += "\"panelsPerString\":" + String(count > 0 ? perString : 0) + ",";
+    json += "\"strings\":" + String(count > 0 ? count / perString : 0) + ",";
+    json += "\"shaded\":" + String(shaded) + ",";
+    json += "\"degraded\":" + String(faults[PANEL_DEGRADED]) + ",";
+    json += "\"bypassed\":" + String(faults[PANEL_BYPASSED]) + ",";
+    json += "\"open\":" + String(faults[PANEL_OPEN]) + ",";
+    json += "\"lastPower\":" + String(lastPower, 1) + ",";
+    json += "\"lastComputeUs\":" + String(lastUs) + ",";
+    json += "\"simd\":" + String(PANEL_ARRAY_DSP ? "true" : "false");
+    json += "}";
+    return json;
+}
+
+String PanelArray::benchmark(PvModel* pv, int steps) {
+    const int sizes[3] = {4, 100, 10000};
+    if (steps < 1) steps = 1;
+    
+    String json = "{\"steps\":" + String(steps) + ",";
+    json += "\"simd\":" + String(PANEL_ARRAY_DSP ? "true" : "false") + ",\"results\":[";
+    for (int n = 0; n < 3; n++) {
+        int panels = sizes[n];
+        int panelsPerString = min(panels, PANEL_ARRAY_BENCH_STRING);
+        PanelArray bench(pv);
+        if (n > 0) json += ",";
+        if (!bench.configure(panels, panelsPerString)) {
+            json += "{\"panels\":" + String(panels) + ",\"error\":\"Out of memory\"}";
+            continue;
+        }
+        
+        // Uniform array (fast path per string), then a mismatched one: 30% of the
+        // panels shaded 10-60% and every panel turned up to 45° east or west
+        uint32_t uniformUs = 0;
+        uint32_t shadedUs = 0;
+        float energy = 0.0;
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                for (int i = 0; i < panels; i++) {
+                    float shade = random(100) < 30 ? random(10, 61) / 100.0f : 0.0f;
+                    bench.setPanels(i, i, (float)random(-45, 46), shade, PANEL_OK);
+                }
+            }
+            uint32_t start = micros();
+            for (int i = 0; i < steps; i++) {
+                // Daylight from -75° to +75° hour angle at 800 W/m²
+                float hourAngle = (-75.0f + 150.0f * (i + 0.5f) / steps) * DEG_TO_RAD;
+                float voltage = 0.0;
+                energy += bench.compute(800.0, PV_AMBIENT_TEMPERATURE, hourAngle, voltage);
+            }
+            uint32_t elapsed = micros() - start;
+            if (pass == 0) uniformUs = elapsed;
+            else shadedUs = elapsed;
+        }
+        
+        json += "{\"panels\":" + String(panels) + ",";
+        json += "\"strings\":" + String(panels / panelsPerString) + ",";
+        json += "\"uniformUsPerStep\":" + String((float)uniformUs / steps, 2) + ",";
+        json += "\"uniformNsPerPanel\":" + String(uniformUs * 1000.0 / steps / panels, 1) + ",";
+        json += "\"shadedUsPerStep\":" + String((float)shadedUs / steps, 2) + ",";
+        json += "\"shadedNsPerPanel\":" + String(shadedUs * 1000.0 / steps / panels, 1) + ",";
+        json += "\"checksum\":" + String(energy, 0) + "}";
+    }
+    json += "]}";
+    return json;
+}
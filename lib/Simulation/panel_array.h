@@ -0,0 +1,61 @@
+#ifndef PANEL_ARRAY_H
+#define PANEL_ARRAY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pv_model.h"
+
+enum PanelFault {
+    PANEL_OK,
+    PANEL_DEGRADED,   // Output reduced to PANEL_ARRAY_DEGRADED
+    PANEL_BYPASSED,   // Bypass diode conducts: no output, string keeps working
+    PANEL_OPEN        // Open circuit: the whole string stops
+};
+
+// Per-panel array model: strings of panelsPerString panels in series, strings
+// in parallel, each string with its own MPP tracker. Panel properties are
+// kept struct-of-arrays so the per-step irradiance pass is a few vector ops.
+class PanelArray {
+public:
+    PanelArray(PvModel* pvRef);
+    ~PanelArray();
+    bool configure(int panels, int panelsPerString);  // Resets every panel to south-facing, clean, healthy
+    void clear();
+    void setPanels(int from, int to, float azimuthDeg, float shading, PanelFault fault);  // Inclusive range
+    int getCount();
+
+    // Array output at the MPP, W (per-string MPPT efficiency applied); hourAngle in rad from solar noon.
+    // The first switchedCount panels follow `switched` (the caller's transistor outputs), so
+    // simulation copies sharing one array never change it. Not reentrant: one task only.
+    float compute(float irradianceWm2, float ambientC, float hourAngle, float& voltage,
+                  const bool* switched = nullptr, int switchedCount = 0);
+
+    String getJson();
+    static String benchmark(PvModel* pv, int steps);  // 4, 100 and 10,000 panels
+
+private:
+    PvModel* pv;
+    int count;
+    int perString;
+
+    // Struct-of-arrays, one entry per panel (PSRAM when fitted)
+    float* orientCos;    // PANEL_ARRAY_TILT_WEIGHT * (cos(azimuth) - 1)
+    float* orientSin;    // PANEL_ARRAY_TILT_WEIGHT * sin(azimuth)
+    float* gain;         // (1 - shading) x fault factor
+    float* azimuth;      // Degrees from the equator-facing direction, east negative
+    float* shading;      // 0-1
+    uint8_t* fault;      // PanelFault
+    float* effective;    // Scratch: plane-of-array irradiance per panel, W/m²
+    float* scratch;
+
+    // Last compute() result
+    float lastPower;
+    uint32_t lastUs;
+
+    bool allocate(int panels);
+    void release();
+    void updateGain(int index);
+    float stringPower(int first, float ambientC, float& voltage);
+};
+
+#endif // PANEL_ARRAY_H
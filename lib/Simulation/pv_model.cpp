@@ -0,0 +1,219 @@
+#include "pv_model.h"
+
+// Thermal voltage k * T / q at 25 °C
+#define PV_THERMAL_VOLTAGE 0.025693f
+
+PvModel::PvModel()
+    : seriesResistance(0.0), shuntResistance(1.0e6), photoCurrent(PANEL_ISC), idealityVoltage(1.0), fitted(false),
+      maxTableError(0.0), buildUs(0) {
+    memset(tablePower, 0, sizeof(tablePower));
+    memset(tableVoltage, 0, sizeof(tableVoltage));
+}
+
+bool PvModel::fit() {
+    // Villalva's method: Rsh follows from P(Vmp) = Pmax for a given Rs, Rs is then
+    // chosen so that Vmp is also the maximum (dP/dV = 0 there), by bisection
+    const float voc = PANEL_VOC;
+    const float isc = PANEL_ISC;
+    const float vmp = PANEL_VMP;
+    const float imp = PANEL_IMP;
+    const float pmax = vmp * imp;
+    idealityVoltage = PV_IDEALITY * PANEL_CELLS_SERIES * PV_THERMAL_VOLTAGE;
+    float a = idealityVoltage;
+    float i0 = isc / (expf(voc / a) - 1.0f);
+    
+    float low = 0.0;
+    float high = (voc - vmp) / imp;
+    bool found = false;
+    for (int i = 0; i < 40; i++) {
+        float rs = 0.5f * (low + high);
+        float e = expf((vmp + imp * rs) / a);
+        
+        // Rsh and Iph depend on each other, a few fixed-point passes converge
+        float iph = isc;
+        float rsh = 1.0e6;
+        bool valid = true;
+        for (int j = 0; j < 4 && valid; j++) {
+            float denominator = vmp * iph - vmp * i0 * e + vmp * i0 - pmax;
+            valid = denominator > 0.0f;
+            if (valid) {
+                rsh = vmp * (vmp + imp * rs) / denominator;
+                iph = (rsh + rs) / rsh * isc;
+            }
+        }
+        if (!valid) {
+            // No finite Rsh reaches Pmax: less series resistance needed
+            high = rs;
+            continue;
+        }
+        
+        // dP/dV at the datasheet MPP, positive when the fitted MPP lies above Vmp
+        float g = i0 * e / a + 1.0f / rsh;
+        float slope = imp - vmp * g / (1.0f + g * rs);
+        if (slope > 0.0f) low = rs;
+        else high = rs;
+        
+        seriesResistance = rs;
+        shuntResistance = rsh;
+        photoCurrent = iph;
+        found = true;
+    }
+    return found;
+}
+
+bool PvModel::solve(float irradianceWm2, float cellTemperatureC, PvPoint& point) {
+    point.power = 0.0;
+    point.voltage = 0.0;
+    point.current = 0.0;
+    point.iterations = 0;
+    if (!fitted || irradianceWm2 <= 0.0f) return false;
+    
+    // Translate STC parameters to the conditions (Iph with irradiance, I0 and a with temperature)
+    float deltaT = cellTemperatureC - 25.0f;
+    float ki = PANEL_ISC * PANEL_TEMP_COEFF_ISC;   // A/K
+    float kv = PANEL_VOC * PANEL_TEMP_COEFF_VOC;   // V/K
+    float a = idealityVoltage * (cellTemperatureC + 273.15f) / 298.15f;
+    float iph = (photoCurrent + ki * deltaT) * irradianceWm2 / 1000.0f;
+    float i0 = (PANEL_ISC + ki * deltaT) / (expf((PANEL_VOC + kv * deltaT) / a) - 1.0f);
+    float rs = seriesResistance;
+    float gsh = 1.0f / shuntResistance;
+    if (iph <= 0.0f) return false;
+    
+    // P as a function of the diode voltage x = V + I*Rs is explicit:
+    //   I(x) = Iph - I0 (exp(x/a) - 1) - x/Rsh,  V(x) = x - Rs I(x)
+    // Newton on dP/dx = 0, kept inside [V = 0, open circuit] by bisection
+    float low = rs * iph;
+    float high = a * logf(iph / i0 + 1.0f);
+    float x = low + 0.85f * (high - low);
+    float current = 0.0;
+    float voltage = 0.0;
+    
+    for (int i = 0; i < PV_NEWTON_MAX_ITERATIONS; i++) {
+        float e = expf(x / a);
+        current = iph - i0 * (e - 1.0f) - x * gsh;
+        float dI = -i0 * e / a - gsh;
+        float d2I = -i0 * e / (a * a);
+        voltage = x - rs * current;
+        float dV = 1.0f - rs * dI;
+        float d2V = -rs * d2I;
+        
+        float dP = dV * current + voltage * dI;
+        float d2P = d2V * current + 2.0f * dV * dI + voltage * d2I;
+        if (dP > 0.0f) low = x;
+        else high = x;
+        
+        point.iterations = i + 1;
+        
+        // Converged Newton steps are accepted before the bracket test, which
+        // would otherwise reject a step below float resolution
+        float step = d2P < 0.0f ? dP / d2P : 0.0f;
+        if (d2P < 0.0f && fabsf(step) < PV_NEWTON_TOLERANCE) {
+            x -= step;
+            break;
+        }
+        float next = x - step;
+        if (d2P >= 0.0f || next <= low || next >= high) next = 0.5f * (low + high);
+        x = next;
+    }
+    
+    // Final point at the converged diode voltage
+    current = iph - i0 * (expf(x / a) - 1.0f) - x * gsh;
+    voltage = x - rs * current;
+    if (current <= 0.0f || voltage <= 0.0f) return false;
+    
+    point.current = current;
+    point.voltage = voltage;
+    point.power = voltage * current;
+    return true;
+}
+
+void PvModel::begin() {
+    uint32_t startUs = micros();
+    fitted = fit();
+    if (!fitted) {
+        Serial.println("PV model: datasheet fit failed, panels produce no power");
+        return;
+    }
+    
+    PvPoint point;
+    for (int t = 0; t < PV_TABLE_TEMPERATURES; t++) {
+        for (int g = 0; g < PV_TABLE_IRRADIANCES; g++) {
+            solve(g * PV_TABLE_IRRADIANCE_STEP, PV_TABLE_TEMPERATURE_MIN + t * PV_TABLE_TEMPERATURE_STEP, point);
+            tablePower[t][g] = point.power;
+            tableVoltage[t][g] = point.voltage;
+        }
+    }
+    buildUs = micros() - startUs;
+    
+    // Interpolation error at the cell centres, where it is largest
+    maxTableError = 0.0;
+    for (int t = 0; t + 1 < PV_TABLE_TEMPERATURES; t++) {
+        for (int g = 2; g + 1 < PV_TABLE_IRRADIANCES; g++) {
+            float irradiance = (g + 0.5f) * PV_TABLE_IRRADIANCE_STEP;
+            float temperature = PV_TABLE_TEMPERATURE_MIN + (t + 0.5f) * PV_TABLE_TEMPERATURE_STEP;
+            float power, voltage;
+            lookup(irradiance, temperature, power, voltage);
+            if (solve(irradiance, temperature, point)) {
+                maxTableError = max(maxTableError, fabsf(power - point.power) / point.power);
+            }
+        }
+    }
+    
+    Serial.print("PV model: Rs=");
+    Serial.print(seriesResistance, 3);
+    Serial.print(" Ohm, Rsh=");
+    Serial.print(shuntResistance, 0);
+    Serial.print(" Ohm, table built in ");
+    Serial.print(buildUs);
+    Serial.println(" us");
+}
+
+void PvModel::lookup(float irradianceWm2, float cellTemperatureC, float& power, float& voltage) {
+    // Bilinear in irradiance and temperature, clamped to the grid
+    float g = constrain(irradianceWm2 / PV_TABLE_IRRADIANCE_STEP, 0.0f, PV_TABLE_IRRADIANCES - 1.001f);
+    float t = constrain((cellTemperatureC - PV_TABLE_TEMPERATURE_MIN) / PV_TABLE_TEMPERATURE_STEP, 0.0f, PV_TABLE_TEMPERATURES - 1.001f);
+    int g0 = (int)g;
+    int t0 = (int)t;
+    float fg = g - g0;
+    float ft = t - t0;
+    
+    float p0 = tablePower[t0][g0] + (tablePower[t0][g0 + 1] - tablePower[t0][g0]) * fg;
+    float p1 = tablePower[t0 + 1][g0] + (tablePower[t0 + 1][g0 + 1] - tablePower[t0 + 1][g0]) * fg;
+    power = p0 + (p1 - p0) * ft;
+    
+    // Voltage jumps from 0 (dark) to near Vmp in the first cell: take the lit corner there
+    int gv = g0 == 0 && irradianceWm2 > 0.0f ? 1 : g0;
+    float fv = gv == g0 ? fg : 0.0f;
+    float v0 = tableVoltage[t0][gv] + (tableVoltage[t0][gv + 1] - tableVoltage[t0][gv]) * fv;
+    float v1 = tableVoltage[t0 + 1][gv] + (tableVoltage[t0 + 1][gv + 1] - tableVoltage[t0 + 1][gv]) * fv;
+    voltage = power > 0.0f ? v0 + (v1 - v0) * ft : 0.0f;
+}
+
+void PvModel::lookupSteps(const float* irradianceWm2, float ambientC, float* power, float* voltage, int n) {
+    // One call per day instead of per step. The interpolation itself stays scalar:
+    // each step reads four table cells at data-dependent indices, and the S3 SIMD
+    // unit (and ESP-DSP) has no gather load to vectorize that.
+    for (int i = 0; i < n; i++) {
+        float g = irradianceWm2[i];
+        lookup(g, cellTemperature(ambientC, g), power[i], voltage[i]);
+    }
+}
+
+float PvModel::cellTemperature(float ambientC, float irradianceWm2) {
+    return ambientC + (PANEL_NOCT - 20.0f) / 800.0f * irradianceWm2;
+}
+
+String PvModel::getJson() {
+    String json = "{";
+    json += "\"fitted\":" + String(fitted ? "true" : "false") + ",";
+    json += "\"seriesResistance\":" + String(seriesResistance, 4) + ",";
+    json += "\"shuntResistance\":" + String(shuntResistance, 1) + ",";
+    json += "\"photoCurrent\":" + String(photoCurrent, 3) + ",";
+    json += "\"idealityVoltage\":" + String(idealityVoltage, 3) + ",";
+    json += "\"table\":{\"irradiances\":" + String(PV_TABLE_IRRADIANCES) + ",";
+    json += "\"temperatures\":" + String(PV_TABLE_TEMPERATURES) + ",";
+    json += "\"buildUs\":" + String(buildUs) + ",";
+    json += "\"maxError\":" + String(maxTableError, 5) + "}";
+    json += "}";
+    return json;
+}
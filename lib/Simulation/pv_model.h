@@ -0,0 +1,47 @@
+#ifndef PV_MODEL_H
+#define PV_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Maximum power point of one panel at given conditions
+struct PvPoint {
+    float power;      // W
+    float voltage;    // V
+    float current;    // A
+    int iterations;   // Newton iterations used (0 = table or dark)
+};
+
+// Single-diode panel model fitted to the datasheet (PANEL_VOC/ISC/VMP/IMP):
+//   I = Iph - I0 * (exp((V + I*Rs) / a) - 1) - (V + I*Rs) / Rsh
+// The MPP is found with a bracketed Newton iteration; the simulation reads
+// it from a precomputed irradiance x cell temperature table.
+class PvModel {
+public:
+    PvModel();
+    void begin();  // Fit Rs/Rsh and build the MPP table (a few ms)
+
+    bool solve(float irradianceWm2, float cellTemperatureC, PvPoint& point);  // Direct, per panel
+    void lookup(float irradianceWm2, float cellTemperatureC, float& power, float& voltage);  // Bilinear, per panel
+    void lookupSteps(const float* irradianceWm2, float ambientC, float* power, float* voltage, int n);  // Same for n steps, power may alias irradiance
+    static float cellTemperature(float ambientC, float irradianceWm2);  // NOCT estimate
+    String getJson();
+
+private:
+    // Fitted parameters at STC (1000 W/m², 25 °C)
+    float seriesResistance;   // Rs, Ohm
+    float shuntResistance;    // Rsh, Ohm
+    float photoCurrent;       // Iph, A
+    float idealityVoltage;    // a = n * Ns * k * T / q, V
+    bool fitted;
+
+    // MPP per panel on the grid, [temperature][irradiance]
+    float tablePower[PV_TABLE_TEMPERATURES][PV_TABLE_IRRADIANCES];
+    float tableVoltage[PV_TABLE_TEMPERATURES][PV_TABLE_IRRADIANCES];
+    float maxTableError;      // Worst relative power error between grid points (G >= 100 W/m²)
+    uint32_t buildUs;
+
+    bool fit();
+};
+
+#endif // PV_MODEL_H
@@ -1,28 +1,20 @@
 #include "simulation.h"
 #include "config.h"
 
-Simulation::Simulation(INA* inaRef) : ina(inaRef) {
+static_assert(SIM_PANELS >= 1 && SIM_CELLS >= 1, "Simulation needs at least one panel and one cell");
+
+Simulation::Simulation(SampleSource* sourceRef, Calibration* calibrationRef, Tariff* tariffRef, PvModel* pvRef) : source(sourceRef), calibration(calibrationRef), tariff(tariffRef), pv(pvRef), optimizer(nullptr), array(nullptr) {
     // Initialize all states to false
-    for (int i = 0; i < 4; i++) {
-        panels[i] = false;
-        cells[i] = false;
-    }
-    
-    for (int i = 0; i < 6; i++) {
-        loads[i] = false;
-    }
+    for (int i = 0; i < SIM_PANELS; i++) panels[i] = false;
+    for (int i = 0; i < SIM_CELLS; i++) cells[i] = false;
+    for (int i = 0; i < SIM_LOADS; i++) loads[i] = false;
     
     // Default: Panel 1 and Cell 1 active
     panels[0] = true;
     cells[0] = true;
-    
-    // Load watts: light, fridge, ac, dryer, dishwasher, tv
-    loadWatts[0] = 100;
-    loadWatts[1] = 150;
-    loadWatts[2] = 2000;
-    loadWatts[3] = 500;
-    loadWatts[4] = 1000;
-    loadWatts[5] = 300;
+    activePanels = 1;
+    activeCells = 1;
+    activeLoadWatts = 0;
     
     // Initialize simulation state
     running = false;
@@ -32,15 +24,38 @@ Simulation::Simulation(INA* inaRef) : ina(inaRef) {
     startTime = 0;
     lastUpdateTime = 0;
     durationSeconds = 48;
+    simDays = 1;
+    startDay = 0;  // 0 = fixed 06:00-18:00 day
+    currentDayIndex = 0;
+    currentSun = SunModel::fixedDay();
+    currentMonth = TARIFF_DEFAULT_MONTH - 1;
     simCurrentHour = 6.0;  // Start at 6:00 AM
     lastCalculatedStep = -1;  // Force calculation on first update
+    seed = 0;
+    rngState = 0;
+    optimizeLoads = false;
+    objective = OPTIMIZE_AUTARKY;
+    plan.valid = false;
+    plan.solveUs = 0;
+    fixedPlan.valid = false;
     activePanelsSnapshot = 0;
     activeCellsSnapshot = 0;
+    memset(panelsSnapshot, 0, sizeof(panelsSnapshot));
+    stepCount = 0;
+    stepUsTotal = 0;
+    stepUsMax = 0;
     
     // Initialize energy tracking
     totalEnergyFromGrid = 0.0;
     totalEnergyToGrid = 0.0;
     totalEnergyConsumed = 0.0;
+    totalEnergyGenerated = 0.0;
+    totalCostZAR = 0.0;
+    totalCostEUR = 0.0;
+    totalRevenueZAR = 0.0;
+    totalRevenueEUR = 0.0;
+    clearHourlyBins();
+    clearMonthlyTotals();
     
     // Initialize data
     currentData.voltage = 0.0;
@@ -58,40 +73,36 @@ void Simulation::begin() {
     Serial.println("Simulation initialized");
 }
 
-void Simulation::start(int durationSeconds, bool simulateSun) {
+void Simulation::start(int durationSeconds, bool simulateSun, int days, int startDay) {
     this->durationSeconds = durationSeconds;
     this->simulateSun = simulateSun;
+    this->simDays = days > 0 ? days : 1;
+    this->startDay = startDay;
     this->startTime = millis();
     this->lastUpdateTime = startTime;
     this->simCurrentHour = 6.0;  // Reset to 6:00 AM
     this->lastCalculatedStep = -1;  // Force calculation
     
-    // Count and lock active panels
-    activePanelsSnapshot = 0;
-    for (int i = 0; i < 4; i++) {
-        if (panels[i]) activePanelsSnapshot++;
-    }
+    resetRun();
     
-    // Count and lock active cells
-    activeCellsSnapshot = 0;
-    for (int i = 0; i < 4; i++) {
-        if (cells[i]) activeCellsSnapshot++;
-    }
+    // Sun geometry of the first day (fixed day unless a start day is given)
+    currentDayIndex = 0;
+    currentSun = startDay > 0 ? SunModel::forDay(SITE_LATITUDE, startDay) : SunModel::fixedDay();
+    currentMonth = startDay > 0 ? SunModel::monthOfDay(startDay) : TARIFF_DEFAULT_MONTH - 1;
     
-    // Reset energy tracking
-    totalEnergyFromGrid = 0.0;
-    totalEnergyToGrid = 0.0;
-    totalEnergyConsumed = 0.0;
+    // Deferrable loads for the first day, from 6:00
+    planLoads();
     
     this->running = true;
     
-    // Reset battery to 0%
-    currentData.batteryLevel = 0.0;
-    
     Serial.println("=== Simulation Started ===");
     Serial.print("Duration: ");
     Serial.print(durationSeconds);
-    Serial.println(" seconds");
+    Serial.println(" seconds per day");
+    Serial.print("Days: ");
+    Serial.print(simDays);
+    Serial.print(" starting at day ");
+    Serial.println(startDay);
     Serial.print("Simulate Sun: ");
     Serial.println(simulateSun ? "ON" : "OFF");
     Serial.print("Active Panels: ");
@@ -105,6 +116,149 @@ void Simulation::start(int durationSeconds, bool simulateSun) {
     Serial.println("s");
 }
 
+void Simulation::resetRun() {
+    // Lock active panels and cells (counts are kept by the setters)
+    activePanelsSnapshot = activePanels;
+    activeCellsSnapshot = activeCells;
+    memcpy(panelsSnapshot, panels, sizeof(panels));
+    stepCount = 0;
+    stepUsTotal = 0;
+    stepUsMax = 0;
+    rngState = seed;  // Same seed, same noise on every run
+    
+    // Reset energy tracking
+    totalEnergyFromGrid = 0.0;
+    totalEnergyToGrid = 0.0;
+    totalEnergyConsumed = 0.0;
+    totalEnergyGenerated = 0.0;
+    totalCostZAR = 0.0;
+    totalCostEUR = 0.0;
+    totalRevenueZAR = 0.0;
+    totalRevenueEUR = 0.0;
+    clearHourlyBins();
+    clearMonthlyTotals();
+    
+    // Reset battery to 0%
+    currentData.batteryLevel = 0.0;
+}
+
+void Simulation::clearHourlyBins() {
+    for (int i = 0; i < 24; i++) {
+        hourly[i].generated = 0.0;
+        hourly[i].consumed = 0.0;
+        hourly[i].charged = 0.0;
+        hourly[i].discharged = 0.0;
+        hourly[i].fromGrid = 0.0;
+        hourly[i].toGrid = 0.0;
+    }
+}
+
+void Simulation::clearMonthlyTotals() {
+    for (int i = 0; i < 12; i++) {
+        monthly[i].generated = 0.0;
+        monthly[i].consumed = 0.0;
+        monthly[i].fromGrid = 0.0;
+        monthly[i].toGrid = 0.0;
+    }
+}
+
+bool Simulation::isDayStep(int stepMinutes) {
+    return stepMinutes >= 1 && stepMinutes <= 1440 && 1440 % stepMinutes == 0;
+}
+
+uint32_t Simulation::runDays(int firstDay, int days, int stepMinutes, const StepCallback& onStep) {
+    // Same as runDataset(): called on a copy of the live simulation
+    resetRun();
+    running = true;
+    
+    // Callers validate with isDayStep(), anything else is rounded down to the next divisor
+    if (stepMinutes < 1) stepMinutes = 1;
+    if (stepMinutes > 1440) stepMinutes = 1440;
+    while (1440 % stepMinutes != 0) stepMinutes--;
+    simDays = days;
+    int stepsPerDay = 1440 / stepMinutes;
+    float stepHours = stepMinutes / 60.0;
+    uint32_t steps = 0;
+    bool stopped = false;
+    
+    for (int d = 0; d < days && !stopped; d++) {
+        // Sun geometry once per day, battery SoC carries over
+        int dayOfYear = (firstDay - 1 + d) % 365 + 1;
+        currentSun = SunModel::forDay(SITE_LATITUDE, dayOfYear);
+        currentMonth = SunModel::monthOfDay(dayOfYear);
+        EnergyTotals& month = monthly[SunModel::monthOfDay(dayOfYear)];
+        
+        float generatedBefore = totalEnergyGenerated;
+        float consumedBefore = totalEnergyConsumed;
+        float fromGridBefore = totalEnergyFromGrid;
+        float toGridBefore = totalEnergyToGrid;
+        
+        for (int s = 0; s < stepsPerDay; s++) {
+            simCurrentHour = (s + 0.5) * stepHours;  // Interval midpoint
+            
+            float irradiance = getSolarIrradiance(simCurrentHour);
+            irradiance = applyCloudEffect(applyJitter(irradiance, 12.0));
+            if (irradiance < 0.0) irradiance = 0.0;
+            if (irradiance > 1.0) irradiance = 1.0;
+            
+            calculateSolarFromIrradiance(irradiance * 1000.0, 25.0);
+            calculateLoad();
+            calculateBattery(stepHours);
+            steps++;
+            
+            if (onStep && !onStep(dayOfYear, simCurrentHour, currentData)) {
+                stopped = true;
+                break;
+            }
+        }
+        
+        month.generated += totalEnergyGenerated - generatedBefore;
+        month.consumed += totalEnergyConsumed - consumedBefore;
+        month.fromGrid += totalEnergyFromGrid - fromGridBefore;
+        month.toGrid += totalEnergyToGrid - toGridBefore;
+    }
+    
+    running = false;
+    return steps;
+}
+
+uint32_t Simulation::runDataset(IrradianceDataset& dataset, const StepCallback& onStep) {
+    // Runs on whatever Simulation object it is called on - callers use a copy
+    // of the live simulation so the running state is not disturbed
+    resetRun();
+    running = true;
+    
+    float stepHours = dataset.getStepSeconds() / 3600.0;
+    float minuteOfDay = dataset.getStartMinute();
+    int dayOfYear = dataset.getStartDay();
+    currentMonth = SunModel::monthOfDay(dayOfYear);
+    float stepMinutes = dataset.getStepSeconds() / 60.0;
+    float irradianceWm2, temperatureC;
+    uint32_t steps = 0;
+    
+    dataset.rewind();
+    while (dataset.next(irradianceWm2, temperatureC)) {
+        simCurrentHour = minuteOfDay / 60.0;
+        
+        calculateSolarFromIrradiance(irradianceWm2, temperatureC);
+        calculateLoad();
+        calculateBattery(stepHours);
+        steps++;
+        
+        if (onStep && !onStep(dayOfYear, simCurrentHour, currentData)) break;
+        
+        minuteOfDay += stepMinutes;
+        if (minuteOfDay >= 1440.0) {
+            minuteOfDay -= 1440.0;
+            dayOfYear = dayOfYear % 365 + 1;
+            currentMonth = SunModel::monthOfDay(dayOfYear);
+        }
+    }
+    
+    running = false;
+    return steps;
+}
+
 void Simulation::stop() {
     running = false;
     simCurrentHour = 0.0;
@@ -118,8 +272,8 @@ void Simulation::update() {
     unsigned long elapsedMs = currentTime - startTime;
     float elapsedSeconds = elapsedMs / 1000.0;
     
-    // Check if 24h simulation completed
-    if (elapsedSeconds >= durationSeconds) {
+    // Check if all simulated days completed
+    if (elapsedSeconds >= durationSeconds * simDays) {
         stop();
         return;
     }
@@ -127,7 +281,21 @@ void Simulation::update() {
     // Calculate current simulation hour (6-30), starting at 06:00 (6 AM)
     float hoursPerSecond = 24.0 / (float)durationSeconds;
     float totalHours = elapsedSeconds * hoursPerSecond;
-    simCurrentHour = 6.0 + totalHours;  // Start at 6:00 and run for 24h to 30:00
+    simCurrentHour = 6.0 + totalHours;  // Start at 6:00 and run for 24h per day
+    
+    // New calendar day: precompute its sun geometry once
+    int dayIndex = (int)(simCurrentHour / 24.0);
+    if (dayIndex != currentDayIndex) {
+        currentDayIndex = dayIndex;
+        if (startDay > 0) {
+            int dayOfYear = (startDay - 1 + dayIndex) % 365 + 1;
+            currentSun = SunModel::forDay(SITE_LATITUDE, dayOfYear);
+            currentMonth = SunModel::monthOfDay(dayOfYear);
+        }
+        
+        // New calendar day: plan its deferrable loads with the current SoC
+        planLoads();
+    }
     
     // Update time display (wrap to 0-23 for display)
     float displayHour = fmod(simCurrentHour, 24.0);
@@ -141,13 +309,20 @@ void Simulation::update() {
     if (currentStep != lastCalculatedStep) {
         lastCalculatedStep = currentStep;
         
-        // Calculate delta time since last update
+        // Calculate delta time since last update, scaled to simulation time
         float deltaTimeSeconds = (currentTime - lastUpdateTime) / 1000.0;
+        float simulatedHours = deltaTimeSeconds * hoursPerSecond;
         
         // Update simulation
+        uint32_t stepStart = micros();
         calculateSolarData();
         calculateLoad();
-        calculateBattery(deltaTimeSeconds);
+        calculateBattery(simulatedHours);
+        
+        uint32_t stepUs = micros() - stepStart;
+        stepCount++;
+        stepUsTotal += stepUs;
+        if (stepUs > stepUsMax) stepUsMax = stepUs;
         
         lastUpdateTime = currentTime;
     }
@@ -157,7 +332,7 @@ void Simulation::calculateSolarData() {
     // Use snapshot of panels from simulation start
     int activePanels = activePanelsSnapshot;
     
-    if (activePanels == 0) {
+    if (activePanels == 0 && !(simulateSun && usesPanelArray())) {
         currentData.voltage = 0.0;
         currentData.current = 0.0;
         currentData.powerGenerated = 0.0;
@@ -168,48 +343,26 @@ void Simulation::calculateSolarData() {
     // Get time of day (0-24) for voltage/current calculations
     float timeOfDay = fmod(simCurrentHour, 24.0);
     
-    float baseVoltage = 0.0;
-    float currentPerPanel = 0.0;
-    
     // Calibration mode: Use real INA219 current measurements
     if (!simulateSun) {
-        // Read real current from INA219
-        float realCurrent = ina->getCurrent();  // mA
+        // Voltage shape over the day (sunrise/sunset of the current day)
+        float baseVoltage = 0.0;
+        float currentShape = 0.0;
+        float currentPerPanel = 0.0;
+        getDayCurve(timeOfDay, baseVoltage, currentShape);
         
-        // Apply calibration factor for current - multiply by number of active panels
-        // Because INA measures total current from all panels in parallel
-        currentPerPanel = (realCurrent * currentMultiplier) / 1000.0 / activePanels;  // Convert mA to A, scale, and divide by panels
+        // Read real current (INA219 or replayed trace). A fitted calibration maps it straight to the
+        // simulated current; otherwise the manual multiplier scales it up
+        float rawCurrent = source->getCurrent();  // mA
+        float simCurrent = calibration->isFitted() ? calibration->apply(rawCurrent) : rawCurrent * currentMultiplier;
         
-        // Simulate voltage based on time of day (same as simulation mode)
-        if (timeOfDay >= 18.0 || timeOfDay < 6.0) {
-            // Night (18:00 - 6:00): Complete darkness
-            baseVoltage = 0.0;
-        } 
-        else if (timeOfDay >= 6.0 && timeOfDay < 7.0) {
-            // Sunrise (6:00 - 7:00): Voltage rises from 0V to 200V
-            float sunriseProgress = (timeOfDay - 6.0) / 1.0;  // 0 to 1
-            baseVoltage = 200.0 * sunriseProgress;  // 0V -> 200V
-        }
-        else if (timeOfDay >= 7.0 && timeOfDay < 12.0) {
-            // Morning (7:00 - 12:00): Voltage drops from 200V to 180V
-            float morningProgress = (timeOfDay - 7.0) / 5.0;  // 0 to 1
-            baseVoltage = 200.0 - (20.0 * morningProgress);  // 200V -> 180V
-        }
-        else if (timeOfDay >= 12.0 && timeOfDay < 17.0) {
-            // Afternoon (12:00 - 17:00): Voltage rises from 180V to 200V
-            float afternoonProgress = (timeOfDay - 12.0) / 5.0;  // 0 to 1
-            baseVoltage = 180.0 + (20.0 * afternoonProgress);  // 180V -> 200V
-        }
-        else if (timeOfDay >= 17.0 && timeOfDay < 18.0) {
-            // Sunset (17:00 - 18:00): Voltage drops from 200V to 0V
-            float sunsetProgress = (timeOfDay - 17.0) / 1.0;  // 0 to 1
-            baseVoltage = 200.0 * (1.0 - sunsetProgress);  // 200V -> 0V
-        }
+        // The INA measures the total current of all panels in parallel
+        currentPerPanel = simCurrent / 1000.0 / activePanels;  // Convert mA to A and divide by panels
         
         // Set irradiance based on measured current (for display)
         currentData.irradiance = min(1.0f, currentPerPanel / 12.0f);
         
-        // Apply jitter to voltage (same as simulation mode)
+        // Apply jitter to voltage (±5% noise)
         if (baseVoltage > 0.0) {
             baseVoltage = applyJitter(baseVoltage, 5.0);
             if (baseVoltage < 0.0) baseVoltage = 0.0;
@@ -238,9 +391,12 @@ void Simulation::calculateSolarData() {
     if (irradiance < 0.0) irradiance = 0.0;
     if (irradiance > 1.0) irradiance = 1.0;
     
-    currentData.irradiance = irradiance;
-    
-    // Realistic day-night cycle (Updated):
+    // Panels at their maximum power point (no weather temperature in sun-model runs)
+    calculateSolarFromIrradiance(irradiance * 1000.0, PV_AMBIENT_TEMPERATURE);
+}
+
+void Simulation::getDayCurve(float timeOfDay, float& baseVoltage, float& currentShape) {
+    // Realistic day-night cycle, shown for the fixed 06:00-18:00 day:
     // Night (18:00-6:00): Complete darkness, U=0V, I=0A
     // Sunrise (6:00-7:00): Voltage rises from 0V to 200V (peak at 7am), minimal current
     // Morning (7:00-12:00): Voltage drops 200V->180V, current rises
@@ -248,53 +404,50 @@ void Simulation::calculateSolarData() {
     // Afternoon (12:00-17:00): Voltage rises 180V->200V, current drops
     // Sunset (17:00-18:00): Voltage drops from 200V to 0V
     // Night (18:00+): Complete darkness
+    float sunrise = currentSun.sunrise;
+    float sunset = currentSun.sunset;
+    float noon = (sunrise + sunset) / 2.0;
+    float ramp = min(1.0f, (sunset - sunrise) / 4.0f);  // Shorter ramps on very short days
     
-    if (timeOfDay >= 18.0 || timeOfDay < 6.0) {
-        // Night (18:00 - 6:00): Complete darkness
-        baseVoltage = 0.0;
-        currentPerPanel = 0.0;
-    } 
-    else if (timeOfDay >= 6.0 && timeOfDay < 7.0) {
-        // Sunrise (6:00 - 7:00): Voltage rises from 0V to 200V
-        float sunriseProgress = (timeOfDay - 6.0) / 1.0;  // 0 to 1
+    baseVoltage = 0.0;
+    currentShape = 0.0;
+    
+    if (timeOfDay >= sunset || timeOfDay < sunrise) {
+        // Night: Complete darkness
+        return;
+    }
+    
+    if (timeOfDay < sunrise + ramp) {
+        // Sunrise: Voltage rises from 0V to 200V, almost no current yet
+        float sunriseProgress = (timeOfDay - sunrise) / ramp;  // 0 to 1
         baseVoltage = 200.0 * sunriseProgress;  // 0V -> 200V
-        currentPerPanel = 0.0;  // Almost no current yet
     }
-    else if (timeOfDay >= 7.0 && timeOfDay < 12.0) {
-        // Morning (7:00 - 12:00): Voltage drops, current rises
-        float morningProgress = (timeOfDay - 7.0) / 5.0;  // 0 to 1
+    else if (timeOfDay < noon) {
+        // Morning: Voltage drops, current rises
+        float morningProgress = (timeOfDay - sunrise - ramp) / (noon - sunrise - ramp);  // 0 to 1
         baseVoltage = 200.0 - (20.0 * morningProgress);  // 200V -> 180V
-        currentPerPanel = 12.0 * irradiance * morningProgress;  // 0A -> 12A
+        currentShape = morningProgress;
     }
-    else if (timeOfDay >= 12.0 && timeOfDay < 17.0) {
-        // Afternoon (12:00 - 17:00): Voltage rises, current drops
-        float afternoonProgress = (timeOfDay - 12.0) / 5.0;  // 0 to 1
+    else if (timeOfDay < sunset - ramp) {
+        // Afternoon: Voltage rises, current drops
+        float afternoonProgress = (timeOfDay - noon) / (sunset - ramp - noon);  // 0 to 1
         baseVoltage = 180.0 + (20.0 * afternoonProgress);  // 180V -> 200V
-        currentPerPanel = 12.0 * irradiance * (1.0 - afternoonProgress);  // 12A -> 0A
+        currentShape = 1.0 - afternoonProgress;
     }
-    else if (timeOfDay >= 17.0 && timeOfDay < 18.0) {
-        // Sunset (17:00 - 18:00): Voltage drops from 200V to 0V
-        float sunsetProgress = (timeOfDay - 17.0) / 1.0;  // 0 to 1
+    else {
+        // Sunset: Voltage drops from 200V to 0V, no current anymore
+        float sunsetProgress = (timeOfDay - (sunset - ramp)) / ramp;  // 0 to 1
         baseVoltage = 200.0 * (1.0 - sunsetProgress);  // 200V -> 0V
-        currentPerPanel = 0.0;  // No current anymore
-    }
-    
-    // Apply jitter to voltage (±5% noise)
-    if (baseVoltage > 0.0) {
-        baseVoltage = applyJitter(baseVoltage, 5.0);
-        if (baseVoltage < 0.0) baseVoltage = 0.0;
-        if (baseVoltage > 220.0) baseVoltage = 220.0;  // Clamp to reasonable range
     }
+}
+
+void Simulation::calculateSolarFromIrradiance(float irradianceWm2, float temperatureC) {
+    float voltage = 0.0;
+    float power = solarPower(irradianceWm2, temperatureC, fmod(simCurrentHour, 24.0), voltage);
     
-    // Total current = currentPerPanel × number of active panels
-    float totalCurrent = currentPerPanel * activePanels;
-    
-    // Power = V × I (per panel)
-    float power = baseVoltage * totalCurrent;  // Total power in Watts
-    
-    // Store values
-    currentData.voltage = baseVoltage;  // Voltage (constant across panels in series)
-    currentData.current = totalCurrent;  // Total current (sum of all panels)
+    currentData.irradiance = min(1.0f, irradianceWm2 / 1000.0f);
+    currentData.voltage = power > 0.0 ? voltage : 0.0;
+    currentData.current = power > 0.0 ? power / voltage : 0.0;
     currentData.powerGenerated = power;
 }
 
@@ -302,35 +455,11 @@ void Simulation::calculateLoad() {
     // Auto toggle loads based on time if enabled
     if (autoToggleLoads && running) {
         // Get time of day (0-23) for load scheduling
-        int hour = (int)fmod(simCurrentHour, 24.0);
-        
-        // Light (100W): 6-9 and 18-24
-        loads[0] = (hour >= 6 && hour < 9) || (hour >= 18 && hour < 24);
-        
-        // Fridge (150W): 24h
-        loads[1] = true;
-        
-        // AC (1500W): 10-22
-        loads[2] = (hour >= 10 && hour < 22);
-        
-        // Dryer (500W): 16-17
-        loads[3] = (hour >= 16 && hour < 17);
-        
-        // Dishwasher (2000W): 10-11 and 17-18
-        loads[4] = (hour >= 10 && hour < 11) || (hour >= 17 && hour < 18);
-        
-        // TV (300W): 19-22
-        loads[5] = (hour >= 19 && hour < 22);
+        applyLoadSchedule((int)fmod(simCurrentHour, 24.0));
     }
     
-    float totalLoad = 0.0;
-    
-    // Sum all active loads
-    for (int i = 0; i < 6; i++) {
-        if (loads[i]) {
-            totalLoad += loadWatts[i];
-        }
-    }
+    // Sum of active loads is kept up to date by setLoad()
+    float totalLoad = activeLoadWatts;
     
     // Apply ±3% fluctuation
     totalLoad = applyJitter(totalLoad, 3.0);
@@ -340,20 +469,109 @@ void Simulation::calculateLoad() {
     currentData.powerLoad = totalLoad;
 }
 
-void Simulation::calculateBattery(float deltaTimeSeconds) {
+void Simulation::applyLoadSchedule(int hour) {
+    // Loads controlled by an active plan follow it, the rest the fixed schedule
+    uint8_t planned = optimizeLoads && plan.valid ? plan.controlled : 0;
+    for (int i = 0; i < SIM_LOADS; i++) {
+        setLoad(i, (planned & (1 << i)) ? (plan.loads[hour] & (1 << i)) != 0 : fixedSchedule(i, hour));
+    }
+}
+
+bool Simulation::fixedSchedule(int load, int hour) {
+    switch (load) {
+        case 0: return (hour >= 6 && hour < 9) || (hour >= 18 && hour < 24);   // Light: 6-9 and 18-24
+        case 1: return true;                                                    // Fridge: 24h
+        case 2: return hour >= 10 && hour < 22;                                 // AC: 10-22
+        case 3: return hour >= 16 && hour < 17;                                 // Dryer: 16-17
+        case 4: return (hour >= 10 && hour < 11) || (hour >= 17 && hour < 18);  // Dishwasher: 10-11 and 17-18
+        case 5: return hour >= 19 && hour < 22;                                 // TV: 19-22
+        default: return false;
+    }
+}
+
+float Simulation::solarPower(float irradianceWm2, float ambientC, float hourOfDay, float& voltage) {
+    if (usesPanelArray()) {
+        // Per panel: orientation from the hour angle, shading, faults, string topology
+        float noon = (currentSun.sunrise + currentSun.sunset) / 2.0;
+        // The switched panels are the first ones of the array
+        return array->compute(irradianceWm2, ambientC, (hourOfDay - noon) * PI / 12.0, voltage, panelsSnapshot, SIM_PANELS);
+    }
+    
+    // Single-diode MPP per panel from the table, panels in parallel behind one MPP tracker
+    float panelPower = 0.0;
+    pv->lookup(irradianceWm2, PvModel::cellTemperature(ambientC, irradianceWm2), panelPower, voltage);
+    return activePanelsSnapshot * panelPower * PV_MPPT_EFFICIENCY;
+}
+
+bool Simulation::usesPanelArray() {
+    return array != nullptr && array->getCount() > 0;
+}
+
+float Simulation::forecastGeneration(float hourOfDay) {
+    // Expected value of calculateSolarData(): no jitter, mean cloud loss (10% chance of 40-80%)
+    float irradianceWm2 = getSolarIrradiance(hourOfDay) * (1.0 - 0.1 * 0.6) * 1000.0;
+    float voltage = 0.0;
+    return solarPower(irradianceWm2, PV_AMBIENT_TEMPERATURE, hourOfDay, voltage);
+}
+
+bool Simulation::planLoads() {
+    if (!optimizeLoads || !autoToggleLoads || optimizer == nullptr) return false;
+    
+    // Horizon: 24 hours from the current hour, evaluated at the hour midpoints
+    LoadForecast forecast;
+    forecast.firstHour = (int)fmod(simCurrentHour, 24.0);
+    forecast.capacityWh = activeCellsSnapshot * 5000.0;
+    forecast.initialSoC = currentData.batteryLevel;
+    
+    float fixedLoad[OPTIMIZER_HOURS];
+    for (int slot = 0; slot < OPTIMIZER_HOURS; slot++) {
+        int hour = (forecast.firstHour + slot) % 24;
+        forecast.generated[slot] = forecastGeneration(hour + 0.5);
+        forecast.baseLoad[slot] = 0.0;
+        fixedLoad[slot] = 0.0;
+        for (int i = 0; i < SIM_LOADS; i++) {
+            bool deferrable = false;
+            for (int j = 0; j < DEFERRABLE_LOAD_COUNT; j++) deferrable |= DEFERRABLE_LOADS[j].load == i;
+            if (fixedSchedule(i, hour)) {
+                fixedLoad[slot] += LOAD_TABLE[i].watts;
+                if (!deferrable) forecast.baseLoad[slot] += LOAD_TABLE[i].watts;
+            }
+        }
+        const TariffRate& rate = tariff->rateAt(currentMonth, hour + 0.5);
+        forecast.importRate[slot] = rate.importZAR;
+        forecast.exportRate[slot] = rate.exportZAR;
+    }
+    
+    // Only jobs that can still finish today
+    DeferrableLoad jobs[OPTIMIZER_MAX_JOBS];
+    forecast.jobs = jobs;
+    forecast.jobCount = 0;
+    for (int j = 0; j < DEFERRABLE_LOAD_COUNT && forecast.jobCount < OPTIMIZER_MAX_JOBS; j++) {
+        const DeferrableLoad& job = DEFERRABLE_LOADS[j];
+        if (forecast.firstHour + job.hours > job.deadline) continue;
+        forecast.jobWatts[forecast.jobCount] = LOAD_TABLE[job.load].watts;
+        jobs[forecast.jobCount++] = job;
+    }
+    
+    LoadOptimizer::evaluate(forecast, fixedLoad, fixedPlan);
+    fixedPlan.valid = true;
+    return optimizer->solve(forecast, objective, plan);
+}
+
+void Simulation::calculateBattery(float simulatedHours) {
     // Use snapshot of cells from simulation start
     int activeCells = activeCellsSnapshot;
     
     // Calculate net power: P_net = P_gen - P_load
     currentData.powerNet = currentData.powerGenerated - currentData.powerLoad;
     
-    // Time scaling: real time -> simulation time
-    float hoursPerSecond = 24.0 / (float)durationSeconds;
-    float simulatedHours = deltaTimeSeconds * hoursPerSecond;
-    
-    // Track energy consumption (always, regardless of battery)
-    float energyConsumedWh = currentData.powerLoad * simulatedHours;
-    totalEnergyConsumed += energyConsumedWh / 1000.0;  // Convert Wh to kWh
+    // Energy flows of this step (Wh), accumulated into totals and hourly bins below
+    float generatedWh = currentData.powerGenerated * simulatedHours;
+    float consumedWh = currentData.powerLoad * simulatedHours;
+    float fromGridWh = 0.0;
+    float toGridWh = 0.0;
+    float chargedWh = 0.0;
+    float dischargedWh = 0.0;
     
     if (activeCells == 0) {
         // No battery available - direct grid interaction
@@ -362,70 +580,93 @@ void Simulation::calculateBattery(float deltaTimeSeconds) {
         // All surplus/deficit goes directly to/from grid
         if (currentData.powerNet > 0) {
             // Surplus: all generated power above load goes to grid
-            float excessEnergyWh = currentData.powerNet * simulatedHours;
-            totalEnergyToGrid += excessEnergyWh / 1000.0;  // Convert to kWh
+            toGridWh = currentData.powerNet * simulatedHours;
         } else if (currentData.powerNet < 0) {
             // Deficit: missing power comes from grid
-            float missingEnergyWh = -currentData.powerNet * simulatedHours;
-            totalEnergyFromGrid += missingEnergyWh / 1000.0;  // Convert to kWh
+            fromGridWh = -currentData.powerNet * simulatedHours;
         }
-        return;
-    }
-    
-    // Battery capacity: 5kWh per cell
-    float batteryCapacityWh = activeCells * 5000.0;  // Wh
-    
-    // Energy change: ΔE = P_net * time (in hours)
-    float deltaEnergyWh = currentData.powerNet * simulatedHours;
-    
-    // Apply charging efficiency (85% when charging)
-    if (deltaEnergyWh > 0) {
-        deltaEnergyWh *= 0.85;
-    }
-    
-    // Convert to percentage: ΔSoC% = (ΔE / Capacity) * 100
-    float deltaSoC = (deltaEnergyWh / batteryCapacityWh) * 100.0;
-    
-    // Calculate new SoC (before clamping)
-    float newSoC = currentData.batteryLevel + deltaSoC;
-    
-    // Track grid energy flow BEFORE clamping
-    // If would go below 0%, we need grid power
-    if (newSoC < 0.0) {
-        float missingSoC = 0.0 - newSoC;  // How much below 0%
-        float missingEnergyWh = (missingSoC / 100.0) * batteryCapacityWh;
-        totalEnergyFromGrid += missingEnergyWh / 1000.0;  // Convert to kWh
-        currentData.batteryLevel = 0.0;
-    } 
-    // If would go above 100%, excess goes to grid
-    else if (newSoC > 100.0) {
-        float excessSoC = newSoC - 100.0;  // How much above 100%
-        float excessEnergyWh = (excessSoC / 100.0) * batteryCapacityWh;
-        totalEnergyToGrid += excessEnergyWh / 1000.0;  // Convert to kWh
-        currentData.batteryLevel = 100.0;
     } else {
-        currentData.batteryLevel = newSoC;
+        // Battery capacity: 5kWh per cell
+        float batteryCapacityWh = activeCells * 5000.0;  // Wh
+        float previousSoC = currentData.batteryLevel;
+        
+        // Energy change: ΔE = P_net * time (in hours)
+        float deltaEnergyWh = currentData.powerNet * simulatedHours;
+        
+        // Apply charging efficiency (85% when charging)
+        if (deltaEnergyWh > 0) {
+            deltaEnergyWh *= 0.85;
+        }
+        
+        // Convert to percentage: ΔSoC% = (ΔE / Capacity) * 100
+        float deltaSoC = (deltaEnergyWh / batteryCapacityWh) * 100.0;
+        
+        // Calculate new SoC (before clamping)
+        float newSoC = currentData.batteryLevel + deltaSoC;
+        
+        // Track grid energy flow BEFORE clamping
+        // If would go below 0%, we need grid power
+        if (newSoC < 0.0) {
+            float missingSoC = 0.0 - newSoC;  // How much below 0%
+            fromGridWh = (missingSoC / 100.0) * batteryCapacityWh;
+            currentData.batteryLevel = 0.0;
+        } 
+        // If would go above 100%, excess goes to grid
+        else if (newSoC > 100.0) {
+            float excessSoC = newSoC - 100.0;  // How much above 100%
+            toGridWh = (excessSoC / 100.0) * batteryCapacityWh;
+            currentData.batteryLevel = 100.0;
+        } else {
+            currentData.batteryLevel = newSoC;
+        }
+        
+        // Stored energy change of the battery
+        float storedWh = (currentData.batteryLevel - previousSoC) / 100.0 * batteryCapacityWh;
+        if (storedWh > 0.0) chargedWh = storedWh;
+        else dischargedWh = -storedWh;
     }
+    
+    // Run totals (kWh)
+    totalEnergyGenerated += generatedWh / 1000.0;
+    totalEnergyConsumed += consumedWh / 1000.0;
+    totalEnergyFromGrid += fromGridWh / 1000.0;
+    totalEnergyToGrid += toGridWh / 1000.0;
+    
+    // Cost and revenue at the tariff of this interval (precompiled O(1) lookup)
+    float hourOfDay = fmod(simCurrentHour, 24.0);
+    const TariffRate& rate = tariff->rateAt(currentMonth, hourOfDay);
+    totalCostZAR += fromGridWh / 1000.0 * rate.importZAR;
+    totalCostEUR += fromGridWh / 1000.0 * rate.importEUR;
+    totalRevenueZAR += toGridWh / 1000.0 * rate.exportZAR;
+    totalRevenueEUR += toGridWh / 1000.0 * rate.exportEUR;
+    
+    // Hourly breakdown (kWh per hour of day), maintained incrementally
+    HourlyEnergy& bin = hourly[(int)hourOfDay];
+    bin.generated += generatedWh / 1000.0;
+    bin.consumed += consumedWh / 1000.0;
+    bin.charged += chargedWh / 1000.0;
+    bin.discharged += dischargedWh / 1000.0;
+    bin.fromGrid += fromGridWh / 1000.0;
+    bin.toGrid += toGridWh / 1000.0;
 }
 
 float Simulation::getSolarIrradiance(float hour) {
-    // Half-sine wave from 06:00 to 18:00
-    // Peak at 12:00 (noon)
-    
-    if (hour < 6.0 || hour >= 18.0) {
-        return 0.0;  // No sun at night
-    }
-    
-    // Map hour to sine wave (0 to π)
-    float hoursSinceSunrise = hour - 6.0;  // 0 to 12
-    float angle = (hoursSinceSunrise / 12.0) * PI;  // 0 to π
-    
-    return sin(angle);  // 0 to 1 to 0
+    // Half-sine wave between sunrise and sunset of the current day
+    // (06:00-18:00 with peak 1.0 at noon for the fixed day)
+    return SunModel::irradiance(currentSun, hour);
+}
+
+long Simulation::randomBetween(long low, long high) {
+    if (seed == 0) return random(low, high);
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return low + (long)(rngState % (uint32_t)(high - low));
 }
 
 float Simulation::applyJitter(float value, float percentage) {
     // Add random noise: ±percentage%
-    float jitterFactor = (random(-100, 101) / 100.0) * (percentage / 100.0);
+    float jitterFactor = (randomBetween(-100, 101) / 100.0) * (percentage / 100.0);
     return value * (1.0 + jitterFactor);
 }
 
@@ -433,8 +674,8 @@ float Simulation::applyCloudEffect(float irradiance) {
     // Random cloud events: 10% chance per update
     // When cloud passes, drop irradiance by 40-80%
     
-    if (random(0, 100) < 10) {
-        float dropPercentage = random(40, 81) / 100.0;
+    if (randomBetween(0, 100) < 10) {
+        float dropPercentage = randomBetween(40, 81) / 100.0;
         return irradiance * (1.0 - dropPercentage);
     }
     
@@ -449,7 +690,7 @@ float Simulation::getProgress() {
     if (!running) return 0.0;
     
     unsigned long elapsed = (millis() - startTime) / 1000;
-    float progress = (float)elapsed / (float)durationSeconds;
+    float progress = (float)elapsed / (float)(durationSeconds * simDays);
     return progress > 1.0 ? 1.0 : progress;
 }
 
@@ -457,30 +698,30 @@ SimulationData Simulation::getCurrentData() {
     return currentData;
 }
 
-String Simulation::getDataAsJson() {
-    String json = "{";
-    json += "\"voltage\":" + String(currentData.voltage, 2) + ",";
-    json += "\"current\":" + String(currentData.current, 2) + ",";
-    json += "\"powerGenerated\":" + String(currentData.powerGenerated, 2) + ",";
-    json += "\"powerLoad\":" + String(currentData.powerLoad, 2) + ",";
-    json += "\"powerNet\":" + String(currentData.powerNet, 2) + ",";
-    json += "\"batteryLevel\":" + String(currentData.batteryLevel, 2) + ",";
-    json += "\"hour\":" + String(currentData.hour) + ",";
-    json += "\"minute\":" + String(currentData.minute) + ",";
-    json += "\"irradiance\":" + String(currentData.irradiance, 3) + ",";
-    json += "\"isRunning\":" + String(running ? "true" : "false") + ",";
-    json += "\"autoToggleLoads\":" + String(autoToggleLoads ? "true" : "false") + ",";
-    json += "\"loads\":{";
-    json += "\"light\":" + String(loads[0] ? "true" : "false") + ",";
-    json += "\"fridge\":" + String(loads[1] ? "true" : "false") + ",";
-    json += "\"ac\":" + String(loads[2] ? "true" : "false") + ",";
-    json += "\"dryer\":" + String(loads[3] ? "true" : "false") + ",";
-    json += "\"dishwasher\":" + String(loads[4] ? "true" : "false") + ",";
-    json += "\"tv\":" + String(loads[5] ? "true" : "false");
-    json += "},";
-    json += "\"progress\":" + String(getProgress(), 3);
-    json += "}";
-    return json;
+float Simulation::getSimulationHour() {
+    return simCurrentHour;
+}
+
+int Simulation::getDurationSeconds() {
+    return durationSeconds;
+}
+
+size_t Simulation::writeDataJson(char* out, size_t size) {
+    // Polled twice a second: formatted into the caller's buffer instead of a String
+    int length = snprintf(out, size,
+        "{\"voltage\":%.2f,\"current\":%.2f,\"powerGenerated\":%.2f,\"powerLoad\":%.2f,\"powerNet\":%.2f,"
+        "\"batteryLevel\":%.2f,\"hour\":%d,\"minute\":%d,\"irradiance\":%.3f,\"isRunning\":%s,\"autoToggleLoads\":%s,\"loads\":{",
+        currentData.voltage, currentData.current, currentData.powerGenerated, currentData.powerLoad, currentData.powerNet,
+        currentData.batteryLevel, currentData.hour, currentData.minute, currentData.irradiance,
+        running ? "true" : "false", autoToggleLoads ? "true" : "false");
+    for (int i = 0; i < SIM_LOADS && length > 0 && (size_t)length < size; i++) {
+        length += snprintf(out + length, size - length, "%s\"%s\":%s", i > 0 ? "," : "", LOAD_TABLE[i].name, loads[i] ? "true" : "false");
+    }
+    if (length > 0 && (size_t)length < size) {
+        length += snprintf(out + length, size - length, "},\"panels\":%d,\"cells\":%d,\"stepUs\":%u,\"stepUsMax\":%u,\"progress\":%.3f}",
+            SIM_PANELS, SIM_CELLS, (unsigned)(stepCount > 0 ? stepUsTotal / stepCount : 0), (unsigned)stepUsMax, getProgress());
+    }
+    return length > 0 && (size_t)length < size ? length : 0;
 }
 
 String Simulation::getOverviewJson() {
@@ -492,11 +733,11 @@ String Simulation::getOverviewJson() {
         if (autarky > 100.0) autarky = 100.0;
     }
     
-    // Calculate costs and revenue
-    float costZAR = totalEnergyFromGrid * 3.50;
-    float costEUR = totalEnergyFromGrid * 0.20;
-    float revenueZAR = totalEnergyToGrid * 1.17;
-    float revenueEUR = totalEnergyToGrid * 0.06;
+    // Costs and revenue are accumulated per step at the tariff of each interval
+    float costZAR = totalCostZAR;
+    float costEUR = totalCostEUR;
+    float revenueZAR = totalRevenueZAR;
+    float revenueEUR = totalRevenueEUR;
     
     String json = "{";
     json += "\"autarky\":" + String(autarky, 1) + ",";
@@ -506,13 +747,156 @@ String Simulation::getOverviewJson() {
     json += "\"costZAR\":" + String(costZAR, 2) + ",";
     json += "\"costEUR\":" + String(costEUR, 2) + ",";
     json += "\"revenueZAR\":" + String(revenueZAR, 2) + ",";
-    json += "\"revenueEUR\":" + String(revenueEUR, 2);
+    json += "\"revenueEUR\":" + String(revenueEUR, 2) + ",";
+    json += "\"energyGenerated\":" + String(totalEnergyGenerated, 3) + ",";
+    json += "\"hourly\":" + getHourlyJson();
     json += "}";
     return json;
 }
 
+String Simulation::getHourlyJson() {
+    // Bins are kept up to date by calculateBattery(), this only serializes them
+    String json;
+    json.reserve(1400);
+    json = "{\"days\":" + String(simDays) + ",\"generated\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].generated, 3);
+    json += "],\"consumed\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].consumed, 3);
+    json += "],\"charged\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].charged, 3);
+    json += "],\"discharged\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].discharged, 3);
+    json += "],\"fromGrid\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].fromGrid, 3);
+    json += "],\"toGrid\":[";
+    for (int i = 0; i < 24; i++) json += (i ? "," : "") + String(hourly[i].toGrid, 3);
+    json += "]}";
+    return json;
+}
+
+float Simulation::getEnergyGenerated() {
+    return totalEnergyGenerated;
+}
+
+EnergyTotals Simulation::getTotals() {
+    EnergyTotals totals = {totalEnergyGenerated, totalEnergyConsumed, totalEnergyFromGrid, totalEnergyToGrid};
+    return totals;
+}
+
+void Simulation::saveState(SimulationState& state) {
+    state.running = running;
+    state.simulateSun = simulateSun;
+    state.autoToggleLoads = autoToggleLoads;
+    state.optimizeLoads = optimizeLoads;
+    state.objective = objective;
+    memcpy(state.panels, panels, sizeof(panels));
+    memcpy(state.cells, cells, sizeof(cells));
+    memcpy(state.loads, loads, sizeof(loads));
+    state.currentMultiplier = currentMultiplier;
+    state.durationSeconds = durationSeconds;
+    state.simDays = simDays;
+    state.startDay = startDay;
+    state.elapsedMs = running ? millis() - startTime : 0;
+    state.activePanelsSnapshot = activePanelsSnapshot;
+    state.activeCellsSnapshot = activeCellsSnapshot;
+    state.batteryLevel = currentData.batteryLevel;
+    state.totalEnergyFromGrid = totalEnergyFromGrid;
+    state.totalEnergyToGrid = totalEnergyToGrid;
+    state.totalEnergyConsumed = totalEnergyConsumed;
+    state.totalEnergyGenerated = totalEnergyGenerated;
+    state.totalCostZAR = totalCostZAR;
+    state.totalCostEUR = totalCostEUR;
+    state.totalRevenueZAR = totalRevenueZAR;
+    state.totalRevenueEUR = totalRevenueEUR;
+    memcpy(state.monthly, monthly, sizeof(monthly));
+    memcpy(state.hourly, hourly, sizeof(hourly));
+}
+
+void Simulation::restoreState(const SimulationState& state) {
+    simulateSun = state.simulateSun;
+    autoToggleLoads = state.autoToggleLoads;
+    optimizeLoads = state.optimizeLoads;
+    objective = (OptimizerObjective)state.objective;
+    currentMultiplier = state.currentMultiplier;
+    
+    // Counts are normally kept by the setters, rebuild them once
+    memcpy(panels, state.panels, sizeof(panels));
+    memcpy(cells, state.cells, sizeof(cells));
+    memcpy(loads, state.loads, sizeof(loads));
+    activePanels = 0;
+    activeCells = 0;
+    activeLoadWatts = 0;
+    for (int i = 0; i < SIM_PANELS; i++) activePanels += panels[i];
+    for (int i = 0; i < SIM_CELLS; i++) activeCells += cells[i];
+    for (int i = 0; i < SIM_LOADS; i++) activeLoadWatts += loads[i] ? LOAD_TABLE[i].watts : 0;
+    memcpy(panelsSnapshot, panels, sizeof(panels));
+    
+    durationSeconds = state.durationSeconds > 0 ? state.durationSeconds : 48;
+    simDays = state.simDays > 0 ? state.simDays : 1;
+    startDay = state.startDay;
+    activePanelsSnapshot = state.activePanelsSnapshot;
+    activeCellsSnapshot = state.activeCellsSnapshot;
+    currentData.batteryLevel = state.batteryLevel;
+    totalEnergyFromGrid = state.totalEnergyFromGrid;
+    totalEnergyToGrid = state.totalEnergyToGrid;
+    totalEnergyConsumed = state.totalEnergyConsumed;
+    totalEnergyGenerated = state.totalEnergyGenerated;
+    totalCostZAR = state.totalCostZAR;
+    totalCostEUR = state.totalCostEUR;
+    totalRevenueZAR = state.totalRevenueZAR;
+    totalRevenueEUR = state.totalRevenueEUR;
+    memcpy(monthly, state.monthly, sizeof(monthly));
+    memcpy(hourly, state.hourly, sizeof(hourly));
+    stepCount = 0;
+    stepUsTotal = 0;
+    stepUsMax = 0;
+    
+    running = state.running;
+    if (!running) return;
+    
+    // Continue the simulated clock where it stopped; update() derives the hour from startTime
+    startTime = millis() - state.elapsedMs;
+    lastUpdateTime = millis();
+    lastCalculatedStep = -1;
+    simCurrentHour = 6.0 + state.elapsedMs / 1000.0 * 24.0 / durationSeconds;
+    currentDayIndex = (int)(simCurrentHour / 24.0);
+    if (startDay > 0) {
+        int dayOfYear = (startDay - 1 + currentDayIndex) % 365 + 1;
+        currentSun = SunModel::forDay(SITE_LATITUDE, dayOfYear);
+        currentMonth = SunModel::monthOfDay(dayOfYear);
+    } else {
+        currentSun = SunModel::fixedDay();
+        currentMonth = TARIFF_DEFAULT_MONTH - 1;
+    }
+    
+    // The plan is not stored, re-plan the rest of the day from the restored SoC
+    planLoads();
+}
+
+String Simulation::getAnnualJson() {
+    static const char* monthNames[12] = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+    
+    String json = "{";
+    json += "\"energyGenerated\":" + String(totalEnergyGenerated, 2) + ",";
+    json += "\"energyConsumed\":" + String(totalEnergyConsumed, 2) + ",";
+    json += "\"energyFromGrid\":" + String(totalEnergyFromGrid, 2) + ",";
+    json += "\"energyToGrid\":" + String(totalEnergyToGrid, 2) + ",";
+    json += "\"monthly\":[";
+    for (int i = 0; i < 12; i++) {
+        if (i > 0) json += ",";
+        json += "{\"month\":\"" + String(monthNames[i]) + "\"";
+        json += ",\"generated\":" + String(monthly[i].generated, 2);
+        json += ",\"consumed\":" + String(monthly[i].consumed, 2);
+        json += ",\"fromGrid\":" + String(monthly[i].fromGrid, 2);
+        json += ",\"toGrid\":" + String(monthly[i].toGrid, 2) + "}";
+    }
+    json += "]}";
+    return json;
+}
+
 void Simulation::setPanelState(int panel, bool state) {
-    if (panel >= 1 && panel <= 4) {
+    if (panel >= 1 && panel <= SIM_PANELS) {
+        if (panels[panel - 1] != state) activePanels += state ? 1 : -1;
         panels[panel - 1] = state;
         Serial.print("Panel ");
         Serial.print(panel);
@@ -526,7 +910,8 @@ void Simulation::setPanelState(int panel, bool state) {
 }
 
 void Simulation::setCellState(int cell, bool state) {
-    if (cell >= 1 && cell <= 4) {
+    if (cell >= 1 && cell <= SIM_CELLS) {
+        if (cells[cell - 1] != state) activeCells += state ? 1 : -1;
         cells[cell - 1] = state;
         Serial.print("Cell ");
         Serial.print(cell);
@@ -534,14 +919,14 @@ void Simulation::setCellState(int cell, bool state) {
     }
 }
 
-void Simulation::setLoadState(String load, bool state) {
+void Simulation::setLoadState(const char* load, bool state) {
     int index = -1;
-    if (load == "light") index = 0;
-    else if (load == "fridge") index = 1;
-    else if (load == "ac") index = 2;
-    else if (load == "dryer") index = 3;
-    else if (load == "dishwasher") index = 4;
-    else if (load == "tv") index = 5;
+    for (int i = 0; i < SIM_LOADS; i++) {
+        if (strcmp(load, LOAD_TABLE[i].name) == 0) {
+            index = i;
+            break;
+        }
+    }
     
     if (index >= 0) {
         // Ignore manual changes if auto toggle is enabled
@@ -550,13 +935,18 @@ void Simulation::setLoadState(String load, bool state) {
             return;
         }
         
-        loads[index] = state;
+        setLoad(index, state);
         Serial.print("Load ");
         Serial.print(load);
         Serial.println(state ? " ON" : " OFF");
     }
 }
 
+void Simulation::setSeed(uint32_t value) {
+    seed = value;
+    rngState = value;
+}
+
 void Simulation::setAutoToggleLoads(bool enable) {
     autoToggleLoads = enable;
     Serial.print("Auto toggle loads: ");
@@ -568,3 +958,63 @@ void Simulation::setCurrentMultiplier(float multiplier) {
     Serial.print("Current multiplier set to: ");
     Serial.println(multiplier);
 }
+
+void Simulation::setSampleSource(SampleSource* sourceRef) {
+    source = sourceRef;
+}
+
+void Simulation::setLoadOptimizer(LoadOptimizer* optimizerRef) {
+    optimizer = optimizerRef;
+}
+
+void Simulation::setPanelArray(PanelArray* arrayRef) {
+    array = arrayRef;
+}
+
+bool Simulation::setOptimizedLoads(bool enable, OptimizerObjective objective) {
+    this->optimizeLoads = enable;
+    this->objective = objective;
+    plan.valid = false;
+    if (!enable) return true;
+    
+    // Before a run the snapshot is not taken yet: plan with the current selection
+    if (!running) {
+        activePanelsSnapshot = activePanels;
+        activeCellsSnapshot = activeCells;
+        memcpy(panelsSnapshot, panels, sizeof(panels));
+    }
+    return planLoads();
+}
+
+String Simulation::getPlanJson() {
+    String json = "{";
+    json += "\"enabled\":" + String(optimizeLoads ? "true" : "false") + ",";
+    json += "\"objective\":\"" + String(objective == OPTIMIZE_COST ? "cost" : "autarky") + "\",";
+    json += "\"valid\":" + String(plan.valid ? "true" : "false") + ",";
+    json += "\"solveUs\":" + String(plan.solveUs) + ",";
+    json += "\"loads\":{";
+    bool first = true;
+    for (int i = 0; i < SIM_LOADS; i++) {
+        if (!plan.valid || !(plan.controlled & (1 << i))) continue;
+        if (!first) json += ",";
+        first = false;
+        json += "\"" + String(LOAD_TABLE[i].name) + "\":[";
+        bool firstHour = true;
+        for (int h = 0; h < 24; h++) {
+            if (!(plan.loads[h] & (1 << i))) continue;
+            if (!firstHour) json += ",";
+            firstHour = false;
+            json += String(h);
+        }
+        json += "]";
+    }
+    json += "},";
+    json += "\"planned\":{\"importKWh\":" + String(plan.valid ? plan.importKWh : 0.0, 3);
+    json += ",\"exportKWh\":" + String(plan.valid ? plan.exportKWh : 0.0, 3);
+    json += ",\"costZAR\":" + String(plan.valid ? plan.cost : 0.0, 2) + "},";
+    json += "\"fixed\":{\"importKWh\":" + String(fixedPlan.valid ? fixedPlan.importKWh : 0.0, 3);
+    json += ",\"exportKWh\":" + String(fixedPlan.valid ? fixedPlan.exportKWh : 0.0, 3);
+    json += ",\"costZAR\":" + String(fixedPlan.valid ? fixedPlan.cost : 0.0, 2) + "}";
+    json += "}";
+    return json;
+}
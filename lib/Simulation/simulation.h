@@ -2,7 +2,16 @@
 #define SIMULATION_H
 
 #include <Arduino.h>
-#include "ina.h"
+#include <functional>
+#include "config.h"
+#include "sample_source.h"
+#include "calibration.h"
+#include "irradiance_dataset.h"
+#include "sun_model.h"
+#include "pv_model.h"
+#include "panel_array.h"
+#include "tariff.h"
+#include "load_optimizer.h"
 
 struct SimulationData {
     float voltage;          // V
@@ -16,39 +25,160 @@ struct SimulationData {
     float irradiance;       // 0-1 (fraction of max)
 };
 
+// Energy totals of one aggregation period (kWh)
+struct EnergyTotals {
+    float generated;
+    float consumed;
+    float fromGrid;
+    float toGrid;
+};
+
+// Energy flows of one hour of day (kWh), accumulated over the run
+struct HourlyEnergy {
+    float generated;
+    float consumed;
+    float charged;      // Stored into the battery
+    float discharged;   // Drawn from the battery
+    float fromGrid;
+    float toGrid;
+};
+
+// Struct-of-arrays scratch for the whole-day batch kernel (one value per step)
+struct DayBuffers {
+    float irradiance[SIM_MAX_DAY_STEPS];  // 0-1
+    float generated[SIM_MAX_DAY_STEPS];   // W
+    float load[SIM_MAX_DAY_STEPS];        // W
+    float voltage[SIM_MAX_DAY_STEPS];     // V at the MPP (0 = dark)
+    float current[SIM_MAX_DAY_STEPS];     // A into the charge controller
+    float scratch[SIM_MAX_DAY_STEPS];
+};
+
+// Simulated household load: JSON/API name and rated power
+struct LoadSpec {
+    const char* name;
+    int watts;
+};
+
+// Load table, fixed at compile time (index order is used by calculateLoad)
+constexpr LoadSpec LOAD_TABLE[] = {
+    {"light", 100},
+    {"fridge", 150},
+    {"ac", 2000},
+    {"dryer", 500},
+    {"dishwasher", 1000},
+    {"tv", 300}
+};
+static_assert(sizeof(LOAD_TABLE) / sizeof(LOAD_TABLE[0]) == SIM_LOADS, "SIM_LOADS must match the LOAD_TABLE entries");
+
+// Appliances the optimizer may shift: dishwasher twice a day, dryer once
+// (the fixed schedule runs them at 10-11, 17-18 and 16-17)
+constexpr DeferrableLoad DEFERRABLE_LOADS[] = {
+    {4, 1, 8, 14},   // Dishwasher, morning
+    {4, 1, 14, 22},  // Dishwasher, evening
+    {3, 1, 8, 20}    // Dryer
+};
+constexpr int DEFERRABLE_LOAD_COUNT = sizeof(DEFERRABLE_LOADS) / sizeof(DEFERRABLE_LOADS[0]);
+
+// Complete state of the live run, enough to continue it after a reset
+struct SimulationState {
+    bool running;
+    bool simulateSun;
+    bool autoToggleLoads;
+    bool optimizeLoads;
+    uint8_t objective;            // OptimizerObjective
+    bool panels[SIM_PANELS];
+    bool cells[SIM_CELLS];
+    bool loads[SIM_LOADS];
+    float currentMultiplier;
+    int32_t durationSeconds;
+    int32_t simDays;
+    int32_t startDay;
+    uint32_t elapsedMs;           // Run time when the state was taken
+    int32_t activePanelsSnapshot;
+    int32_t activeCellsSnapshot;
+    float batteryLevel;           // %
+    float totalEnergyFromGrid;    // kWh
+    float totalEnergyToGrid;
+    float totalEnergyConsumed;
+    float totalEnergyGenerated;
+    float totalCostZAR;
+    float totalCostEUR;
+    float totalRevenueZAR;
+    float totalRevenueEUR;
+    EnergyTotals monthly[12];
+    HourlyEnergy hourly[24];
+};
+
+// Called after every batch step with the day of year, hour of day and step
+// result; returning false stops the run (e.g. export client disconnected)
+typedef std::function<bool(int dayOfYear, float hourOfDay, const SimulationData& data)> StepCallback;
+
 class Simulation {
 public:
-    Simulation(INA* inaRef);
+    Simulation(SampleSource* sourceRef, Calibration* calibrationRef, Tariff* tariffRef, PvModel* pvRef);
     void begin();
     
     // Control methods
-    void start(int durationSeconds, bool simulateSun);
+    void start(int durationSeconds, bool simulateSun, int days = 1, int startDay = 0);  // startDay 0 = fixed day
     void stop();
     void update();
     bool isRunning();
     float getProgress();  // 0.0 to 1.0
     void setAutoToggleLoads(bool enable);  // Enable/disable auto toggle
     void setCurrentMultiplier(float multiplier);  // Set calibration current multiplier
+    void setSampleSource(SampleSource* sourceRef);  // Live INA219 or trace replay
+    void setLoadOptimizer(LoadOptimizer* optimizerRef);
+    void setPanelArray(PanelArray* arrayRef);  // Per-panel model, used while it has panels
+    void setSeed(uint32_t value);  // Reproducible noise for batch runs (0 = hardware RNG)
+    bool setOptimizedLoads(bool enable, OptimizerObjective objective);  // Plan deferrable loads each day
+    bool planLoads();  // Re-plan from the current hour (auto toggle + optimizer enabled)
+    
+    // Batch run over a measured dataset (no real-time pacing), returns steps
+    uint32_t runDataset(IrradianceDataset& dataset, const StepCallback& onStep = nullptr);
+    uint32_t runDays(int firstDay, int days, int stepMinutes, const StepCallback& onStep = nullptr);  // Sun model, SoC carried over
+    uint32_t runDaysKernel(int firstDay, int days, int stepMinutes, DayBuffers& buffers, const StepCallback& onDay = nullptr);  // Same, one whole day per pass
+    static bool usesSimd();  // Whole-day kernel built with ESP-DSP
+    static bool isDayStep(int stepMinutes);  // 1-1440 minutes and divides the day into whole steps
     
     // State setters
-    void setPanelState(int panel, bool state);    // panel 1-4
-    void setCellState(int cell, bool state);      // cell 1-4
-    void setLoadState(String load, bool state);   // load types
+    void setPanelState(int panel, bool state);    // panel 1-SIM_PANELS
+    void setCellState(int cell, bool state);      // cell 1-SIM_CELLS
+    void setLoadState(const char* load, bool state);  // Name from LOAD_TABLE
     
     // Data getters
     SimulationData getCurrentData();
-    String getDataAsJson();
+    float getSimulationHour();  // 6.0 to 6.0 + 24 * days since start
+    int getDurationSeconds();   // Wall seconds per simulated day
+    size_t writeDataJson(char* out, size_t size);  // Live data, 0 if it does not fit
     String getOverviewJson();  // Get daily overview statistics
+    String getAnnualJson();    // Totals and monthly aggregates of the last run
+    String getHourlyJson();    // Per-hour energy breakdown (index = hour of day)
+    String getPlanJson();      // Active deferrable load plan
+    float getEnergyGenerated();  // kWh of the current/last run
+    EnergyTotals getTotals();    // Run totals (kWh)
+    
+    // Checkpointing: copy of the run state, and continuing a run from one
+    void saveState(SimulationState& state);
+    void restoreState(const SimulationState& state);
     
 private:
-    // INA219 reference for calibration mode
-    INA* ina;
+    // Measurement source for calibration mode (INA219 or replay)
+    SampleSource* source;
+    Calibration* calibration;  // Fitted gain/offset for raw INA219 current
+    Tariff* tariff;            // Time-of-use import/export prices
+    PvModel* pv;               // Panel MPP at irradiance and cell temperature
+    LoadOptimizer* optimizer;  // Deferrable load planner (nullptr = fixed schedule only)
+    PanelArray* array;         // Strings of individual panels (nullptr or empty = identical panels in parallel)
+    
+    // State arrays, sized by the build configuration
+    bool panels[SIM_PANELS];
+    bool cells[SIM_CELLS];
+    bool loads[SIM_LOADS];
     
-    // State arrays
-    bool panels[4];
-    bool cells[4];
-    bool loads[6];
-    int loadWatts[6];
+    // Maintained by the setters so the step loop never counts or sums
+    int activePanels;
+    int activeCells;
+    int activeLoadWatts;  // Rated power of all loads that are on
     
     // Simulation state
     bool running;
@@ -57,27 +187,69 @@ private:
     float currentMultiplier;  // Calibration multiplier for current
     unsigned long startTime;
     unsigned long lastUpdateTime;
-    int durationSeconds;
-    float simCurrentHour;  // 0.0 to 24.0
+    int durationSeconds;   // Real seconds per simulated day
+    int simDays;           // Number of simulated days
+    int startDay;          // Day of year of the first day (0 = fixed day)
+    int currentDayIndex;   // Day since start whose sun geometry is loaded
+    SunDay currentSun;     // Sunrise, sunset and peak of the current day
+    int currentMonth;      // 0-11, selects the seasonal tariff
+    float simCurrentHour;  // 6.0 to 6.0 + 24.0 * simDays
+    uint32_t seed;         // Noise seed, 0 = hardware RNG
+    uint32_t rngState;     // xorshift32 state, reset to the seed by resetRun()
     int lastCalculatedStep;  // Track last calculated simulation step
     
+    // Deferrable load plan, applied by applyLoadSchedule() while active
+    bool optimizeLoads;
+    OptimizerObjective objective;
+    LoadPlan plan;
+    LoadPlan fixedPlan;        // Same horizon with the fixed schedule, for comparison
+    
     // Simulation snapshot (fixed at start)
     int activePanelsSnapshot;  // Number of panels when simulation started
+    bool panelsSnapshot[SIM_PANELS];  // Their states, passed to the panel array
     int activeCellsSnapshot;   // Number of cells when simulation started
     
     // Energy tracking for daily overview
     float totalEnergyFromGrid;    // kWh drawn from grid
     float totalEnergyToGrid;      // kWh fed into grid
     float totalEnergyConsumed;    // kWh total consumption
+    float totalEnergyGenerated;   // kWh total generation
+    float totalCostZAR;           // Import cost at time-of-use rates
+    float totalCostEUR;
+    float totalRevenueZAR;        // Export revenue at time-of-use rates
+    float totalRevenueEUR;
+    EnergyTotals monthly[12];     // Per calendar month (multi-day runs)
+    HourlyEnergy hourly[24];      // Per hour of day, updated every step
+    
+    // Per-step cost of the live run (calculate solar, load and battery)
+    uint32_t stepCount;
+    uint32_t stepUsTotal;
+    uint32_t stepUsMax;
     
     // Current data
     SimulationData currentData;
     
     // Calculation methods
+    void resetRun();
+    void clearHourlyBins();
+    void clearMonthlyTotals();
+    void getDayCurve(float timeOfDay, float& baseVoltage, float& currentShape);
     void calculateSolarData();
-    void calculateBattery(float deltaTimeSeconds);
+    void calculateSolarFromIrradiance(float irradianceWm2, float temperatureC);
+    float solarPower(float irradianceWm2, float ambientC, float hourOfDay, float& voltage);  // At the MPP, after the tracker
+    bool usesPanelArray();
+    void calculateBattery(float simulatedHours);
     void calculateLoad();
+    void applyLoadSchedule(int hour);
+    static bool fixedSchedule(int load, int hour);
+    float forecastGeneration(float hourOfDay);
+    inline void setLoad(int index, bool on) {
+        if (loads[index] == on) return;
+        loads[index] = on;
+        activeLoadWatts += on ? LOAD_TABLE[index].watts : -LOAD_TABLE[index].watts;
+    }
     float getSolarIrradiance(float hour);
+    long randomBetween(long low, long high);  // random() or the seeded generator
     float applyJitter(float value, float percentage);
     float applyCloudEffect(float irradiance);
 };
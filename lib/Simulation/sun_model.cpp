@@ -0,0 +1,47 @@
+#include "sun_model.h"
+
+SunDay SunModel::fixedDay() {
+    SunDay day = {6.0, 18.0, 1.0};
+    return day;
+}
+
+SunDay SunModel::forDay(float latitude, int dayOfYear) {
+    // Solar declination (Cooper's equation)
+    float declination = 23.44 * DEG_TO_RAD * sin(2.0 * PI * (284 + dayOfYear) / 365.0);
+    float lat = latitude * DEG_TO_RAD;
+
+    // Sunset hour angle: cos(w) = -tan(lat) * tan(decl), clamped for polar day/night
+    float cosW = -tan(lat) * tan(declination);
+    if (cosW > 1.0) cosW = 1.0;
+    if (cosW < -1.0) cosW = -1.0;
+    float halfDayHours = acos(cosW) * RAD_TO_DEG / 15.0;
+
+    // Clear-sky irradiance at noon from the noon elevation (Meinel air mass model)
+    float noonElevation = HALF_PI - fabs(lat - declination);
+    float peak = 0.0;
+    if (noonElevation > 0.01) {
+        float sinElevation = sin(noonElevation);
+        float airMass = 1.0 / sinElevation;
+        peak = sinElevation * pow(0.7, pow(airMass, 0.678)) / 0.7;
+    }
+
+    SunDay day = {12.0f - halfDayHours, 12.0f + halfDayHours, peak};
+    return day;
+}
+
+float SunModel::irradiance(const SunDay& day, float hour) {
+    // Half-sine between sunrise and sunset, scaled to the day's peak
+    if (hour < day.sunrise || hour >= day.sunset) {
+        return 0.0;  // No sun at night
+    }
+
+    float angle = (hour - day.sunrise) / (day.sunset - day.sunrise) * PI;  // 0 to π
+    return day.peak * sin(angle);
+}
+
+int SunModel::monthOfDay(int dayOfYear) {
+    static const uint16_t firstDayOfMonth[12] = {1, 32, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335};
+    int month = 11;
+    while (month > 0 && dayOfYear < firstDayOfMonth[month]) month--;
+    return month;
+}
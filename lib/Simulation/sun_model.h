@@ -0,0 +1,21 @@
+#ifndef SUN_MODEL_H
+#define SUN_MODEL_H
+
+#include <Arduino.h>
+
+// Sun geometry of one day, precomputed once per simulated day
+struct SunDay {
+    float sunrise;   // Hour (local solar time)
+    float sunset;    // Hour (local solar time)
+    float peak;      // Clear-sky irradiance at solar noon (fraction of 1000 W/m²)
+};
+
+class SunModel {
+public:
+    static SunDay fixedDay();                            // 06:00-18:00, peak 1.0
+    static SunDay forDay(float latitude, int dayOfYear);  // Latitude/season aware
+    static float irradiance(const SunDay& day, float hour);  // 0 to peak
+    static int monthOfDay(int dayOfYear);                // 0-11 (non-leap year)
+};
+
+#endif // SUN_MODEL_H
@@ -0,0 +1,142 @@
+#include "tariff.h"
+
+Tariff::Tariff() : rateCount(0), ruleCount(0) {
+    compileFlat();
+}
+
+bool Tariff::begin(const char* path) {
+    if (!LittleFS.begin(true)) {
+        Serial.println("Tariff: LittleFS not available, using flat rates");
+        return false;
+    }
+    if (!LittleFS.exists(path)) {
+        Serial.println("Tariff: no rule file, using flat rates");
+        return false;
+    }
+    return load(path);
+}
+
+bool Tariff::load(const char* path) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+
+    // Start from the flat rates, every rule overrides its months and slots
+    compileFlat();
+
+    char line[96];
+    while (file.available()) {
+        size_t length = file.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[length] = '\0';
+
+        // Skip header and comment lines
+        if (line[0] < '0' || line[0] > '9') continue;
+
+        if (!applyRule(line)) {
+            Serial.print("Tariff: ignoring rule ");
+            Serial.println(line);
+        }
+    }
+    file.close();
+
+    Serial.print("Tariff loaded: ");
+    Serial.print(ruleCount);
+    Serial.print(" rules, ");
+    Serial.print(rateCount);
+    Serial.println(" rates");
+    return true;
+}
+
+void Tariff::compileFlat() {
+    rates[0].importZAR = TARIFF_IMPORT_ZAR;
+    rates[0].importEUR = TARIFF_IMPORT_EUR;
+    rates[0].exportZAR = TARIFF_EXPORT_ZAR;
+    rates[0].exportEUR = TARIFF_EXPORT_EUR;
+    rateCount = 1;
+    ruleCount = 0;
+    memset(table, 0, sizeof(table));
+}
+
+bool Tariff::applyRule(const char* line) {
+    int firstMonth, lastMonth;
+    char start[8], end[8];
+    TariffRate rate;
+
+    if (sscanf(line, "%d-%d,%7[^,],%7[^,],%f,%f,%f,%f", &firstMonth, &lastMonth, start, end,
+               &rate.importZAR, &rate.importEUR, &rate.exportZAR, &rate.exportEUR) != 8) {
+        return false;
+    }
+
+    float startHour, endHour;
+    if (firstMonth < 1 || firstMonth > 12 || lastMonth < 1 || lastMonth > 12 ||
+        !parseHour(start, startHour) || !parseHour(end, endHour)) {
+        return false;
+    }
+
+    // Reuse an identical rate entry, otherwise allocate a new one
+    int index = -1;
+    for (int i = 0; i < rateCount; i++) {
+        if (memcmp(&rates[i], &rate, sizeof(rate)) == 0) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        if (rateCount >= TARIFF_MAX_RATES) return false;
+        index = rateCount++;
+        rates[index] = rate;
+    }
+
+    // Month ranges and time windows may wrap (e.g. 11-2, 22:00-06:00)
+    // Equal start and end (e.g. 00:00-24:00) covers the whole day
+    int firstSlot = (int)(startHour * (TARIFF_SLOTS_PER_DAY / 24.0f) + 0.5f) % TARIFF_SLOTS_PER_DAY;
+    int endSlot = (int)(endHour * (TARIFF_SLOTS_PER_DAY / 24.0f) + 0.5f) % TARIFF_SLOTS_PER_DAY;
+    int slotCount = (endSlot - firstSlot + TARIFF_SLOTS_PER_DAY) % TARIFF_SLOTS_PER_DAY;
+    if (slotCount == 0) slotCount = TARIFF_SLOTS_PER_DAY;
+
+    int month = firstMonth - 1;
+    while (true) {
+        for (int i = 0; i < slotCount; i++) {
+            table[month][(firstSlot + i) % TARIFF_SLOTS_PER_DAY] = index;
+        }
+        if (month == lastMonth - 1) break;
+        month = (month + 1) % 12;
+    }
+
+    ruleCount++;
+    return true;
+}
+
+bool Tariff::parseHour(const char* text, float& hour) {
+    int hours, minutes = 0;
+    if (sscanf(text, "%d:%d", &hours, &minutes) < 1) return false;
+    if (hours < 0 || hours > 24 || minutes < 0 || minutes > 59) return false;
+    if (hours == 24 && minutes != 0) return false;  // 24:00 is the end of the day, nothing later
+
+    hour = hours + minutes / 60.0;
+    return true;
+}
+
+String Tariff::getJson() {
+    String json = "{";
+    json += "\"rules\":" + String(ruleCount) + ",";
+    json += "\"slotsPerDay\":" + String(TARIFF_SLOTS_PER_DAY) + ",";
+    json += "\"rates\":[";
+    for (int i = 0; i < rateCount; i++) {
+        if (i > 0) json += ",";
+        json += "{\"importZAR\":" + String(rates[i].importZAR, 2);
+        json += ",\"importEUR\":" + String(rates[i].importEUR, 3);
+        json += ",\"exportZAR\":" + String(rates[i].exportZAR, 2);
+        json += ",\"exportEUR\":" + String(rates[i].exportEUR, 3) + "}";
+    }
+    json += "],\"table\":[";
+    for (int m = 0; m < 12; m++) {
+        if (m > 0) json += ",";
+        json += "\"";
+        for (int slot = 0; slot < TARIFF_SLOTS_PER_DAY; slot++) {
+            json += "0123456789abcdef"[table[m][slot] & 0x0F];  // Rate index per slot
+        }
+        json += "\"";
+    }
+    json += "]}";
+    return json;
+}
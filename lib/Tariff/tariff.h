@@ -0,0 +1,46 @@
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+
+// Import/export prices per kWh
+struct TariffRate {
+    float importZAR;
+    float importEUR;
+    float exportZAR;
+    float exportEUR;
+};
+
+// Time-of-use and seasonal tariff, compiled into a month x slot lookup table
+// Rule file lines: months,start,end,importZAR,importEUR,exportZAR,exportEUR
+// e.g. "6-8,17:00,20:00,5.80,0.33,1.17,0.06" (later rules override earlier ones)
+class Tariff {
+public:
+    Tariff();
+    bool begin(const char* path = "/tariff.csv");  // Load rules, flat rates if missing
+    bool load(const char* path);
+
+    // O(1) lookup for the step loop (month 0-11)
+    inline const TariffRate& rateAt(int month, float hourOfDay) const {
+        int slot = (int)(hourOfDay * (TARIFF_SLOTS_PER_DAY / 24.0f));
+        if (slot < 0) slot = 0;
+        if (slot >= TARIFF_SLOTS_PER_DAY) slot = TARIFF_SLOTS_PER_DAY - 1;
+        return rates[table[month][slot]];
+    }
+
+    String getJson();
+
+private:
+    TariffRate rates[TARIFF_MAX_RATES];
+    int rateCount;
+    uint8_t table[12][TARIFF_SLOTS_PER_DAY];  // Rate index per month and slot
+    int ruleCount;
+
+    void compileFlat();
+    bool applyRule(const char* line);
+    static bool parseHour(const char* text, float& hour);
+};
+
+#endif // TARIFF_H
@@ -1,7 +1,27 @@
 #include "transistor.h"
-#include "config.h"
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
 
-Transistor::Transistor() : state1(1), state2(0), state3(0), state4(0) {
+// All outputs live in GPIO_OUT_REG (GPIO 0-31), so one store switches all four
+#if TRANSISTOR_1 > 31 || TRANSISTOR_2 > 31 || TRANSISTOR_3 > 31 || TRANSISTOR_4 > 31
+#error "Transistor pins must be GPIO 0-31 for single-store switching"
+#endif
+
+// Schedule events run in the timer ISR when the core supports it (no task switch
+// between the deadline and the output), else from the esp_timer task
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define TRANSISTOR_TIMER_DISPATCH ESP_TIMER_ISR
+#else
+#define TRANSISTOR_TIMER_DISPATCH ESP_TIMER_TASK
+#endif
+
+Transistor::Transistor() : stateMask(0x01), scheduleCount(0), scheduleIndex(0), scheduleRunning(false), scheduleStartUs(0), timer(nullptr) {
+    outputLock = portMUX_INITIALIZER_UNLOCKED;
+    pinBits[0] = 1UL << TRANSISTOR_1;
+    pinBits[1] = 1UL << TRANSISTOR_2;
+    pinBits[2] = 1UL << TRANSISTOR_3;
+    pinBits[3] = 1UL << TRANSISTOR_4;
+    pinMask = pinBits[0] | pinBits[1] | pinBits[2] | pinBits[3];
 }
 
 void Transistor::begin() {
@@ -9,38 +29,166 @@ void Transistor::begin() {
     pinMode(TRANSISTOR_2, OUTPUT);
     pinMode(TRANSISTOR_3, OUTPUT);
     pinMode(TRANSISTOR_4, OUTPUT);
-    
+
     update();
-    
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &Transistor::onTimer;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = TRANSISTOR_TIMER_DISPATCH;
+    timerArgs.name = "transistor";
+    if (esp_timer_create(&timerArgs, &timer) != ESP_OK) {
+        Serial.println("Transistor schedule timer could not be created");
+    }
+
     Serial.println("GPIO 15-18 (Transistors 1-4) initialized");
 }
 
 void Transistor::setState(int t1, int t2, int t3, int t4) {
-    state1 = t1;
-    state2 = t2;
-    state3 = t3;
-    state4 = t4;
+    setMask((t1 ? 0x01 : 0) | (t2 ? 0x02 : 0) | (t3 ? 0x04 : 0) | (t4 ? 0x08 : 0));
+}
+
+void Transistor::setMask(uint8_t mask) {
+    portENTER_CRITICAL(&outputLock);
+    stateMask = mask & 0x0F;
+    portEXIT_CRITICAL(&outputLock);
 }
 
 void Transistor::update() {
-    digitalWrite(TRANSISTOR_1, state1 ? HIGH : LOW);
-    digitalWrite(TRANSISTOR_2, state2 ? HIGH : LOW);
-    digitalWrite(TRANSISTOR_3, state3 ? HIGH : LOW);
-    digitalWrite(TRANSISTOR_4, state4 ? HIGH : LOW);
+    portENTER_CRITICAL(&outputLock);
+    writeOutputs(stateMask);
+    portEXIT_CRITICAL(&outputLock);
+}
+
+uint8_t Transistor::getMask() {
+    return stateMask;
 }
 
 int Transistor::getState1() {
-    return state1;
+    return (stateMask >> 0) & 1;
 }
 
 int Transistor::getState2() {
-    return state2;
+    return (stateMask >> 1) & 1;
 }
 
 int Transistor::getState3() {
-    return state3;
+    return (stateMask >> 2) & 1;
 }
 
 int Transistor::getState4() {
-    return state4;
+    return (stateMask >> 3) & 1;
+}
+
+void IRAM_ATTR Transistor::writeOutputs(uint8_t mask) {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        if (mask & (1 << i)) bits |= pinBits[i];
+    }
+
+    // One store for all four outputs, so they switch on the same clock edge. The
+    // read-modify-write keeps the other GPIO 0-31 outputs and runs under outputLock.
+    REG_WRITE(GPIO_OUT_REG, (REG_READ(GPIO_OUT_REG) & ~pinMask) | bits);
+}
+
+bool Transistor::addScheduleEvent(int transistor, int state, uint32_t offsetUs) {
+    if (scheduleRunning || transistor < 1 || transistor > 4 || scheduleCount >= TRANSISTOR_SCHEDULE_SIZE) {
+        return false;
+    }
+
+    // Insert sorted by offset; events at the same instant are merged into one write
+    uint8_t bit = 1 << (transistor - 1);
+    int pos = scheduleCount;
+    for (int i = 0; i < scheduleCount; i++) {
+        if (schedule[i].offsetUs == offsetUs) {
+            schedule[i].mask |= bit;
+            schedule[i].state = state ? (schedule[i].state | bit) : (schedule[i].state & ~bit);
+            return true;
+        }
+        if (schedule[i].offsetUs > offsetUs) {
+            pos = i;
+            break;
+        }
+    }
+
+    for (int i = scheduleCount; i > pos; i--) {
+        schedule[i] = schedule[i - 1];
+    }
+    schedule[pos].offsetUs = offsetUs;
+    schedule[pos].mask = bit;
+    schedule[pos].state = state ? bit : 0;
+    scheduleCount++;
+    return true;
+}
+
+void Transistor::clearSchedule() {
+    stopSchedule();
+    scheduleCount = 0;
+}
+
+bool Transistor::startSchedule() {
+    if (timer == nullptr || scheduleCount == 0) return false;
+
+    stopSchedule();
+    scheduleIndex = 0;
+    scheduleRunning = true;
+    scheduleStartUs = esp_timer_get_time();
+
+    // Offsets are absolute to the start, so timer latency never accumulates
+    esp_timer_start_once(timer, schedule[0].offsetUs);
+
+    Serial.print("Transistor schedule started: ");
+    Serial.print(scheduleCount);
+    Serial.println(" events");
+    return true;
+}
+
+void Transistor::stopSchedule() {
+    if (timer != nullptr) {
+        esp_timer_stop(timer);
+    }
+    scheduleRunning = false;
+}
+
+bool Transistor::isScheduleRunning() {
+    return scheduleRunning;
+}
+
+void IRAM_ATTR Transistor::onTimer(void* arg) {
+    Transistor* self = (Transistor*)arg;
+    int64_t elapsedUs = esp_timer_get_time() - self->scheduleStartUs;
+
+    // Apply every event that is due (normally exactly one)
+    portENTER_CRITICAL_ISR(&self->outputLock);
+    while (self->scheduleIndex < self->scheduleCount &&
+           (int64_t)self->schedule[self->scheduleIndex].offsetUs <= elapsedUs) {
+        const TransistorEvent& event = self->schedule[self->scheduleIndex];
+        self->stateMask = (self->stateMask & ~event.mask) | (event.state & event.mask);
+        self->writeOutputs(self->stateMask);
+        self->scheduleIndex = self->scheduleIndex + 1;
+    }
+    portEXIT_CRITICAL_ISR(&self->outputLock);
+
+    if (self->scheduleIndex < self->scheduleCount) {
+        int64_t nextUs = self->schedule[self->scheduleIndex].offsetUs - (esp_timer_get_time() - self->scheduleStartUs);
+        esp_timer_start_once(self->timer, nextUs > 0 ? nextUs : 0);
+    } else {
+        self->scheduleRunning = false;
+    }
+}
+
+String Transistor::getScheduleJson() {
+    String json = "{";
+    json += "\"running\":" + String(scheduleRunning ? "true" : "false") + ",";
+    json += "\"next\":" + String(scheduleIndex) + ",";
+    json += "\"mask\":" + String(stateMask) + ",";
+    json += "\"events\":[";
+    for (int i = 0; i < scheduleCount; i++) {
+        if (i > 0) json += ",";
+        json += "{\"at\":" + String(schedule[i].offsetUs);
+        json += ",\"mask\":" + String(schedule[i].mask);
+        json += ",\"state\":" + String(schedule[i].state) + "}";
+    }
+    json += "]}";
+    return json;
 }
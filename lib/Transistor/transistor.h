@@ -2,23 +2,53 @@
 #define TRANSISTOR_H
 
 #include <Arduino.h>
+#include <esp_timer.h>
+#include "config.h"
+
+// One timed switching event of the schedule
+struct TransistorEvent {
+    uint32_t offsetUs;  // Time after schedule start (µs)
+    uint8_t mask;       // Affected transistors (bit 0 = transistor 1)
+    uint8_t state;      // New state bits for the affected transistors
+};
 
 class Transistor {
 public:
     Transistor();
     void begin();
     void setState(int t1, int t2, int t3, int t4);
-    void update();
+    void setMask(uint8_t mask);  // bit 0 = transistor 1 ... bit 3 = transistor 4
+    void update();               // Commit all outputs in one register store
+    uint8_t getMask();
     int getState1();
     int getState2();
     int getState3();
     int getState4();
 
+    // Timed switching schedule (executed from esp_timer)
+    bool addScheduleEvent(int transistor, int state, uint32_t offsetUs);
+    void clearSchedule();
+    bool startSchedule();
+    void stopSchedule();
+    bool isScheduleRunning();
+    String getScheduleJson();
+
 private:
-    int state1;
-    int state2;
-    int state3;
-    int state4;
+    volatile uint8_t stateMask;
+    uint32_t pinBits[4];  // GPIO_OUT bit per transistor
+    uint32_t pinMask;     // All transistor bits
+    portMUX_TYPE outputLock;  // Guards stateMask and GPIO_OUT_REG against the timer ISR
+
+    // Schedule state
+    TransistorEvent schedule[TRANSISTOR_SCHEDULE_SIZE];
+    int scheduleCount;
+    volatile int scheduleIndex;
+    volatile bool scheduleRunning;
+    int64_t scheduleStartUs;
+    esp_timer_handle_t timer;
+
+    void writeOutputs(uint8_t mask);  // Caller holds outputLock
+    static void onTimer(void* arg);
 };
 
 #endif // TRANSISTOR_H
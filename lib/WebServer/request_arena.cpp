@@ -0,0 +1,55 @@
+#include "request_arena.h"
+#include <stdarg.h>
+
+RequestArena::RequestArena() : used(0), highWater(0), failures(0) {
+}
+
+void* RequestArena::allocate(size_t size) {
+    size_t aligned = (size + 3) & ~(size_t)3;
+    if (used + aligned > sizeof(buffer)) {
+        failures++;
+        return nullptr;
+    }
+    void* block = buffer + used;
+    used += aligned;
+    if (used > highWater) highWater = used;
+    return block;
+}
+
+const char* RequestArena::format(const char* format, ...) {
+    // Format into the free tail, then keep only what was written
+    size_t available = sizeof(buffer) - used;
+    char* out = (char*)(buffer + used);
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(out, available, format, args);
+    va_end(args);
+    
+    if (length < 0 || (size_t)length >= available) {
+        failures++;
+        return nullptr;
+    }
+    return (const char*)allocate(length + 1);
+}
+
+void RequestArena::reset() {
+    used = 0;
+}
+
+size_t RequestArena::getUsed() {
+    return used;
+}
+
+size_t RequestArena::getHighWater() {
+    return highWater;
+}
+
+size_t RequestArena::takeHighWater() {
+    size_t value = highWater;
+    highWater = used;
+    return value;
+}
+
+uint32_t RequestArena::getFailures() {
+    return failures;
+}
@@ -0,0 +1,28 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Bump allocator for one HTTP request: handlers take scratch memory from a
+// fixed buffer and everything is released at once after the response
+class RequestArena {
+public:
+    RequestArena();
+    void* allocate(size_t size);                      // 4-byte aligned, nullptr when full
+    const char* format(const char* format, ...);      // printf into the arena
+    void reset();
+
+    size_t getUsed();
+    size_t getHighWater();                            // Since the last takeHighWater()
+    size_t takeHighWater();
+    uint32_t getFailures();
+
+private:
+    uint8_t buffer[REQUEST_ARENA_SIZE] __attribute__((aligned(4)));
+    size_t used;
+    size_t highWater;
+    uint32_t failures;  // Allocations that did not fit
+};
+
+#endif // REQUEST_ARENA_H
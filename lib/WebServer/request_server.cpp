@@ -0,0 +1,46 @@
+#include "request_server.h"
+
+RequestServer::RequestServer(int port) : WebServer(port), stringReplyBytes(0) {
+}
+
+const String* RequestServer::find(const char* name) {
+    for (int i = 0; i < _currentArgCount; i++) {
+        if (strcmp(_currentArgs[i].key.c_str(), name) == 0) return &_currentArgs[i].value;
+    }
+    return nullptr;
+}
+
+bool RequestServer::hasArg(const char* name) {
+    return find(name) != nullptr;
+}
+
+const char* RequestServer::argView(const char* name) {
+    const String* value = find(name);
+    return value != nullptr ? value->c_str() : "";
+}
+
+long RequestServer::argInt(const char* name, long fallback) {
+    const String* value = find(name);
+    return value != nullptr ? strtol(value->c_str(), nullptr, 10) : fallback;
+}
+
+float RequestServer::argFloat(const char* name, float fallback) {
+    const String* value = find(name);
+    return value != nullptr ? strtof(value->c_str(), nullptr) : fallback;
+}
+
+bool RequestServer::argEquals(const char* name, const char* value) {
+    const String* arg = find(name);
+    return arg != nullptr && strcmp(arg->c_str(), value) == 0;
+}
+
+void RequestServer::send(int code, const char* contentType, const String& content) {
+    stringReplyBytes += content.length();
+    WebServer::send(code, contentType, content);
+}
+
+size_t RequestServer::takeStringReplyBytes() {
+    size_t bytes = stringReplyBytes;
+    stringReplyBytes = 0;
+    return bytes;
+}
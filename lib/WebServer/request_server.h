@@ -0,0 +1,28 @@
+#ifndef REQUEST_SERVER_H
+#define REQUEST_SERVER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+// WebServer with copy-free argument access: values are returned as views into
+// the argument Strings the WebServer parsed for the current request
+class RequestServer : public WebServer {
+public:
+    RequestServer(int port);
+    bool hasArg(const char* name);
+    const char* argView(const char* name);            // "" when missing, valid until the request ends
+    long argInt(const char* name, long fallback);
+    float argFloat(const char* name, float fallback);
+    bool argEquals(const char* name, const char* value);
+
+    // Replies whose body was built in a String (heap), counted per request
+    void send(int code, const char* contentType, const String& content);
+    size_t takeStringReplyBytes();                    // Since the last call
+
+private:
+    size_t stringReplyBytes;
+
+    const String* find(const char* name);
+};
+
+#endif // REQUEST_SERVER_H
@@ -1,7 +1,34 @@
 #include "web_server.h"
+#include <esp_heap_caps.h>
+#include "psram_alloc.h"
 
-WebServerManager::WebServerManager(Transistor* transistorRef, Simulation* simulationRef, INA* inaRef) 
-    : server(80), transistor(transistorRef), simulation(simulationRef), ina(inaRef) {
+// Whole-day kernel buffers: PSRAM when fitted, internal RAM otherwise
+static DayBuffers* allocateDayBuffers() {
+    return (DayBuffers*)allocateLarge(sizeof(DayBuffers));
+}
+
+// Compressed series stream: "GRLA", version, integer channels, float channels and
+// mantissa bits, then per block its point count and encoded bits (uint16, little
+// endian) followed by the block bytes
+static size_t writeSeriesHeader(uint8_t* out, int intChannels, int floatChannels, int mantissaBits) {
+    memcpy(out, "GRLA", 4);
+    out[4] = 1;
+    out[5] = intChannels;
+    out[6] = floatChannels;
+    out[7] = mantissaBits;
+    return 8;
+}
+
+static size_t writeBlockHeader(uint8_t* out, uint16_t count, uint16_t bits) {
+    out[0] = count & 0xFF;
+    out[1] = count >> 8;
+    out[2] = bits & 0xFF;
+    out[3] = bits >> 8;
+    return 4;
+}
+
+WebServerManager::WebServerManager(Transistor* transistorRef, Simulation* simulationRef, INA* inaRef, Calibration* calibrationRef, ReplaySource* replayRef, Tariff* tariffRef, Scheduler* schedulerRef, FleetHub* fleetRef, MqttPublisher* mqttRef, History* historyRef, AnomalyDetector* anomalyRef, ScenarioQueue* scenariosRef, PvModel* pvRef, PanelArray* arrayRef, RollupStore* rollupsRef) 
+    : server(80), routeCount(0), transistor(transistorRef), simulation(simulationRef), ina(inaRef), calibration(calibrationRef), replay(replayRef), tariff(tariffRef), scheduler(schedulerRef), fleet(fleetRef), mqtt(mqttRef), history(historyRef), anomaly(anomalyRef), scenarios(scenariosRef), pv(pvRef), array(arrayRef), rollups(rollupsRef) {
 }
 
 void WebServerManager::begin() {
@@ -13,22 +40,86 @@ void WebServerManager::begin() {
     Serial.println("LittleFS erfolgreich gemountet");
     
     // Routen definieren
-    server.on("/", [this]() { this->handleRoot(); });
-    server.on("/set", HTTP_POST, [this]() { this->handleSetTransistor(); });
-    server.on("/status", HTTP_GET, [this]() { this->handleGetStatus(); });
+    on("/", HTTP_ANY, &WebServerManager::handleRoot);
+    on("/set", HTTP_POST, &WebServerManager::handleSetTransistor);
+    on("/status", HTTP_GET, &WebServerManager::handleGetStatus);
+    on("/schedule", HTTP_POST, &WebServerManager::handleSchedule);
+    on("/schedule", HTTP_GET, &WebServerManager::handleGetSchedule);
     
     // Simulation endpoints
-    server.on("/simulation", HTTP_POST, [this]() { this->handleSimulation(); });
-    server.on("/simulation/data", HTTP_GET, [this]() { this->handleSimulationData(); });
-    server.on("/simulation/panel", HTTP_POST, [this]() { this->handleSetPanel(); });
-    server.on("/simulation/cell", HTTP_POST, [this]() { this->handleSetCell(); });
-    server.on("/simulation/load", HTTP_POST, [this]() { this->handleSetLoad(); });
-    server.on("/simulation/autotoggle", HTTP_POST, [this]() { this->handleAutoToggleLoads(); });
-    server.on("/simulation/currentmultiplier", HTTP_POST, [this]() { this->handleCurrentMultiplier(); });
-    server.on("/simulation/overview", HTTP_GET, [this]() { this->handleSimulationOverview(); });
+    on("/simulation", HTTP_POST, &WebServerManager::handleSimulation);
+    on("/simulation/data", HTTP_GET, &WebServerManager::handleSimulationData);
+    on("/simulation/panel", HTTP_POST, &WebServerManager::handleSetPanel);
+    on("/simulation/cell", HTTP_POST, &WebServerManager::handleSetCell);
+    on("/simulation/load", HTTP_POST, &WebServerManager::handleSetLoad);
+    on("/simulation/autotoggle", HTTP_POST, &WebServerManager::handleAutoToggleLoads);
+    on("/simulation/optimizer", HTTP_POST, &WebServerManager::handleOptimizer);
+    on("/simulation/optimizer", HTTP_GET, &WebServerManager::handleGetOptimizer);
+    on("/simulation/currentmultiplier", HTTP_POST, &WebServerManager::handleCurrentMultiplier);
+    on("/simulation/overview", HTTP_GET, &WebServerManager::handleSimulationOverview);
+    on("/simulation/overview/hourly", HTTP_GET, &WebServerManager::handleSimulationHourly);
+    on("/simulation/dataset", HTTP_POST, &WebServerManager::handleSimulationDataset);
+    on("/simulation/annual", HTTP_POST, &WebServerManager::handleSimulationAnnual);
+    on("/simulation/export", HTTP_GET, &WebServerManager::handleSimulationExport);
+    on("/simulation/benchmark", HTTP_GET, &WebServerManager::handleSimulationBenchmark);
+    on("/simulation/pv", HTTP_GET, &WebServerManager::handleSimulationPv);
+    on("/simulation/array", HTTP_POST, &WebServerManager::handleSimulationArray);
+    on("/simulation/array", HTTP_GET, &WebServerManager::handleGetSimulationArray);
+    on("/simulation/array/benchmark", HTTP_GET, &WebServerManager::handleSimulationArrayBenchmark);
+    
+    // Irradiance dataset endpoints
+    on("/dataset/import", HTTP_POST, &WebServerManager::handleDatasetImport);
+    on("/dataset", HTTP_GET, &WebServerManager::handleDatasetInfo);
+    
+    // Tariff endpoints
+    on("/tariff", HTTP_GET, &WebServerManager::handleTariff);
+    on("/tariff/reload", HTTP_POST, &WebServerManager::handleTariffReload);
     
     // Real data endpoint
-    server.on("/real/data", HTTP_GET, [this]() { this->handleRealData(); });
+    on("/real/data", HTTP_GET, &WebServerManager::handleRealData);
+    on("/real/status", HTTP_GET, &WebServerManager::handleRealStatus);
+    
+    // Calibration endpoints
+    on("/calibration", HTTP_GET, &WebServerManager::handleCalibration);
+    on("/calibration/sample", HTTP_POST, &WebServerManager::handleCalibrationSample);
+    on("/calibration/fit", HTTP_POST, &WebServerManager::handleCalibrationFit);
+    on("/calibration/reset", HTTP_POST, &WebServerManager::handleCalibrationReset);
+    
+    // Trace replay endpoints
+    on("/replay", HTTP_POST, &WebServerManager::handleReplay);
+    on("/replay", HTTP_GET, &WebServerManager::handleReplayStatus);
+    
+    // System endpoints
+    on("/system/scheduler", HTTP_GET, &WebServerManager::handleSystemScheduler);
+    on("/system/heap", HTTP_GET, &WebServerManager::handleSystemHeap);
+    
+    // Fleet hub
+    on("/fleet", HTTP_GET, &WebServerManager::handleFleet);
+    on("/fleet/series", HTTP_GET, &WebServerManager::handleFleetSeries);
+    on("/fleet/benchmark", HTTP_GET, &WebServerManager::handleFleetBenchmark);
+    
+    // MQTT telemetry
+    on("/mqtt", HTTP_GET, &WebServerManager::handleMqtt);
+    on("/mqtt/benchmark", HTTP_GET, &WebServerManager::handleMqttBenchmark);
+    
+    // Run history, downsampled for the charts
+    on("/history", HTTP_GET, &WebServerManager::handleHistory);
+    on("/history/status", HTTP_GET, &WebServerManager::handleHistoryStatus);
+    on("/history/export", HTTP_GET, &WebServerManager::handleHistoryExport);
+    on("/history/benchmark", HTTP_GET, &WebServerManager::handleHistoryBenchmark);
+    
+    // Long-term measurement rollups
+    on("/rollup", HTTP_GET, &WebServerManager::handleRollup);
+    on("/rollup/status", HTTP_GET, &WebServerManager::handleRollupStatus);
+    
+    // Detected events (shading, connectors, clouds)
+    on("/events", HTTP_GET, &WebServerManager::handleEvents);
+    on("/events/benchmark", HTTP_GET, &WebServerManager::handleEventsBenchmark);
+    
+    // Queued batch scenarios
+    on("/jobs", HTTP_POST, &WebServerManager::handleJobSubmit);
+    on("/jobs", HTTP_GET, &WebServerManager::handleJobs);
+    on("/jobs/cancel", HTTP_POST, &WebServerManager::handleJobCancel);
     
     server.onNotFound([this]() { this->handleNotFound(); });
     
@@ -40,6 +131,50 @@ void WebServerManager::handleClient() {
     server.handleClient();
 }
 
+void WebServerManager::on(const char* path, HTTPMethod method, void (WebServerManager::*handler)()) {
+    RouteStats* stats = nullptr;
+    if (routeCount < WEB_MAX_ROUTES) {
+        stats = &routes[routeCount++];
+        *stats = {path, method, 0, 0, 0, 0, 0, UINT32_MAX, 0.0};
+    }
+    
+    // Free-heap deltas around a handler mostly show the WiFi and lwIP tasks, so a
+    // route is measured by what it does itself: arena use and String reply size
+    server.on(path, method, [this, handler, stats]() {
+        uint32_t arenaFailures = arena.getFailures();
+        server.takeStringReplyBytes();
+        (this->*handler)();
+        
+        if (stats != nullptr) {
+            uint32_t freeAfter = ESP.getFreeHeap();
+            size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            size_t internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            float fragmentation = internal > 0 ? 1.0 - (float)largest / internal : 0.0;
+            size_t replyBytes = server.takeStringReplyBytes();
+            
+            stats->calls++;
+            stats->arenaFailures += arena.getFailures() - arenaFailures;
+            if (replyBytes > 0) {
+                stats->stringReplies++;
+                stats->maxStringReply = max(stats->maxStringReply, (uint32_t)replyBytes);
+            }
+            stats->minFreeHeap = min(stats->minFreeHeap, freeAfter);
+            stats->maxFragmentation = max(stats->maxFragmentation, fragmentation);
+            stats->arenaHighWater = max(stats->arenaHighWater, (uint32_t)arena.takeHighWater());
+        }
+        arena.reset();
+    });
+}
+
+void WebServerManager::sendJson(int code, const char* json) {
+    if (json == nullptr) {
+        code = 500;
+        json = "{\"error\":\"Response too large\"}";
+    }
+    server.sendHeader("Connection", "close");
+    server.send_P(code, "application/json", json);
+}
+
 void WebServerManager::handleRoot() {
     File file = LittleFS.open("/index.html", "r");
     if (!file) {
@@ -53,12 +188,18 @@ void WebServerManager::handleRoot() {
 
 void WebServerManager::handleSetTransistor() {
     if (!server.hasArg("transistor") || !server.hasArg("state")) {
-        server.send(400, "application/json", "{\"error\":\"Missing parameters\"}");
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
         return;
     }
     
-    int transistorNum = server.arg("transistor").toInt();
-    int state = server.arg("state").toInt();
+    int transistorNum = server.argInt("transistor", 0);
+    int state = server.argInt("state", 0);
+    
+    // A running schedule owns the outputs
+    if (transistor->isScheduleRunning()) {
+        sendJson(409, "{\"error\":\"Schedule running\"}");
+        return;
+    }
     
     // Get current state
     int t1 = transistor->getState1();
@@ -73,7 +214,7 @@ void WebServerManager::handleSetTransistor() {
         case 3: t3 = state; break;
         case 4: t4 = state; break;
         default:
-            server.send(400, "application/json", "{\"error\":\"Invalid transistor number\"}");
+            sendJson(400, "{\"error\":\"Invalid transistor number\"}");
             return;
     }
     
@@ -81,36 +222,79 @@ void WebServerManager::handleSetTransistor() {
     transistor->setState(t1, t2, t3, t4);
     transistor->update();
     
-    String response = "{\"success\":true,\"transistor\":" + String(transistorNum) + 
-                     ",\"state\":" + String(state) + "}";
-    
-    server.sendHeader("Connection", "close");
-    server.send(200, "application/json", response);
+    sendJson(200, arena.format("{\"success\":true,\"transistor\":%d,\"state\":%d}", transistorNum, state));
 }
 
 void WebServerManager::handleGetStatus() {
-    String json = "{";
-    json += "\"t1\":" + String(transistor->getState1()) + ",";
-    json += "\"t2\":" + String(transistor->getState2()) + ",";
-    json += "\"t3\":" + String(transistor->getState3()) + ",";
-    json += "\"t4\":" + String(transistor->getState4());
-    json += "}";
+    sendJson(200, arena.format("{\"t1\":%d,\"t2\":%d,\"t3\":%d,\"t4\":%d}",
+        transistor->getState1(), transistor->getState2(), transistor->getState3(), transistor->getState4()));
+}
+
+void WebServerManager::handleSchedule() {
+    if (!server.hasArg("action")) {
+        sendJson(400, "{\"error\":\"Missing action parameter\"}");
+        return;
+    }
+    
+    const char* action = server.argView("action");
+    bool success = false;
+    
+    if (strcmp(action, "add") == 0) {
+        // at: seconds after schedule start, e.g. at=1.5 -> t+1.5 s
+        if (!server.hasArg("transistor") || !server.hasArg("state") || !server.hasArg("at")) {
+            sendJson(400, "{\"error\":\"Missing parameters\"}");
+            return;
+        }
+        int transistorNum = server.argInt("transistor", 0);
+        int state = server.argInt("state", 0);
+        float at = server.argFloat("at", -1.0);
+        if (!(at >= 0.0 && at <= TRANSISTOR_SCHEDULE_MAX_S)) {
+            sendJson(400, "{\"error\":\"Invalid parameters\"}");
+            return;
+        }
+        uint32_t offsetUs = (uint32_t)(at * 1000000.0);
+        success = transistor->addScheduleEvent(transistorNum, state, offsetUs);
+    }
+    else if (strcmp(action, "start") == 0) {
+        success = transistor->startSchedule();
+    }
+    else if (strcmp(action, "stop") == 0) {
+        transistor->stopSchedule();
+        success = true;
+    }
+    else if (strcmp(action, "clear") == 0) {
+        transistor->clearSchedule();
+        success = true;
+    }
+    else {
+        sendJson(400, "{\"error\":\"Invalid action\"}");
+        return;
+    }
+    
+    sendJson(success ? 200 : 409, arena.format("{\"success\":%s,\"action\":\"%s\"}", success ? "true" : "false", action));
+}
+
+void WebServerManager::handleGetSchedule() {
+    String json = transistor->getScheduleJson();
     
     server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     server.send(200, "application/json", json);
 }
 
 void WebServerManager::handleCurrentMultiplier() {
     if (!server.hasArg("multiplier")) {
-        server.send(400, "application/json", "{\"success\":false,\"error\":\"Missing multiplier parameter\"}");
+        sendJson(400, "{\"success\":false,\"error\":\"Missing multiplier parameter\"}");
         return;
     }
     
-    float multiplier = server.arg("multiplier").toFloat();
+    float multiplier = server.argFloat("multiplier", 0.0);
     simulation->setCurrentMultiplier(multiplier);
     
+    // A fitted calibration replaces the multiplier until it is reset
     String json = "{\"success\":true,\"currentMultiplier\":";
     json += String(multiplier);
+    json += ",\"calibrated\":" + String(calibration->isFitted() ? "true" : "false");
     json += "}";
     
     server.sendHeader("Connection", "close");
@@ -125,6 +309,74 @@ void WebServerManager::handleSimulationOverview() {
     server.send(200, "application/json", json);
 }
 
+void WebServerManager::handleSimulationHourly() {
+    String json = simulation->getHourlyJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleJobSubmit() {
+    ScenarioSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.days = server.argInt("days", 1);
+    spec.startDay = server.argInt("startDay", 172);
+    spec.stepMinutes = server.argInt("step", 30);
+    spec.seed = server.argInt("seed", 0);
+    spec.panels = server.argInt("panels", SIM_PANELS);
+    spec.cells = server.argInt("cells", SIM_CELLS);
+    spec.autoToggleLoads = server.argInt("autotoggle", 1) == 1;
+    int priority = server.argInt("priority", 0);
+    
+    bool valid = true;
+    if (!server.hasArg("mode") || server.argEquals("mode", "days")) spec.mode = SCENARIO_DAYS;
+    else if (server.argEquals("mode", "kernel")) spec.mode = SCENARIO_KERNEL;
+    else if (server.argEquals("mode", "dataset") && server.hasArg("file") && strlen(server.argView("file")) < sizeof(spec.file)) {
+        spec.mode = SCENARIO_DATASET;
+        strcpy(spec.file, server.argView("file"));
+    }
+    else valid = false;
+    
+    if (!valid || spec.days < 1 || spec.days > 3660 || spec.startDay < 1 || spec.startDay > 365 ||
+        !Simulation::isDayStep(spec.stepMinutes) || spec.panels < 0 || spec.panels > SIM_PANELS ||
+        spec.cells < 0 || spec.cells > SIM_CELLS || priority < 0 || priority > 9) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    spec.priority = priority;
+    
+    int32_t id = scenarios->submit(spec);
+    if (id < 0) {
+        sendJson(503, "{\"success\":false,\"error\":\"Job queue full\"}");
+        return;
+    }
+    sendJson(200, arena.format("{\"success\":true,\"id\":%ld}", (long)id));
+}
+
+void WebServerManager::handleJobs() {
+    // Without id: all jobs with status and progress; with id: one job and its result
+    String json = server.hasArg("id") ? scenarios->getJobJson(server.argInt("id", 0)) : scenarios->getJson();
+    if (json.length() == 0) {
+        sendJson(404, "{\"error\":\"Job not found\"}");
+        return;
+    }
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleJobCancel() {
+    if (!server.hasArg("id")) {
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
+        return;
+    }
+    
+    bool success = scenarios->cancel(server.argInt("id", 0));
+    sendJson(success ? 200 : 404, success ? "{\"success\":true}" : "{\"success\":false,\"error\":\"Job not found or finished\"}");
+}
+
 void WebServerManager::handleNotFound() {
     server.sendHeader("Connection", "close");
     server.send(404, "text/plain", "404: Not Found");
@@ -132,128 +384,953 @@ void WebServerManager::handleNotFound() {
 
 void WebServerManager::handleSimulation() {
     if (!server.hasArg("action")) {
-        server.sendHeader("Connection", "close");
-        server.send(400, "application/json", "{\"error\":\"Missing action parameter\"}");
+        sendJson(400, "{\"error\":\"Missing action parameter\"}");
         return;
     }
     
-    String action = server.arg("action");
+    const char* action = server.argView("action");
     
-    if (action == "start") {
+    if (strcmp(action, "start") == 0) {
         int duration = 30; // default
         if (server.hasArg("duration")) {
-            duration = server.arg("duration").toInt();
+            duration = server.argInt("duration", 0);
         }
         
         bool simulateSun = false; // default
         if (server.hasArg("simulateSun")) {
-            simulateSun = server.arg("simulateSun").toInt() == 1;
+            simulateSun = server.argInt("simulateSun", 0) == 1;
+        }
+        
+        // Multi-day runs: days per run, startDay = day of year (0 = fixed 06:00-18:00 day)
+        int days = server.argInt("days", 1);
+        int startDay = server.argInt("startDay", 0);
+        if (duration <= 0 || days <= 0 || startDay < 0 || startDay > 365) {
+            sendJson(400, "{\"error\":\"Invalid parameters\"}");
+            return;
         }
         
-        simulation->start(duration, simulateSun);
-        server.sendHeader("Connection", "close");
-        server.send(200, "application/json", "{\"success\":true,\"action\":\"start\"}");
+        simulation->start(duration, simulateSun, days, startDay);
+        sendJson(200, "{\"success\":true,\"action\":\"start\"}");
     } 
-    else if (action == "stop") {
+    else if (strcmp(action, "stop") == 0) {
         simulation->stop();
-        server.sendHeader("Connection", "close");
-        server.send(200, "application/json", "{\"success\":true,\"action\":\"stop\"}");
+        sendJson(200, "{\"success\":true,\"action\":\"stop\"}");
     }
     else {
-        server.sendHeader("Connection", "close");
-        server.send(400, "application/json", "{\"error\":\"Invalid action\"}");
+        sendJson(400, "{\"error\":\"Invalid action\"}");
     }
 }
 
 void WebServerManager::handleSimulationData() {
-    String json = simulation->getDataAsJson();
-    server.sendHeader("Connection", "close");
+    // Hot path of the dashboard poll: formatted straight into the request arena
+    char* json = (char*)arena.allocate(SIM_DATA_JSON_SIZE);
+    if (json != nullptr && simulation->writeDataJson(json, SIM_DATA_JSON_SIZE) == 0) json = nullptr;
     server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-    server.send(200, "application/json", json);
+    sendJson(200, json);
 }
 
 void WebServerManager::handleSetPanel() {
     if (!server.hasArg("panel") || !server.hasArg("state")) {
-        server.sendHeader("Connection", "close");
-        server.send(400, "application/json", "{\"error\":\"Missing parameters\"}");
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
         return;
     }
     
-    int panel = server.arg("panel").toInt();
-    bool state = server.arg("state").toInt() == 1;
+    int panel = server.argInt("panel", 0);
+    bool state = server.argInt("state", 0) == 1;
     
     simulation->setPanelState(panel, state);
     
-    String response = "{\"success\":true,\"panel\":" + String(panel) + 
-                     ",\"state\":" + String(state ? "true" : "false") + "}";
-    server.sendHeader("Connection", "close");
-    server.send(200, "application/json", response);
+    sendJson(200, arena.format("{\"success\":true,\"panel\":%d,\"state\":%s}", panel, state ? "true" : "false"));
 }
 
 void WebServerManager::handleSetCell() {
     if (!server.hasArg("cell") || !server.hasArg("state")) {
-        server.sendHeader("Connection", "close");
-        server.send(400, "application/json", "{\"error\":\"Missing parameters\"}");
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
         return;
     }
     
-    int cell = server.arg("cell").toInt();
-    bool state = server.arg("state").toInt() == 1;
+    int cell = server.argInt("cell", 0);
+    bool state = server.argInt("state", 0) == 1;
     
     simulation->setCellState(cell, state);
     
-    String response = "{\"success\":true,\"cell\":" + String(cell) + 
-                     ",\"state\":" + String(state ? "true" : "false") + "}";
-    server.sendHeader("Connection", "close");
-    server.send(200, "application/json", response);
+    sendJson(200, arena.format("{\"success\":true,\"cell\":%d,\"state\":%s}", cell, state ? "true" : "false"));
 }
 
 void WebServerManager::handleSetLoad() {
     if (!server.hasArg("load") || !server.hasArg("state")) {
-        server.sendHeader("Connection", "close");
-        server.send(400, "application/json", "{\"error\":\"Missing parameters\"}");
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
         return;
     }
     
-    String load = server.arg("load");
-    bool state = server.arg("state").toInt() == 1;
+    const char* load = server.argView("load");
+    bool state = server.argInt("state", 0) == 1;
     
     simulation->setLoadState(load, state);
     
-    String response = "{\"success\":true,\"load\":\"" + load + 
-                     "\",\"state\":" + String(state ? "true" : "false") + "}";
-    server.sendHeader("Connection", "close");
-    server.send(200, "application/json", response);
+    sendJson(200, arena.format("{\"success\":true,\"load\":\"%s\",\"state\":%s}", load, state ? "true" : "false"));
 }
 
 void WebServerManager::handleRealData() {
-    float busV = ina->getBusVoltage();
-    float currentMA = ina->getCurrent();
-    float powerMW = ina->getPower();
-    
-    String json = "{";
-    json += "\"voltage\":" + String(busV, 2) + ",";
-    json += "\"current\":" + String(currentMA, 2) + ",";
-    json += "\"power\":" + String(powerMW, 2);
-    json += "}";
+    // Served from the sensor job's last burst unless it is older than maxAge (ms)
+    int maxAge = server.argInt("maxAge", INA_MAX_AGE);
+    if (maxAge < 0) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // V, I and P of one burst, so they belong to the same instant
+    InaSample sample = ina->getSample(maxAge);
+    
+    const char* json = arena.format("{\"voltage\":%.2f,\"current\":%.2f,\"power\":%.2f,\"timeMs\":%lu,\"ageMs\":%lu,\"overflow\":%s}",
+        sample.voltage, sample.current, sample.power, (unsigned long)sample.timeMs,
+        (unsigned long)(sample.timeMs > 0 ? millis() - sample.timeMs : 0), sample.overflow ? "true" : "false");
     
-    server.sendHeader("Connection", "close");
     server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    sendJson(200, json);
+}
+
+void WebServerManager::handleRealStatus() {
+    String json = ina->getStatusJson();
+    
+    server.sendHeader("Connection", "close");
     server.send(200, "application/json", json);
 }
 
 void WebServerManager::handleAutoToggleLoads() {
     if (!server.hasArg("enable")) {
-        server.send(400, "application/json", "{\"success\":false,\"error\":\"Missing enable parameter\"}");
+        sendJson(400, "{\"success\":false,\"error\":\"Missing enable parameter\"}");
         return;
     }
     
-    bool enable = server.arg("enable") == "1" || server.arg("enable") == "true";
+    bool enable = server.argEquals("enable", "1") || server.argEquals("enable", "true");
     simulation->setAutoToggleLoads(enable);
     
-    String json = "{\"success\":true,\"autoToggleLoads\":";
-    json += enable ? "true" : "false";
-    json += "}";
+    sendJson(200, enable ? "{\"success\":true,\"autoToggleLoads\":true}" : "{\"success\":true,\"autoToggleLoads\":false}");
+}
+
+void WebServerManager::handleOptimizer() {
+    if (!server.hasArg("enable")) {
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
+        return;
+    }
+    
+    bool enable = server.argInt("enable", 0) == 1;
+    const char* objective = server.hasArg("objective") ? server.argView("objective") : "autarky";
+    if (strcmp(objective, "autarky") != 0 && strcmp(objective, "cost") != 0) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // Plans immediately (auto toggle must be on for the plan to be applied)
+    simulation->setOptimizedLoads(enable, strcmp(objective, "cost") == 0 ? OPTIMIZE_COST : OPTIMIZE_AUTARKY);
+    String json = simulation->getPlanJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleGetOptimizer() {
+    String json = simulation->getPlanJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleCalibration() {
+    String json = calibration->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleCalibrationSample() {
+    if (!server.hasArg("reference")) {
+        sendJson(400, "{\"success\":false,\"error\":\"Missing reference parameter\"}");
+        return;
+    }
+    
+    // Raw value defaults to a live INA219 reading taken now
+    float referenceMA = server.argFloat("reference", 0.0);
+    float rawMA = server.hasArg("raw") ? server.argFloat("raw", 0.0) : ina->getCurrent();
+    calibration->addSample(rawMA, referenceMA);
+    
+    String json = "{\"success\":true,\"raw\":" + String(rawMA, 2) + 
+                  ",\"reference\":" + String(referenceMA, 2) + 
+                  ",\"samples\":" + String(calibration->getSampleCount()) + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleCalibrationFit() {
+    bool success = calibration->fit();
+    
+    String json = "{\"success\":" + String(success ? "true" : "false") + 
+                  ",\"calibration\":" + calibration->getJson() + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(success ? 200 : 409, "application/json", json);
+}
+
+void WebServerManager::handleCalibrationReset() {
+    calibration->reset();
+    
+    sendJson(200, "{\"success\":true}");
+}
+
+void WebServerManager::handleReplay() {
+    if (!server.hasArg("action")) {
+        sendJson(400, "{\"error\":\"Missing action parameter\"}");
+        return;
+    }
+    
+    const char* action = server.argView("action");
+    
+    if (strcmp(action, "start") == 0) {
+        if (!server.hasArg("file")) {
+            sendJson(400, "{\"error\":\"Missing file parameter\"}");
+            return;
+        }
+        
+        const char* file = server.argView("file");
+        float speed = server.argFloat("speed", 1.0);
+        bool loop = server.argInt("loop", 0) == 1;
+        
+        if (!replay->start(file, speed, loop)) {
+            sendJson(404, "{\"success\":false,\"error\":\"Trace not found or empty\"}");
+            return;
+        }
+        
+        // Calibration branch now reads the trace instead of the INA219
+        simulation->setSampleSource(replay);
+    }
+    else if (strcmp(action, "stop") == 0) {
+        replay->stop();
+        simulation->setSampleSource(ina);
+    }
+    else {
+        sendJson(400, "{\"error\":\"Invalid action\"}");
+        return;
+    }
+    
+    String json = "{\"success\":true,\"replay\":" + replay->getStatusJson() + "}";
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleReplayStatus() {
+    String json = replay->getStatusJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleDatasetImport() {
+    if (!server.hasArg("csv") || !server.hasArg("file")) {
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
+        return;
+    }
+    
+    const char* csv = server.argView("csv");
+    const char* file = server.argView("file");
+    unsigned long startMs = millis();
+    
+    // Other jobs run between output blocks, sampling does not stall during a long import
+    if (!IrradianceDataset::import(csv, file, [this]() { scheduler->runPending(); })) {
+        sendJson(422, "{\"success\":false,\"error\":\"Import failed\"}");
+        return;
+    }
+    
+    IrradianceDataset dataset;
+    dataset.open(file);
+    String json = "{\"success\":true,\"elapsedMs\":" + String(millis() - startMs) + 
+                  ",\"dataset\":" + dataset.getInfoJson() + "}";
+    dataset.close();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleDatasetInfo() {
+    if (!server.hasArg("file")) {
+        sendJson(400, "{\"error\":\"Missing file parameter\"}");
+        return;
+    }
+    
+    IrradianceDataset dataset;
+    if (!dataset.open(server.argView("file"))) {
+        sendJson(404, "{\"error\":\"Dataset not found\"}");
+        return;
+    }
+    
+    String json = dataset.getInfoJson();
+    dataset.close();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationDataset() {
+    if (!server.hasArg("file")) {
+        sendJson(400, "{\"error\":\"Missing file parameter\"}");
+        return;
+    }
+    
+    if (simulation->isRunning()) {
+        sendJson(409, "{\"success\":false,\"error\":\"Simulation running\"}");
+        return;
+    }
+    
+    IrradianceDataset dataset;
+    if (!dataset.open(server.argView("file"))) {
+        sendJson(404, "{\"error\":\"Dataset not found\"}");
+        return;
+    }
+    
+    // Run on a copy so the live simulation keeps its panels, cells and results; other
+    // jobs run between steps and their time is not counted
+    Simulation run = *simulation;
+    uint32_t pausedUs = 0;
+    unsigned long startMs = millis();
+    uint32_t steps = run.runDataset(dataset, [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        pausedUs += scheduler->runPending();
+        return true;
+    });
+    unsigned long elapsedMs = millis() - startMs - pausedUs / 1000;
+    dataset.close();
+    
+    String json = "{\"success\":true,\"steps\":" + String(steps) + 
+                  ",\"elapsedMs\":" + String(elapsedMs) + 
+                  ",\"stepUs\":" + String(steps > 0 ? elapsedMs * 1000.0 / steps : 0.0, 2) + 
+                  ",\"overview\":" + run.getOverviewJson() + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationAnnual() {
+    int days = server.argInt("days", 365);
+    int startDay = server.argInt("startDay", 1);
+    int stepMinutes = server.argInt("step", 30);
+    
+    if (days < 1 || days > 3660 || startDay < 1 || startDay > 365 || !Simulation::isDayStep(stepMinutes)) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // Whole-day kernel unless kernel=0 or the buffers cannot be allocated
+    DayBuffers* buffers = !server.argEquals("kernel", "0") ? allocateDayBuffers() : nullptr;
+    
+    // Run on a copy so the live simulation keeps its panels, cells and results; other
+    // jobs run between steps (days for the kernel) and their time is not counted
+    Simulation run = *simulation;
+    uint32_t pausedUs = 0;
+    auto onStep = [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        pausedUs += scheduler->runPending();
+        return true;
+    };
+    unsigned long startMs = millis();
+    uint32_t steps = buffers ? run.runDaysKernel(startDay, days, stepMinutes, *buffers, onStep) : run.runDays(startDay, days, stepMinutes, onStep);
+    unsigned long elapsedMs = millis() - startMs - pausedUs / 1000;
+    free(buffers);
+    
+    String json = "{\"success\":true,\"days\":" + String(days) + 
+                  ",\"kernel\":" + String(buffers ? "true" : "false") + 
+                  ",\"steps\":" + String(steps) + 
+                  ",\"elapsedMs\":" + String(elapsedMs) + 
+                  ",\"stepUs\":" + String(steps > 0 ? elapsedMs * 1000.0 / steps : 0.0, 2) + 
+                  ",\"overview\":" + run.getOverviewJson() + 
+                  ",\"annual\":" + run.getAnnualJson() + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationBenchmark() {
+    int days = server.argInt("days", 7);
+    int stepMinutes = server.argInt("step", 1);
+    
+    if (days < 1 || days > SIM_BENCH_MAX_DAYS || !Simulation::isDayStep(stepMinutes)) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    DayBuffers* buffers = allocateDayBuffers();
+    if (buffers == nullptr) {
+        sendJson(507, "{\"error\":\"Out of memory\"}");
+        return;
+    }
+    
+    // Same days on two copies: one step at a time (as update() does) vs. whole days.
+    // Other jobs run every 64 steps (every day for the kernel); their time is subtracted.
+    uint32_t pausedUs = 0;
+    uint32_t calls = 0;
+    auto onStep = [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        if ((++calls & 63) == 0) pausedUs += scheduler->runPending();
+        return true;
+    };
+    auto onDay = [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        pausedUs += scheduler->runPending();
+        return true;
+    };
+    
+    Simulation stepped = *simulation;
+    uint32_t startUs = micros();
+    uint32_t steps = stepped.runDays(172, days, stepMinutes, onStep);
+    uint32_t steppedUs = micros() - startUs - pausedUs;
+    
+    Simulation batched = *simulation;
+    pausedUs = 0;
+    startUs = micros();
+    batched.runDaysKernel(172, days, stepMinutes, *buffers, onDay);
+    uint32_t kernelUs = micros() - startUs - pausedUs;
+    free(buffers);
+    
+    String json = "{\"days\":" + String(days) + 
+                  ",\"steps\":" + String(steps) + 
+                  ",\"simd\":" + String(Simulation::usesSimd() ? "true" : "false") + 
+                  ",\"steppedUs\":" + String(steppedUs) + 
+                  ",\"kernelUs\":" + String(kernelUs) + 
+                  ",\"steppedStepUs\":" + String(steps > 0 ? (float)steppedUs / steps : 0.0f, 3) + 
+                  ",\"kernelStepUs\":" + String(steps > 0 ? (float)kernelUs / steps : 0.0f, 3) + 
+                  ",\"speedup\":" + String(kernelUs > 0 ? (float)steppedUs / kernelUs : 0.0f, 1) + 
+                  ",\"steppedKWh\":" + String(stepped.getEnergyGenerated(), 2) +   // Same model, different noise
+                  ",\"kernelKWh\":" + String(batched.getEnergyGenerated(), 2) + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationPv() {
+    float irradiance = server.argFloat("irradiance", 1000.0);
+    float ambient = server.argFloat("temperature", 25.0);
+    
+    if (irradiance < 0.0 || irradiance > 1500.0 || ambient < -40.0 || ambient > 60.0) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // Direct Newton solve vs. the table the simulation uses, per panel
+    float cellTemperature = PvModel::cellTemperature(ambient, irradiance);
+    PvPoint point;
+    uint32_t startUs = micros();
+    pv->solve(irradiance, cellTemperature, point);
+    uint32_t solveUs = micros() - startUs;
+    
+    float tablePower = 0.0;
+    float tableVoltage = 0.0;
+    startUs = micros();
+    for (int i = 0; i < 1000; i++) pv->lookup(irradiance, cellTemperature, tablePower, tableVoltage);
+    float lookupNs = (micros() - startUs) * 1.0;  // 1000 lookups: µs total = ns each
+    
+    String json = "{\"irradiance\":" + String(irradiance, 1) + 
+                  ",\"ambient\":" + String(ambient, 1) + 
+                  ",\"cellTemperature\":" + String(cellTemperature, 1) + 
+                  ",\"solve\":{\"power\":" + String(point.power, 2) + 
+                  ",\"voltage\":" + String(point.voltage, 2) + 
+                  ",\"current\":" + String(point.current, 3) + 
+                  ",\"iterations\":" + String(point.iterations) + 
+                  ",\"us\":" + String(solveUs) + "}" + 
+                  ",\"table\":{\"power\":" + String(tablePower, 2) + 
+                  ",\"voltage\":" + String(tableVoltage, 2) + 
+                  ",\"ns\":" + String(lookupNs, 0) + "}" + 
+                  ",\"model\":" + pv->getJson() + "}";
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationArray() {
+    if (!server.hasArg("action")) {
+        sendJson(400, "{\"error\":\"Missing parameters\"}");
+        return;
+    }
+    
+    if (server.argEquals("action", "panels")) {
+        // Orientation, shading and fault for a range of panels, allowed during a run
+        int from = server.argInt("from", 0);
+        int to = server.argInt("to", from);
+        float azimuth = server.argFloat("azimuth", 0.0);
+        float shading = server.argFloat("shading", 0.0);
+        const char* faultName = server.hasArg("fault") ? server.argView("fault") : "ok";
+        PanelFault fault = PANEL_OK;
+        if (strcmp(faultName, "degraded") == 0) fault = PANEL_DEGRADED;
+        else if (strcmp(faultName, "bypassed") == 0) fault = PANEL_BYPASSED;
+        else if (strcmp(faultName, "open") == 0) fault = PANEL_OPEN;
+        else if (strcmp(faultName, "ok") != 0) from = -1;
+        
+        if (from < 0 || to < from || to >= array->getCount() || azimuth < -180.0 || azimuth > 180.0 || shading < 0.0 || shading > 1.0) {
+            sendJson(400, "{\"error\":\"Invalid parameters\"}");
+            return;
+        }
+        array->setPanels(from, to, azimuth, shading, fault);
+    } else {
+        // Layout changes only between runs
+        if (simulation->isRunning()) {
+            sendJson(409, "{\"success\":false,\"error\":\"Simulation running\"}");
+            return;
+        }
+        if (server.argEquals("action", "configure")) {
+            int panels = server.argInt("panels", 0);
+            int perString = server.argInt("perString", panels);
+            if (!array->configure(panels, perString)) {
+                sendJson(400, "{\"error\":\"Invalid parameters\"}");
+                return;
+            }
+        } else if (server.argEquals("action", "clear")) {
+            array->clear();
+        } else {
+            sendJson(400, "{\"error\":\"Invalid parameters\"}");
+            return;
+        }
+    }
+    
+    String json = array->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleGetSimulationArray() {
+    String json = array->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationArrayBenchmark() {
+    int steps = server.argInt("steps", PANEL_ARRAY_BENCH_STEPS);
+    
+    if (steps < 1 || steps > 1440) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // Separate arrays, the configured one is not touched
+    String json = PanelArray::benchmark(pv, steps);
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSimulationExport() {
+    bool ndjson = server.argEquals("format", "ndjson");
+    bool gorilla = server.argEquals("format", "gorilla");
+    int days = server.argInt("days", 1);
+    int startDay = server.argInt("startDay", 1);
+    int stepMinutes = server.argInt("step", 30);
+    
+    if (days < 1 || days > 3660 || startDay < 1 || startDay > 365 || !Simulation::isDayStep(stepMinutes)) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    // Optional measured dataset instead of the sun model
+    IrradianceDataset dataset;
+    bool fromDataset = server.hasArg("file");
+    if (fromDataset && !dataset.open(server.argView("file"))) {
+        sendJson(404, "{\"error\":\"Dataset not found\"}");
+        return;
+    }
+    
+    // Chunked transfer: the size is unknown until the run has finished
+    const char* disposition = gorilla ? "attachment; filename=\"simulation.grla\""
+                            : ndjson ? "attachment; filename=\"simulation.ndjson\"" : "attachment; filename=\"simulation.csv\"";
+    server.sendHeader("Content-Disposition", disposition);
+    server.sendHeader("Connection", "close");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, gorilla ? "application/octet-stream" : ndjson ? "application/x-ndjson" : "text/csv", "");
+    
+    // Rows are formatted into one fixed buffer that is sent whenever it fills up,
+    // so memory use is the same for one day or ten years
+    char buffer[EXPORT_BUFFER_SIZE];
+    size_t fill = 0;
+    if (!ndjson && !gorilla) {
+        fill = snprintf(buffer, sizeof(buffer), "day,time,irradiance,voltage,current,powerGenerated,powerLoad,powerNet,batteryLevel\n");
+    }
+    WiFiClient client = server.client();
+    
+    // Gorilla: day and minute as integers, the seven values as lossless floats, one
+    // block per buffer behind its header
+    GorillaEncoder encoder;
+    uint8_t* block = (uint8_t*)buffer + 4;
+    size_t blockSize = sizeof(buffer) - 4;
+    if (gorilla) {
+        uint8_t header[8];
+        server.sendContent((const char*)header, writeSeriesHeader(header, 2, 7, 23));
+        encoder.begin(block, blockSize, 2, 7);
+    }
+    auto sendBlock = [&]() {
+        writeBlockHeader((uint8_t*)buffer, encoder.getCount(), encoder.getBits());
+        server.sendContent(buffer, 4 + encoder.getBytes());
+    };
+    
+    auto onStep = [&](int dayOfYear, float hourOfDay, const SimulationData& data) {
+        scheduler->runPending();  // Sampling and history keep running during long exports
+        int minuteOfDay = (int)(hourOfDay * 60.0 + 0.5) % 1440;
+        if (gorilla) {
+            uint32_t ints[2] = {(uint32_t)dayOfYear, (uint32_t)minuteOfDay};
+            float floats[7] = {data.irradiance, data.voltage, data.current, data.powerGenerated, data.powerLoad,
+                               data.powerNet, data.batteryLevel};
+            if (encoder.append(ints, floats)) return true;
+            sendBlock();
+            encoder.begin(block, blockSize, 2, 7);
+            encoder.append(ints, floats);
+            return client.connected();
+        }
+        
+        const char* format = ndjson
+            ? "{\"day\":%d,\"time\":\"%02d:%02d\",\"irradiance\":%.3f,\"voltage\":%.2f,\"current\":%.2f,"
+              "\"powerGenerated\":%.2f,\"powerLoad\":%.2f,\"powerNet\":%.2f,\"batteryLevel\":%.2f}\n"
+            : "%d,%02d:%02d,%.3f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n";
+        
+        fill += snprintf(buffer + fill, sizeof(buffer) - fill, format, dayOfYear, minuteOfDay / 60, minuteOfDay % 60,
+                         data.irradiance, data.voltage, data.current, data.powerGenerated, data.powerLoad,
+                         data.powerNet, data.batteryLevel);
+        
+        if (sizeof(buffer) - fill < EXPORT_ROW_MAX) {
+            server.sendContent(buffer, fill);
+            fill = 0;
+            return client.connected();  // Stop computing once the client is gone
+        }
+        return true;
+    };
+    
+    // Run on a copy so the live simulation keeps its panels, cells and results
+    Simulation run = *simulation;
+    if (fromDataset) {
+        run.runDataset(dataset, onStep);
+        dataset.close();
+    } else {
+        run.runDays(startDay, days, stepMinutes, onStep);
+    }
+    
+    if (gorilla && encoder.getCount() > 0) sendBlock();
+    if (fill > 0) server.sendContent(buffer, fill);
+    server.sendContent("");  // Terminating chunk
+}
+
+void WebServerManager::handleTariff() {
+    String json = tariff->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleTariffReload() {
+    if (simulation->isRunning()) {
+        sendJson(409, "{\"success\":false,\"error\":\"Simulation running\"}");
+        return;
+    }
+    
+    const char* file = server.hasArg("file") ? server.argView("file") : "/tariff.csv";
+    bool success = tariff->load(file);
+    
+    String json = "{\"success\":" + String(success ? "true" : "false") + 
+                  ",\"tariff\":" + tariff->getJson() + "}";
+    server.sendHeader("Connection", "close");
+    server.send(success ? 200 : 404, "application/json", json);
+}
+
+void WebServerManager::handleSystemScheduler() {
+    String json = scheduler->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleSystemHeap() {
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    // Streamed from the stack so the report does not disturb the heap it measures
+    char buffer[EXPORT_BUFFER_SIZE];
+    size_t fill = snprintf(buffer, sizeof(buffer),
+        "{\"freeHeap\":%lu,\"minFreeHeap\":%lu,\"largestBlock\":%lu,\"arena\":{\"size\":%u,\"highWater\":%u,\"failures\":%lu},\"routes\":[",
+        (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+        (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+        (unsigned)REQUEST_ARENA_SIZE, (unsigned)arena.getHighWater(), (unsigned long)arena.getFailures());
+    
+    for (int i = 0; i < routeCount; i++) {
+        const RouteStats& route = routes[i];
+        const char* method = route.method == HTTP_GET ? "GET" : route.method == HTTP_POST ? "POST" : "ANY";
+        fill += snprintf(buffer + fill, sizeof(buffer) - fill,
+            "%s{\"path\":\"%s\",\"method\":\"%s\",\"calls\":%lu,\"arenaHighWater\":%lu,\"arenaFailures\":%lu,\"stringReplies\":%lu,\"maxStringReply\":%lu,\"minFreeHeap\":%lu,\"maxFragmentation\":%.3f}",
+            i > 0 ? "," : "", route.path, method, (unsigned long)route.calls, (unsigned long)route.arenaHighWater,
+            (unsigned long)route.arenaFailures, (unsigned long)route.stringReplies, (unsigned long)route.maxStringReply,
+            (unsigned long)(route.calls > 0 ? route.minFreeHeap : 0),
+            route.maxFragmentation);
+        
+        if (sizeof(buffer) - fill < 2 * EXPORT_ROW_MAX) {  // Route rows run longer than export rows
+            server.sendContent(buffer, fill);
+            fill = 0;
+        }
+    }
+    
+    fill += snprintf(buffer + fill, sizeof(buffer) - fill, "]}");
+    server.sendContent(buffer, fill);
+    server.sendContent("");  // Terminating chunk
+}
+
+void WebServerManager::handleFleet() {
+    String json = fleet->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleFleetSeries() {
+    if (!fleet->isActive()) {
+        sendJson(409, "{\"error\":\"Not a fleet hub\"}");
+        return;
+    }
+    
+    int bucketMs = server.argInt("bucket", 1000);
+    int points = server.argInt("points", 60);
+    
+    if (bucketMs < 100 || bucketMs > 3600000 || points < 1 || points > FLEET_MAX_POINTS) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    String json = fleet->getSeriesJson(bucketMs, points);
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleFleetBenchmark() {
+    int units = server.argInt("units", 32);
+    int packets = server.argInt("packets", 60);
+    int bucketMs = server.argInt("bucket", 1000);
+    
+    if (units < 1 || units > 1000 || packets < 1 || packets > 1000 || bucketMs < 100) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    String json = FleetHub::benchmark(units, packets, bucketMs);
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleMqtt() {
+    String json = mqtt->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleMqttBenchmark() {
+    int samples = server.argInt("samples", 1000);
+    
+    if (samples < 1 || samples > 100000) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    String json = mqtt->benchmark(samples);
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleHistory() {
+    int points = server.argInt("points", 500);
+    bool minmax = server.argEquals("mode", "minmax");
+    HistoryField field = HISTORY_GENERATED;
+    if (server.hasArg("field")) {
+        if (server.argEquals("field", "load")) field = HISTORY_LOAD;
+        else if (server.argEquals("field", "soc")) field = HISTORY_SOC;
+        else if (!server.argEquals("field", "generated")) points = 0;  // Rejected below
+    }
+    
+    // Default range: the simulated day (6:00 to 6:00) of the latest point
+    float firstHour = 0.0;
+    float lastHour = 0.0;
+    bool hasData = history->getRange(firstHour, lastHour);
+    float dayStart = hasData ? 6.0 + 24.0 * floor((lastHour - 6.0) / 24.0) : 6.0;
+    float fromHour = server.argFloat("from", dayStart);
+    float toHour = server.argFloat("to", dayStart + 24.0);
+    
+    if (points < 1 || points > HISTORY_MAX_POINTS || toHour <= fromHour) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    server.sendHeader("Connection", "close");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    // [hour, powerGenerated, powerLoad, batteryLevel] per point, streamed as selected
+    char buffer[EXPORT_BUFFER_SIZE];
+    size_t fill = snprintf(buffer, sizeof(buffer), "{\"from\":%.3f,\"to\":%.3f,\"running\":%s,\"mode\":\"%s\",\"points\":[",
+                           fromHour, toHour, simulation->isRunning() ? "true" : "false", minmax ? "minmax" : "lttb");
+    WiFiClient client = server.client();
+    bool firstPoint = true;
+    
+    unsigned long startUs = micros();
+    int sent = history->query(fromHour, toHour, points, minmax ? HISTORY_MINMAX : HISTORY_LTTB, field, [&](const HistoryPoint& point) {
+        fill += snprintf(buffer + fill, sizeof(buffer) - fill, "%s[%.3f,%.1f,%.1f,%.2f]", firstPoint ? "" : ",",
+                         point.hour, point.powerGenerated, point.powerLoad, point.batteryLevel);
+        firstPoint = false;
+        
+        if (sizeof(buffer) - fill < EXPORT_ROW_MAX) {
+            server.sendContent(buffer, fill);
+            fill = 0;
+            return client.connected();
+        }
+        return true;
+    });
+    
+    fill += snprintf(buffer + fill, sizeof(buffer) - fill, "],\"count\":%d,\"queryUs\":%lu}", sent, micros() - startUs);
+    server.sendContent(buffer, fill);
+    server.sendContent("");  // Terminating chunk
+}
+
+void WebServerManager::handleHistoryExport() {
+    float fromHour = server.argFloat("from", 0.0);
+    float toHour = server.argFloat("to", 1.0e9);
+    
+    if (toHour <= fromHour) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    server.sendHeader("Content-Disposition", "attachment; filename=\"history.grla\"");
+    server.sendHeader("Connection", "close");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+    
+    // The stored blocks as they are: simulated time (HISTORY_TIME_UNITS per hour) and
+    // millis() as integers, generated, load and SoC as floats. Blocks are selected
+    // by their hour range, so points just outside it may be included.
+    uint8_t buffer[EXPORT_BUFFER_SIZE];
+    size_t fill = writeSeriesHeader(buffer, 2, 3, HISTORY_MANTISSA_BITS);
+    WiFiClient client = server.client();
+    
+    history->exportBlocks(fromHour, toHour, [&](const HistoryBlock& block, const uint8_t* data) {
+        size_t bytes = (block.bits + 7) / 8;
+        if (fill + 4 + bytes > sizeof(buffer)) {
+            server.sendContent((const char*)buffer, fill);
+            fill = 0;
+            if (!client.connected()) return false;
+        }
+        fill += writeBlockHeader(buffer + fill, block.count, block.bits);
+        memcpy(buffer + fill, data, bytes);
+        fill += bytes;
+        return true;
+    });
+    
+    if (fill > 0) server.sendContent((const char*)buffer, fill);
+    server.sendContent("");  // Terminating chunk
+}
+
+void WebServerManager::handleHistoryBenchmark() {
+    int points = server.argInt("points", HISTORY_BENCH_POINTS);
+    
+    if (points < 1 || points > HISTORY_BENCH_MAX_POINTS) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    String json = history->benchmark(points, [this]() { scheduler->runPending(); });
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleRollup() {
+    // Uptime seconds; default the last hour
+    uint32_t now = RollupStore::now();
+    uint32_t last = server.argInt("last", 3600);
+    uint32_t toSec = server.argInt("to", now + 1);
+    uint32_t fromSec = server.hasArg("from") ? server.argInt("from", 0) : (toSec > last ? toSec - last : 0);
+    int points = server.argInt("points", 500);
+    
+    if (points < 1 || points > ROLLUP_MAX_POINTS || toSec <= fromSec) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    server.sendHeader("Connection", "close");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    // [start, samples, V min/max/mean, mA min/max/mean, W min/max/mean, Wh] per bucket
+    char buffer[EXPORT_BUFFER_SIZE];
+    size_t fill = snprintf(buffer, sizeof(buffer), "{\"now\":%lu,\"from\":%lu,\"to\":%lu,\"buckets\":[",
+                           (unsigned long)now, (unsigned long)fromSec, (unsigned long)toSec);
+    WiFiClient client = server.client();
+    bool firstBucket = true;
+    
+    RollupTier tier = ROLLUP_SECOND;
+    uint32_t width = 0;
+    unsigned long startUs = micros();
+    int sent = rollups->query(fromSec, toSec, points, tier, width, [&](const RollupBucket& bucket) {
+        fill += snprintf(buffer + fill, sizeof(buffer) - fill, "%s[%lu,%lu,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%.4f]",
+                         firstBucket ? "" : ",", (unsigned long)bucket.start, (unsigned long)bucket.samples,
+                         bucket.min[ROLLUP_VOLTAGE], bucket.max[ROLLUP_VOLTAGE], bucket.mean[ROLLUP_VOLTAGE],
+                         bucket.min[ROLLUP_CURRENT], bucket.max[ROLLUP_CURRENT], bucket.mean[ROLLUP_CURRENT],
+                         bucket.min[ROLLUP_POWER], bucket.max[ROLLUP_POWER], bucket.mean[ROLLUP_POWER], bucket.energy);
+        firstBucket = false;
+        
+        if (sizeof(buffer) - fill < EXPORT_ROW_MAX) {
+            server.sendContent(buffer, fill);
+            fill = 0;
+            return client.connected();
+        }
+        return true;
+    });
+    
+    fill += snprintf(buffer + fill, sizeof(buffer) - fill, "],\"tier\":\"%s\",\"bucketSeconds\":%lu,\"count\":%d,\"queryUs\":%lu}",
+                     RollupStore::tierName(tier), (unsigned long)width, sent, micros() - startUs);
+    server.sendContent(buffer, fill);
+    server.sendContent("");  // Terminating chunk
+}
+
+void WebServerManager::handleRollupStatus() {
+    String json = rollups->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleHistoryStatus() {
+    String json = history->getJson();
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleEvents() {
+    // Only events newer than `since` (sequence number of the last event seen)
+    uint32_t since = server.argInt("since", 0);
+    String json = anomaly->getEventsJson(since);
+    
+    server.sendHeader("Connection", "close");
+    server.send(200, "application/json", json);
+}
+
+void WebServerManager::handleEventsBenchmark() {
+    int samples = server.argInt("samples", 100000);
+    
+    if (samples < 1 || samples > ANOMALY_BENCH_MAX_SAMPLES) {
+        sendJson(400, "{\"error\":\"Invalid parameters\"}");
+        return;
+    }
+    
+    String json = AnomalyDetector::benchmark(samples, [this]() { scheduler->runPending(); });
     
     server.sendHeader("Connection", "close");
     server.send(200, "application/json", json);
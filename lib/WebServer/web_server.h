@@ -4,34 +4,121 @@
 #include <Arduino.h>
 #include <WebServer.h>
 #include <LittleFS.h>
+#include "request_server.h"
+#include "request_arena.h"
 #include "transistor.h"
 #include "simulation.h"
 #include "ina.h"
+#include "calibration.h"
+#include "replay_source.h"
+#include "irradiance_dataset.h"
+#include "tariff.h"
+#include "scheduler.h"
+#include "fleet_hub.h"
+#include "mqtt_publisher.h"
+#include "history.h"
+#include "rollup_store.h"
+#include "anomaly_detector.h"
+#include "scenario_queue.h"
+
+// Memory use of one route, recorded around every call of its handler
+struct RouteStats {
+    const char* path;
+    HTTPMethod method;
+    uint32_t calls;
+    uint32_t arenaHighWater;   // Bytes
+    uint32_t arenaFailures;    // Arena allocations that did not fit
+    uint32_t stringReplies;    // Calls that replied with a body built in a String
+    uint32_t maxStringReply;   // Bytes of the largest such body
+    uint32_t minFreeHeap;      // Lowest free heap seen right after the handler
+    float maxFragmentation;    // 1 - largest free block / free heap (internal RAM)
+};
 
 class WebServerManager {
 public:
-    WebServerManager(Transistor* transistorRef, Simulation* simulationRef, INA* inaRef);
+    WebServerManager(Transistor* transistorRef, Simulation* simulationRef, INA* inaRef, Calibration* calibrationRef, ReplaySource* replayRef, Tariff* tariffRef, Scheduler* schedulerRef, FleetHub* fleetRef, MqttPublisher* mqttRef, History* historyRef, AnomalyDetector* anomalyRef, ScenarioQueue* scenariosRef, PvModel* pvRef, PanelArray* arrayRef, RollupStore* rollupsRef);
     void begin();
     void handleClient();
 
 private:
-    WebServer server;
+    RequestServer server;
+    RequestArena arena;
+    RouteStats routes[WEB_MAX_ROUTES];
+    int routeCount;
     Transistor* transistor;
     Simulation* simulation;
     INA* ina;
+    Calibration* calibration;
+    ReplaySource* replay;
+    Tariff* tariff;
+    Scheduler* scheduler;
+    FleetHub* fleet;
+    MqttPublisher* mqtt;
+    History* history;
+    AnomalyDetector* anomaly;
+    ScenarioQueue* scenarios;
+    PvModel* pv;
+    PanelArray* array;
+    RollupStore* rollups;
+    
+    // Registers a handler with heap statistics; the arena is reset after each response
+    void on(const char* path, HTTPMethod method, void (WebServerManager::*handler)());
+    void sendJson(int code, const char* json);  // nullptr (arena full) is sent as 500
     
     void handleRoot();
     void handleSetTransistor();
     void handleGetStatus();
+    void handleSchedule();
+    void handleGetSchedule();
     void handleSimulation();
     void handleSimulationData();
     void handleSetPanel();
     void handleSetCell();
     void handleSetLoad();
     void handleAutoToggleLoads();
+    void handleOptimizer();
+    void handleGetOptimizer();
     void handleCurrentMultiplier();
     void handleSimulationOverview();
+    void handleSimulationHourly();
     void handleRealData();
+    void handleRealStatus();
+    void handleCalibration();
+    void handleCalibrationSample();
+    void handleCalibrationFit();
+    void handleCalibrationReset();
+    void handleReplay();
+    void handleReplayStatus();
+    void handleDatasetImport();
+    void handleDatasetInfo();
+    void handleSimulationDataset();
+    void handleSimulationAnnual();
+    void handleSimulationExport();
+    void handleSimulationBenchmark();
+    void handleSimulationPv();
+    void handleSimulationArray();
+    void handleGetSimulationArray();
+    void handleSimulationArrayBenchmark();
+    void handleTariff();
+    void handleTariffReload();
+    void handleSystemScheduler();
+    void handleSystemHeap();
+    void handleFleet();
+    void handleFleetSeries();
+    void handleFleetBenchmark();
+    void handleMqtt();
+    void handleMqttBenchmark();
+    void handleHistory();
+    void handleHistoryStatus();
+    void handleHistoryExport();
+    void handleHistoryBenchmark();
+    void handleRollup();
+    void handleRollupStatus();
+    void handleEvents();
+    void handleEventsBenchmark();
+    void handleJobSubmit();
+    void handleJobs();
+    void handleJobCancel();
     void handleNotFound();
 };
 
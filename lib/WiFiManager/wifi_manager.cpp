@@ -1,25 +1,83 @@
 #include "wifi_manager.h"
 
-WiFiManager::WiFiManager(const char* ssid, const char* password, IPAddress ip) 
-    : apSSID(ssid), apPassword(password), apIP(ip) {
+WiFiManager::WiFiManager(const char* ssid, const char* password, IPAddress ip, uint8_t maxStations) 
+    : apSSID(ssid), apPassword(password), apIP(ip), apMaxStations(constrain(maxStations, 1, 10)), readySemaphore(nullptr), station(false) {
 }
 
 void WiFiManager::begin() {
     Serial.println("Starting WiFi Access Point...");
-    
-    WiFi.mode(WIFI_AP);
-    WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
-    WiFi.softAP(apSSID, apPassword);
-    
-    delay(100);
+    startAccessPoint();
     
     IPAddress IP = WiFi.softAPIP();
     Serial.print("Access Point started: ");
     Serial.println(apSSID);
     Serial.print("IP Address: ");
     Serial.println(IP);
+    Serial.print("Max stations: ");
+    Serial.println(apMaxStations);
+}
+
+void WiFiManager::beginAsync() {
+    Serial.println("Starting WiFi Access Point (background)...");
+    readySemaphore = xSemaphoreCreateBinary();
+    
+    // The WiFi driver runs on core 0, peripheral init continues on core 1
+    if (xTaskCreatePinnedToCore(startTask, "wifi_start", 4096, this, 1, nullptr, 0) != pdPASS) {
+        vSemaphoreDelete(readySemaphore);
+        readySemaphore = nullptr;
+        begin();
+    }
+}
+
+bool WiFiManager::waitReady(uint32_t timeoutMs) {
+    if (readySemaphore == nullptr) return true;  // Started synchronously
+    
+    if (xSemaphoreTake(readySemaphore, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        Serial.println("WiFi Access Point start timed out");
+        return false;
+    }
+    vSemaphoreDelete(readySemaphore);
+    readySemaphore = nullptr;
+    
+    Serial.print("Access Point started: ");
+    Serial.println(apSSID);
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.softAPIP());
+    Serial.print("Max stations: ");
+    Serial.println(apMaxStations);
+    return true;
+}
+
+void WiFiManager::startAccessPoint() {
+    // softAP() returns once the interface is up, no settle delay needed
+    WiFi.mode(WIFI_AP);
+    WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
+    WiFi.softAP(apSSID, apPassword, 1, 0, apMaxStations);
+}
+
+void WiFiManager::startTask(void* param) {
+    WiFiManager* manager = (WiFiManager*)param;
+    manager->startAccessPoint();
+    xSemaphoreGive(manager->readySemaphore);
+    vTaskDelete(nullptr);
+}
+
+void WiFiManager::beginStation(const char* ssid, const char* password) {
+    // Fleet members: no own AP (its subnet would clash with the hub's), the web
+    // interface is reachable on the hub network. Association continues in the background.
+    Serial.print("Joining WiFi network: ");
+    Serial.println(ssid);
+    
+    station = true;
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(ssid, password);
+}
+
+bool WiFiManager::isStation() {
+    return station;
 }
 
 IPAddress WiFiManager::getIP() {
-    return WiFi.softAPIP();
+    return station ? WiFi.localIP() : WiFi.softAPIP();
 }
@@ -3,17 +3,28 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <freertos/semphr.h>
 
 class WiFiManager {
 public:
-    WiFiManager(const char* ssid, const char* password, IPAddress ip = IPAddress(192, 168, 4, 1));
+    WiFiManager(const char* ssid, const char* password, IPAddress ip = IPAddress(192, 168, 4, 1), uint8_t maxStations = 4);
     void begin();
+    void beginAsync();                    // Start the AP from a task on core 0
+    bool waitReady(uint32_t timeoutMs);   // Block until the async start finished
+    void beginStation(const char* ssid, const char* password);  // Join a hub's AP instead
+    bool isStation();
     IPAddress getIP();
 
 private:
     const char* apSSID;
     const char* apPassword;
     IPAddress apIP;
+    uint8_t apMaxStations;                // Soft-AP client limit (ESP-IDF allows 1-10)
+    SemaphoreHandle_t readySemaphore;
+    bool station;
+
+    void startAccessPoint();
+    static void startTask(void* param);
 };
 
 #endif // WIFI_MANAGER_H
@@ -7,109 +7,196 @@
 #include "wifi_manager.h"
 #include "web_server.h"
 #include "simulation.h"
+#include "pv_model.h"
+#include "panel_array.h"
+#include "calibration.h"
+#include "replay_source.h"
+#include "tariff.h"
+#include "scheduler.h"
+#include "device_map.h"
+#include "boot_profiler.h"
+#include "fleet_hub.h"
+#include "fleet_reporter.h"
+#include "mqtt_publisher.h"
+#include "history.h"
+#include "rollup_store.h"
+#include "anomaly_detector.h"
+#include "load_optimizer.h"
+#include "checkpoint.h"
+#include "scenario_queue.h"
 
 INA ina;
 OLED oled;
 Transistor transistor;
-Simulation simulation(&ina);
-WiFiManager wifiManager("Solar_Monitor", "12345678", DEFAULT_AP_IP);
-WebServerManager webServer(&transistor, &simulation, &ina);
+Calibration calibration;
+ReplaySource replay;
+Tariff tariff;
+PvModel pvModel;
+PanelArray panelArray(&pvModel);
+Scheduler scheduler;
+LoadOptimizer loadOptimizer;
+DeviceMap deviceMap;
+BootProfiler bootProfiler;
+FleetHub fleetHub;
+Simulation simulation(&ina, &calibration, &tariff, &pvModel);
+#if FLEET_ROLE == FLEET_HUB
+WiFiManager wifiManager(FLEET_HUB_SSID, FLEET_HUB_PASSWORD, DEFAULT_AP_IP, FLEET_HUB_MAX_STATIONS);
+#else
+WiFiManager wifiManager("Solar_Monitor", "12345678", DEFAULT_AP_IP, WIFI_AP_MAX_STATIONS);
+#endif
+FleetReporter fleetReporter(&simulation);
+MqttPublisher mqtt(&simulation);
+History history(&simulation);
+RollupStore rollups;
+AnomalyDetector anomaly(&transistor);
+Checkpoint checkpoint(&simulation);
+ScenarioQueue scenarios(&tariff, &pvModel);
+WebServerManager webServer(&transistor, &simulation, &ina, &calibration, &replay, &tariff, &scheduler, &fleetHub, &mqtt, &history, &anomaly, &scenarios, &pvModel, &panelArray, &rollups);
 
-void scanI2C() {
-  Serial.println("Starting I2C scan...");
-  int deviceCount = 0;
-  
-  for (byte address = 1; address < 127; address++) {
-    Wire.beginTransmission(address);
-    byte error = Wire.endTransmission();
-    
-    if (error == 0) {
-      Serial.print("I2C device found at address: 0x");
-      if (address < 16) Serial.print("0");
-      Serial.println(address, HEX);
-      
-      if (address == OLED_ADDR) {
-        Serial.println("  -> OLED detected");
-      }
-      if (address == INA219_ADDR) {
-        Serial.println("  -> INA219 detected");
-      }
-      deviceCount++;
-    }
+// Latest sensor reading, refreshed by the sensor job
+float sensorVoltage = 0.0;
+float sensorCurrent = 0.0;
+
+void sampleSensor() {
+  // The only periodic bus access: one burst, everyone else reads the cache
+  if (ina.sample()) {
+    InaSample sample = ina.getSample();
+    sensorVoltage = sample.voltage;
+    sensorCurrent = sample.current;
+    mqtt.addInaReading(sensorVoltage, sensorCurrent);
+    anomaly.addSample(sample);  // O(1) per sample, a few µs
+    rollups.addSample(sample);  // O(1), closes and merges finished buckets
+  }
+  if (simulation.isRunning()) {
+    anomaly.addSimulation(simulation.getCurrentData());
   }
+}
+
+void refreshDisplay() {
+  if (!oled.isFound()) return;
   
-  Serial.print("Total devices found: ");
-  Serial.println(deviceCount);
+  oled.showStatus(
+    transistor.getState1(), 
+    transistor.getState2(), 
+    transistor.getState3(), 
+    transistor.getState4(),
+    sensorVoltage,
+    sensorCurrent,
+    ina.isFound(),
+    wifiManager.getIP().toString()
+  );
 }
 
 void setup() {
   Serial.begin(115200);
+#if !FAST_BOOT
   delay(500);
+#endif
+  bootProfiler.begin();
   Serial.println("\n\n=== Solar Monitor System ===");
   
+  // Start WiFi Access Point in the background while peripherals come up
+  // (fleet members join the hub's network instead)
+#if FLEET_ROLE == FLEET_MEMBER
+  wifiManager.beginStation(FLEET_HUB_SSID, FLEET_HUB_PASSWORD);
+#else
+  wifiManager.beginAsync();
+#endif
+  bootProfiler.mark("wifi task");
+  
   // Initialize transistors
   transistor.begin();
   
   // Initialize I2C
   Wire.begin(OLED_SDA, OLED_SCL);
+  bootProfiler.mark("gpio/i2c");
   
-  // Scan I2C bus
-  scanI2C();
+  // Scan I2C bus (fast boot only verifies the cached device map)
+  deviceMap.scan(FAST_BOOT);
+  bootProfiler.mark("i2c scan");
   
   // Initialize OLED
-  if (oled.begin()) {
+  if (deviceMap.isPresent(OLED_ADDR) && oled.begin()) {
     oled.showBootScreen();
   } else {
     Serial.println("OLED initialization failed");
   }
+  bootProfiler.mark("oled");
   
   // Initialize INA219
-  if (!ina.begin()) {
+  if (!deviceMap.isPresent(INA219_ADDR) || !ina.begin()) {
     Serial.println("INA219 initialization failed");
   }
   
-  delay(1000);
+  // Load fitted current calibration from NVS
+  calibration.begin();
+  bootProfiler.mark("ina/calibration");
   
-  // Start WiFi Access Point
-  wifiManager.begin();
+#if !FAST_BOOT
+  delay(1000);
+#endif
   
-  // Initialize simulation
+  // Initialize simulation (PV table first), its load planner and chart history
+  pvModel.begin();
   simulation.begin();
+  if (loadOptimizer.begin()) simulation.setLoadOptimizer(&loadOptimizer);
+  simulation.setPanelArray(&panelArray);
+  history.begin();
+  rollups.begin();
+  
+  // Compile time-of-use tariff from LittleFS (flat rates if missing); a restored run re-plans its loads against it
+  tariff.begin();
+  bootProfiler.mark("tariff");
+  
+  // Continue a run interrupted by a reset or brownout
+  checkpoint.begin();
+  bootProfiler.mark("checkpoint");
+  
+  // Web server needs the AP interface
+  wifiManager.waitReady(WIFI_READY_TIMEOUT);
+  bootProfiler.mark("wifi ready");
   
   // Start web server
   webServer.begin();
+  bootProfiler.mark("web server");
+  
+  // Background worker for queued batch scenarios (needs the tariff)
+  scenarios.begin();
+  
+  // Fleet telemetry: members send, the hub collects
+#if FLEET_ROLE == FLEET_MEMBER
+  fleetReporter.begin(FLEET_HUB_IP);
+#elif FLEET_ROLE == FLEET_HUB
+  fleetHub.begin();
+#endif
   
+#if MQTT_ENABLED
+  // Connects and publishes from its own task; the job below only queues
+  mqtt.begin(MQTT_BROKER, MQTT_PORT);
+#endif
+  
+  // Main loop jobs, in priority order (period ms, budget us)
+  scheduler.addJob("web", JOB_WEB_PERIOD, JOB_WEB_BUDGET, []() { webServer.handleClient(); });
+  scheduler.addJob("sensor", JOB_SENSOR_PERIOD, JOB_SENSOR_BUDGET, sampleSensor);
+  scheduler.addJob("simulation", JOB_SIMULATION_PERIOD, JOB_SIMULATION_BUDGET, []() { simulation.update(); });
+  scheduler.addJob("history", HISTORY_SAMPLE_PERIOD, JOB_HISTORY_BUDGET, []() { history.sample(); });
+  scheduler.addJob("checkpoint", JOB_CHECKPOINT_PERIOD, JOB_CHECKPOINT_BUDGET, []() { checkpoint.update(); });
+#if FLEET_ROLE == FLEET_MEMBER
+  scheduler.addJob("fleet", FLEET_SAMPLE_PERIOD, JOB_FLEET_BUDGET, []() { fleetReporter.update(); });
+#elif FLEET_ROLE == FLEET_HUB
+  scheduler.addJob("fleet", JOB_FLEET_PERIOD, JOB_FLEET_BUDGET, []() { fleetHub.poll(); });
+#endif
+#if MQTT_ENABLED
+  scheduler.addJob("mqtt", MQTT_SAMPLE_PERIOD, JOB_MQTT_BUDGET, []() { mqtt.sample(); });
+#endif
+  scheduler.addJob("display", JOB_DISPLAY_PERIOD, JOB_DISPLAY_BUDGET, refreshDisplay);
+  scheduler.addJob("housekeeping", JOB_HOUSEKEEPING_PERIOD, JOB_HOUSEKEEPING_BUDGET, []() { scheduler.printReport(); });
+  
+  bootProfiler.print();
   Serial.println("System ready!");
 }
 
 void loop() {
-  // Handle web server requests
-  webServer.handleClient();
-  
-  // Update simulation
-  simulation.update();
-  
-  // Update OLED display
-  if (oled.isFound()) {
-    float voltage = 0.0;
-    float current = 0.0;
-    
-    if (ina.isFound()) {
-      voltage = ina.getBusVoltage();
-      current = ina.getCurrent();
-    }
-    
-    oled.showStatus(
-      transistor.getState1(), 
-      transistor.getState2(), 
-      transistor.getState3(), 
-      transistor.getState4(),
-      voltage,
-      current,
-      ina.isFound(),
-      wifiManager.getIP().toString()
-    );
-  }
-  
-  delay(100);
+  // Runs every due job, then sleeps until the next deadline
+  scheduler.run();
 }
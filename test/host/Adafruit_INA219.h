@@ -0,0 +1,17 @@
+#ifndef HOST_ADAFRUIT_INA219_H
+#define HOST_ADAFRUIT_INA219_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class Adafruit_INA219 {
+public:
+    Adafruit_INA219(uint8_t = 0x40) {}
+    bool begin(TwoWire* = &Wire) { return false; }
+    float getBusVoltage_V() { return 0.0f; }
+    float getShuntVoltage_mV() { return 0.0f; }
+    float getCurrent_mA() { return 0.0f; }
+    float getPower_mW() { return 0.0f; }
+};
+
+#endif // HOST_ADAFRUIT_INA219_H
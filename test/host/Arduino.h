@@ -0,0 +1,217 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino-ESP32 core for the native test environment: enough of the
+// API for the libraries under test to compile and run on the host
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+using std::min;
+using std::max;
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define HEX 16
+#define DEC 10
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+class String {
+public:
+    String(const char* text = "") : value(text != nullptr ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    String(char c) : value(1, c) {}
+    String(int number, unsigned char base = DEC) : value(integer((long long)number, base)) {}
+    String(unsigned int number, unsigned char base = DEC) : value(integer((unsigned long long)number, base)) {}
+    String(long number, unsigned char base = DEC) : value(integer((long long)number, base)) {}
+    String(unsigned long number, unsigned char base = DEC) : value(integer((unsigned long long)number, base)) {}
+    String(long long number, unsigned char base = DEC) : value(integer(number, base)) {}
+    String(unsigned long long number, unsigned char base = DEC) : value(integer(number, base)) {}
+    String(float number, unsigned int decimals = 2) : value(fixed(number, decimals)) {}
+    String(double number, unsigned int decimals = 2) : value(fixed(number, decimals)) {}
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* other) { value += other; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == other; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    bool operator!=(const char* other) const { return value != other; }
+    char operator[](unsigned int index) const { return index < value.size() ? value[index] : '\0'; }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    void reserve(unsigned int size) { value.reserve(size); }
+    long toInt() const { return atol(value.c_str()); }
+    float toFloat() const { return atof(value.c_str()); }
+    bool startsWith(const char* prefix) const { return value.compare(0, strlen(prefix), prefix) == 0; }
+    bool endsWith(const char* suffix) const {
+        size_t n = strlen(suffix);
+        return value.size() >= n && value.compare(value.size() - n, n, suffix) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t at = value.find(c, from);
+        return at == std::string::npos ? -1 : (int)at;
+    }
+    int indexOf(const char* text, unsigned int from = 0) const {
+        size_t at = value.find(text, from);
+        return at == std::string::npos ? -1 : (int)at;
+    }
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < to && from < value.size() ? String(value.substr(from, to - from)) : String();
+    }
+    void trim() {
+        size_t first = value.find_first_not_of(" \t\r\n");
+        size_t last = value.find_last_not_of(" \t\r\n");
+        value = first == std::string::npos ? "" : value.substr(first, last - first + 1);
+    }
+
+private:
+    std::string value;
+
+    static std::string integer(long long number, unsigned char base) {
+        if (base == DEC) return std::to_string(number);
+        return integer((unsigned long long)number, base);
+    }
+    static std::string integer(unsigned long long number, unsigned char base) {
+        char buffer[72];
+        snprintf(buffer, sizeof(buffer), base == HEX ? "%llx" : "%llu", number);
+        return buffer;
+    }
+    static std::string fixed(double number, unsigned int decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+        return buffer;
+    }
+};
+
+inline String operator+(const String& a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const char* a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, const char* b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, char b) { String result(a); result += b; return result; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    virtual size_t write(const uint8_t* data, size_t length) { return fwrite(data, 1, length, stdout); }
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write(text.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int number, int base = DEC) { return write(String(number, (unsigned char)base).c_str()); }
+    size_t print(unsigned int number, int base = DEC) { return write(String(number, (unsigned char)base).c_str()); }
+    size_t print(long number, int base = DEC) { return write(String(number, (unsigned char)base).c_str()); }
+    size_t print(unsigned long number, int base = DEC) { return write(String(number, (unsigned char)base).c_str()); }
+    size_t print(double number, int decimals = 2) { return write(String(number, (unsigned int)decimals).c_str()); }
+    size_t println() { return write("\n"); }
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+    template <typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+    size_t printf(const char* format, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return length > 0 ? write(buffer) : 0;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        size_t n = 0;
+        for (int c; n < length && (c = read()) >= 0; n++) buffer[n] = (uint8_t)c;
+        return n;
+    }
+    size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+        size_t n = 0;
+        for (int c; n < length && (c = read()) >= 0 && c != terminator; n++) buffer[n] = (char)c;
+        return n;
+    }
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+};
+inline HardwareSerial Serial;
+
+inline std::chrono::steady_clock::time_point hostStartTime = std::chrono::steady_clock::now();
+inline unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - hostStartTime).count();
+}
+inline unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStartTime).count();
+}
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline void yield() {}
+
+inline long random(long high) { return high > 0 ? rand() % high : 0; }
+inline long random(long low, long high) { return high > low ? low + rand() % (high - low) : low; }
+inline void randomSeed(unsigned long seed) { srand(seed); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline bool psramFound() { return false; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return 320 * 1024; }
+    uint32_t getMinFreeHeap() { return 320 * 1024; }
+    uint32_t getMaxAllocHeap() { return 128 * 1024; }
+    uint32_t getPsramSize() { return 0; }
+    uint32_t getFreePsram() { return 0; }
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getCycleCount() { return (uint32_t)micros() * 240; }
+    void restart() { exit(0); }
+};
+inline EspClass ESP;
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint32_t value) : address(value) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    operator uint32_t() const { return address; }
+    String toString() const {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF, address >> 24);
+        return buffer;
+    }
+
+private:
+    uint32_t address;
+};
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,42 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+
+// Empty filesystem: every open fails, so file-backed features use their defaults
+namespace fs {
+
+class File : public Stream {
+public:
+    operator bool() const { return false; }
+    void close() {}
+    void flush() {}
+    size_t size() const { return 0; }
+    size_t position() const { return 0; }
+    bool seek(uint32_t) { return false; }
+    const char* name() const { return ""; }
+    bool isDirectory() const { return false; }
+    File openNextFile() { return File(); }
+    using Print::write;
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+    using Stream::read;
+    int read() override { return -1; }
+    size_t read(uint8_t*, size_t) { return 0; }
+};
+
+class FS {
+public:
+    File open(const char*, const char* = "r", bool = false) { return File(); }
+    bool exists(const char*) { return false; }
+    bool remove(const char*) { return false; }
+    bool rename(const char*, const char*) { return false; }
+    bool mkdir(const char*) { return false; }
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // HOST_FS_H
@@ -0,0 +1,15 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+public:
+    bool begin(bool = false) { return true; }
+    void end() {}
+    size_t totalBytes() { return 0; }
+    size_t usedBytes() { return 0; }
+};
+inline LittleFSFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
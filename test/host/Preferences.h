@@ -0,0 +1,61 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS stand-in: one in-memory store per process, keyed by namespace and key
+inline std::map<std::string, std::vector<uint8_t>> hostNvs;
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) { space = name; this->readOnly = readOnly; return true; }
+    void end() {}
+    bool clear() {
+        for (auto it = hostNvs.begin(); it != hostNvs.end();) {
+            it = it->first.compare(0, space.size() + 1, space + "/") == 0 ? hostNvs.erase(it) : std::next(it);
+        }
+        return true;
+    }
+    bool remove(const char* key) { return hostNvs.erase(path(key)) > 0; }
+    bool isKey(const char* key) { return hostNvs.count(path(key)) > 0; }
+
+    size_t putBytes(const char* key, const void* data, size_t length) {
+        if (readOnly) return 0;
+        hostNvs[path(key)].assign((const uint8_t*)data, (const uint8_t*)data + length);
+        return length;
+    }
+    size_t getBytesLength(const char* key) {
+        auto it = hostNvs.find(path(key));
+        return it == hostNvs.end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char* key, void* data, size_t length) {
+        auto it = hostNvs.find(path(key));
+        if (it == hostNvs.end() || it->second.size() > length) return 0;
+        memcpy(data, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char* key, uint32_t fallback = 0) { return get(key, fallback); }
+    size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    int32_t getInt(const char* key, int32_t fallback = 0) { return get(key, fallback); }
+    size_t putBool(const char* key, bool value) { return putBytes(key, &value, sizeof(value)); }
+    bool getBool(const char* key, bool fallback = false) { return get(key, fallback); }
+    size_t putFloat(const char* key, float value) { return putBytes(key, &value, sizeof(value)); }
+    float getFloat(const char* key, float fallback = 0.0f) { return get(key, fallback); }
+
+private:
+    std::string space;
+    bool readOnly = false;
+
+    std::string path(const char* key) { return space + "/" + key; }
+    template <typename T> T get(const char* key, T fallback) {
+        T value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : fallback;
+    }
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,56 @@
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string>
+#include <vector>
+
+// Broker stand-in: every PubSubClient talks to this one in-process broker.
+// Tests take it offline or make it refuse publishes to exercise retries.
+struct HostBroker {
+    bool online = true;
+    bool acceptPublish = true;
+    uint32_t connects = 0;
+    std::vector<std::string> topics;
+    std::vector<std::string> payloads;
+
+    void reset() { *this = HostBroker(); }
+};
+inline HostBroker hostBroker;
+
+class PubSubClient {
+public:
+    PubSubClient() : isConnected(false), bufferSize(256) {}
+    PubSubClient(Client&) : isConnected(false), bufferSize(256) {}
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setClient(Client&) { return *this; }
+    PubSubClient& setKeepAlive(uint16_t) { return *this; }
+    PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+    bool setBufferSize(uint16_t size) { bufferSize = size; return true; }
+
+    bool connect(const char*) {
+        isConnected = hostBroker.online;
+        if (isConnected) hostBroker.connects++;
+        return isConnected;
+    }
+    bool connected() { return isConnected && hostBroker.online; }
+    void disconnect() { isConnected = false; }
+    bool loop() { return connected(); }
+    int state() { return connected() ? 0 : -1; }
+
+    // Like the real client: fails when offline or when the packet exceeds the buffer
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+        if (!connected() || !hostBroker.acceptPublish || length + strlen(topic) + 7 > bufferSize) return false;
+        hostBroker.topics.push_back(topic);
+        hostBroker.payloads.push_back(std::string((const char*)payload, length));
+        return true;
+    }
+    bool publish(const char* topic, const char* payload) { return publish(topic, (const uint8_t*)payload, strlen(payload)); }
+
+private:
+    bool isConnected;
+    uint16_t bufferSize;
+};
+
+#endif // HOST_PUBSUBCLIENT_H
@@ -0,0 +1,130 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+#define WIFI_AP 2
+#define WIFI_AP_STA 3
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+// UDP over real host sockets (POSIX), so hub and members can talk over loopback
+class WiFiUDP {
+public:
+    WiFiUDP() : socketFd(-1), received(0), offset(0), sendLength(0) {}
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin(uint16_t port) {
+        if (!open()) return 0;
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        int reuse = 1;
+        setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        int bufferBytes = 4 * 1024 * 1024;
+        setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+        if (bind(socketFd, (sockaddr*)&local, sizeof(local)) != 0) {
+            stop();
+            return 0;
+        }
+        return 1;
+    }
+    void stop() {
+        if (socketFd >= 0) close(socketFd);
+        socketFd = -1;
+    }
+
+    int parsePacket() {
+        if (socketFd < 0) return 0;
+        socklen_t length = sizeof(remote);
+        ssize_t n = recvfrom(socketFd, packet, sizeof(packet), 0, (sockaddr*)&remote, &length);
+        received = n > 0 ? (size_t)n : 0;
+        offset = 0;
+        return (int)received;
+    }
+    int read(uint8_t* buffer, size_t length) {
+        size_t n = min(length, received - offset);
+        memcpy(buffer, packet + offset, n);
+        offset += n;
+        return (int)n;
+    }
+    IPAddress remoteIP() { return IPAddress((uint32_t)remote.sin_addr.s_addr); }
+
+    int beginPacket(IPAddress address, uint16_t port) {
+        if (!open()) return 0;
+        target = {};
+        target.sin_family = AF_INET;
+        target.sin_addr.s_addr = (uint32_t)address;
+        target.sin_port = htons(port);
+        sendLength = 0;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        size_t n = min(length, sizeof(sendBuffer) - sendLength);
+        memcpy(sendBuffer + sendLength, data, n);
+        sendLength += n;
+        return n;
+    }
+    int endPacket() {
+        return sendto(socketFd, sendBuffer, sendLength, 0, (sockaddr*)&target, sizeof(target)) == (ssize_t)sendLength;
+    }
+
+private:
+    int socketFd;
+    uint8_t packet[1500];
+    size_t received;
+    size_t offset;
+    sockaddr_in remote = {};
+    uint8_t sendBuffer[1500];
+    size_t sendLength;
+    sockaddr_in target = {};
+
+    bool open() {
+        if (socketFd >= 0) return true;
+        socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socketFd >= 0) fcntl(socketFd, F_SETFL, O_NONBLOCK);
+        return socketFd >= 0;
+    }
+};
+
+class Client : public Stream {
+public:
+    virtual int connect(const char*, uint16_t) { return 0; }
+    virtual bool connected() { return false; }
+    virtual void stop() {}
+};
+
+class WiFiClient : public Client {
+public:
+    void setTimeout(uint32_t) {}
+};
+
+// Station and access point calls succeed without a radio; status() is settable
+class WiFiClass {
+public:
+    int connectionStatus = WL_CONNECTED;
+
+    bool mode(int) { return true; }
+    bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+    bool softAP(const char*, const char* = nullptr, int = 1, int = 0, int = 4) { return true; }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    int begin(const char*, const char* = nullptr) { return connectionStatus; }
+    int status() { return connectionStatus; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    String macAddress() { return "A1:B2:C3:D4:E5:F6"; }
+    bool setSleep(bool) { return true; }
+    bool setAutoReconnect(bool) { return true; }
+    bool disconnect(bool = false) { return true; }
+};
+inline WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
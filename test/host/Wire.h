@@ -0,0 +1,20 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+// Empty I2C bus: nothing acknowledges
+class TwoWire : public Stream {
+public:
+    bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 2; }
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+    using Print::write;
+    size_t write(uint8_t) override { return 1; }
+    int read() override { return -1; }
+};
+inline TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,29 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include <Arduino.h>
+
+typedef struct esp_timer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+// Timers are never created on the host
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t*, esp_timer_handle_t* handle) { *handle = nullptr; return ESP_FAIL; }
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) { return ESP_FAIL; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_OK; }
+// Tests that replay long periods set hostTimerUs; negative means the real clock
+inline int64_t hostTimerUs = -1;
+inline int64_t esp_timer_get_time() { return hostTimerUs >= 0 ? hostTimerUs : (int64_t)micros(); }
+
+#endif // HOST_ESP_TIMER_H
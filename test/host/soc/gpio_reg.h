@@ -0,0 +1,8 @@
+#ifndef HOST_GPIO_REG_H
+#define HOST_GPIO_REG_H
+
+#define GPIO_OUT_REG 1
+#define GPIO_OUT_W1TS_REG 2
+#define GPIO_OUT_W1TC_REG 3
+
+#endif // HOST_GPIO_REG_H
@@ -0,0 +1,11 @@
+#ifndef HOST_SOC_H
+#define HOST_SOC_H
+
+#include <stdint.h>
+
+// GPIO registers become plain host variables indexed by register number
+inline uint32_t hostRegisters[4];
+#define REG_READ(reg) (hostRegisters[(reg)])
+#define REG_WRITE(reg, value) (hostRegisters[(reg)] = (value))
+
+#endif // HOST_SOC_H
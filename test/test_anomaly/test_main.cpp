@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "anomaly_detector.h"
+
+// Deterministic ±1% noise
+static float noise(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return ((int32_t)state * (1.0f / 2147483648.0f)) * 0.01f;
+}
+
+static int countEvents(AnomalyDetector& detector, const char* type) {
+    String json = detector.getEventsJson(0);
+    String needle = String("\"type\":\"") + type + "\"";
+    int count = 0;
+    for (int at = json.indexOf(needle.c_str()); at >= 0; at = json.indexOf(needle.c_str(), at + 1)) count++;
+    return count;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_flat_noise_raises_nothing() {
+    ChangeDetector detector;
+    detector.reset();
+    uint32_t state = 1;
+    for (int i = 0; i < 100000; i++) {
+        TEST_ASSERT_EQUAL(0, detector.update(80.0f * (1.0f + noise(state))));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 80.0, detector.mean);
+}
+
+void test_step_detected_once() {
+    ChangeDetector detector;
+    detector.reset();
+    uint32_t state = 2;
+    for (int i = 0; i < 500; i++) detector.update(80.0f * (1.0f + noise(state)));
+
+    // A 30% drop is reported within a few samples and only once
+    int firstAlarm = -1;
+    int alarms = 0;
+    for (int i = 0; i < 500; i++) {
+        int change = detector.update(56.0f * (1.0f + noise(state)));
+        if (change != 0) {
+            TEST_ASSERT_EQUAL(-1, change);
+            if (firstAlarm < 0) firstAlarm = i;
+            alarms++;
+        }
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(0, firstAlarm);
+    TEST_ASSERT_LESS_THAN(10, firstAlarm);
+    TEST_ASSERT_EQUAL(1, alarms);
+}
+
+void test_panel_mismatch_after_switching() {
+    AnomalyDetector detector(nullptr);
+    uint32_t state = 3;
+    uint32_t timeMs = 0;
+    for (int i = 0; i < 200; i++, timeMs += 100) detector.process(0x0F, 4.9f, 320.0f * (1.0f + noise(state)), timeMs);
+
+    // Three panels expected (240 mA), only two deliver
+    for (int i = 0; i < 50; i++, timeMs += 100) detector.process(0x07, 4.9f, 160.0f * (1.0f + noise(state)), timeMs);
+    TEST_ASSERT_EQUAL(1, countEvents(detector, "panel_mismatch"));
+
+    // Switching to a count the measurement matches raises nothing new
+    for (int i = 0; i < 50; i++, timeMs += 100) detector.process(0x03, 4.9f, 107.0f * (1.0f + noise(state)), timeMs);
+    TEST_ASSERT_EQUAL(1, countEvents(detector, "panel_mismatch"));
+    TEST_ASSERT_EQUAL(0, countEvents(detector, "step_down"));
+}
+
+void test_no_current_and_idle_current() {
+    AnomalyDetector detector(nullptr);
+    uint32_t timeMs = 0;
+    for (int i = 0; i < 100; i++, timeMs += 100) detector.process(0x01, 4.9f, 80.0f, timeMs);
+
+    // Open connector: panels on, nothing flows (latched, reported once)
+    for (int i = 0; i < 20; i++, timeMs += 100) detector.process(0x01, 4.9f, 0.0f, timeMs);
+    TEST_ASSERT_EQUAL(1, countEvents(detector, "no_current"));
+
+    // Leakage: all panels off, current still flowing
+    for (int i = 0; i < 20; i++, timeMs += 100) detector.process(0x00, 4.9f, 30.0f, timeMs);
+    TEST_ASSERT_EQUAL(1, countEvents(detector, "idle_current"));
+}
+
+void test_detector_benchmark() {
+    String json = AnomalyDetector::benchmark(ANOMALY_BENCH_MAX_SAMPLES);
+    TEST_MESSAGE(("detector " + json).c_str());
+    TEST_ASSERT_NOT_NULL(strstr(json.c_str(), "\"samples\":1000000"));
+    TEST_ASSERT_NOT_NULL(strstr(json.c_str(), "\"events\":3"));  // Cloud drop, recovery, dead panel
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_flat_noise_raises_nothing);
+    RUN_TEST(test_step_detected_once);
+    RUN_TEST(test_panel_mismatch_after_switching);
+    RUN_TEST(test_no_current_and_idle_current);
+    RUN_TEST(test_detector_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "calibration.h"
+
+void setUp() {
+    hostNvs.clear();
+}
+void tearDown() {}
+
+// Raw reads 1/600 of the reference, with a 3000 mA step at 200 mA raw
+static float steppedReference(float rawMA) {
+    return rawMA < 200.0 ? 600.0 * rawMA : 600.0 * rawMA + 3000.0;
+}
+
+void test_unfitted_passes_through() {
+    Calibration calibration;
+    calibration.reset();
+    TEST_ASSERT_FALSE(calibration.isFitted());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 123.0, calibration.apply(123.0));
+}
+
+void test_linear_response_is_recovered() {
+    Calibration calibration;
+    calibration.reset();
+    for (int i = 0; i < 40; i++) calibration.addSample(i * 10 + 1, 2.5 * (i * 10 + 1) + 40.0);
+    TEST_ASSERT_TRUE(calibration.fit());
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 2.5 * 50 + 40.0, calibration.apply(50.0));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 2.5 * 350 + 40.0, calibration.apply(350.0));
+}
+
+// The model must not jump where segments meet, even when the response does
+void test_stepped_response_is_continuous() {
+    Calibration calibration;
+    calibration.reset();
+    for (int i = 0; i < 40; i++) {
+        float x = i * 10 + 1;
+        calibration.addSample(x, steppedReference(x));
+    }
+    TEST_ASSERT_TRUE(calibration.fit());
+
+    // 0.5 mA apart, the 600x slope alone moves 300 mA per step
+    float previous = calibration.apply(0.0);
+    float largest = 0.0;
+    for (float x = 0.5; x < 420.0; x += 0.5) {
+        float value = calibration.apply(x);
+        if (fabs(value - previous) > largest) largest = fabs(value - previous);
+        previous = value;
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "largest change per 0.5 mA: %.1f mA", largest);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(330.0, largest);
+
+    // Away from the step the segment fits are exact
+    TEST_ASSERT_FLOAT_WITHIN(0.002 * steppedReference(300.0), steppedReference(300.0), calibration.apply(300.0));
+    TEST_ASSERT_FLOAT_WITHIN(0.002 * steppedReference(50.0), steppedReference(50.0), calibration.apply(50.0));
+}
+
+void test_narrow_spread_is_rejected() {
+    Calibration calibration;
+    calibration.reset();
+    calibration.addSample(100.0, 60000.0);
+    calibration.addSample(101.0, 60600.0);
+    calibration.addSample(102.0, 61200.0);
+    TEST_ASSERT_FALSE(calibration.fit());
+    TEST_ASSERT_FALSE(calibration.isFitted());
+}
+
+void test_model_survives_reboot() {
+    {
+        Calibration calibration;
+        calibration.reset();
+        for (int i = 0; i < 40; i++) calibration.addSample(i * 10 + 1, 3.0 * (i * 10 + 1));
+        TEST_ASSERT_TRUE(calibration.fit());
+    }
+    Calibration restored;
+    TEST_ASSERT_TRUE(restored.begin());
+    TEST_ASSERT_TRUE(restored.isFitted());
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 600.0, restored.apply(200.0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unfitted_passes_through);
+    RUN_TEST(test_linear_response_is_recovered);
+    RUN_TEST(test_stepped_response_is_continuous);
+    RUN_TEST(test_narrow_spread_is_rejected);
+    RUN_TEST(test_model_survives_reboot);
+    return UNITY_END();
+}
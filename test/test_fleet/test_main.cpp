@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <sys/wait.h>
+#include "fleet_hub.h"
+
+// Member side of the wire format, one datagram per call
+static size_t buildPacket(uint8_t* packet, uint32_t unitId, uint32_t sequence, uint32_t firstMs, float generated) {
+    FleetPacketHeader header = {FLEET_MAGIC, FLEET_VERSION, FLEET_SAMPLES_PER_PACKET, unitId, sequence};
+    memcpy(packet, &header, sizeof(header));
+    for (int k = 0; k < FLEET_SAMPLES_PER_PACKET; k++) {
+        FleetSample sample = {firstMs + k * FLEET_SAMPLE_PERIOD, generated, 100.0f, 50.0f};
+        memcpy(packet + sizeof(header) + k * sizeof(sample), &sample, sizeof(sample));
+    }
+    return sizeof(header) + FLEET_SAMPLES_PER_PACKET * sizeof(FleetSample);
+}
+
+static const uint32_t PACKET_MS = FLEET_SAMPLE_PERIOD * FLEET_SAMPLES_PER_PACKET;
+
+void setUp() {}
+void tearDown() {}
+
+void test_merge_aligns_member_clocks() {
+    FleetHub hub;
+    TEST_ASSERT_TRUE(hub.begin(4, false));
+    uint8_t packet[256];
+
+    // Two members whose clocks differ by 5 s, both reporting the same hub period
+    for (uint32_t p = 0; p < 20; p++) {
+        uint32_t arrival = 100000 + p * PACKET_MS + PACKET_MS;
+        size_t length = buildPacket(packet, 1, p, 1000 + p * PACKET_MS, 200.0f);
+        TEST_ASSERT_TRUE(hub.ingest(packet, length, 0, arrival - 1));
+        length = buildPacket(packet, 2, p, 6000 + p * PACKET_MS, 300.0f);
+        TEST_ASSERT_TRUE(hub.ingest(packet, length, 0, arrival));
+    }
+    TEST_ASSERT_EQUAL(2, hub.getUnitCount());
+
+    FleetPoint series[64];
+    int points = hub.merge(100000 + 5 * PACKET_MS, PACKET_MS, series, 64);
+    TEST_ASSERT_GREATER_THAN(10, points);
+    for (int i = 0; i < points; i++) {
+        TEST_ASSERT_EQUAL(2, series[i].units);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 500.0, series[i].powerGenerated);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 200.0, series[i].powerLoad);
+        if (i > 0) TEST_ASSERT_EQUAL_UINT32(series[i - 1].timeMs + PACKET_MS, series[i].timeMs);
+    }
+}
+
+void test_sequence_gaps_and_duplicates() {
+    FleetHub hub;
+    TEST_ASSERT_TRUE(hub.begin(2, false));
+    uint8_t packet[256];
+
+    size_t length = buildPacket(packet, 7, 0, 1000, 100.0f);
+    TEST_ASSERT_TRUE(hub.ingest(packet, length, 0, 50000));
+    length = buildPacket(packet, 7, 3, 1000 + 3 * PACKET_MS, 100.0f);
+    TEST_ASSERT_TRUE(hub.ingest(packet, length, 0, 50000 + 3 * PACKET_MS));
+    TEST_ASSERT_FALSE(hub.ingest(packet, length, 0, 50000 + 3 * PACKET_MS));  // Duplicate
+
+    const FleetUnit* unit = hub.getUnit(0);
+    TEST_ASSERT_NOT_NULL(unit);
+    TEST_ASSERT_EQUAL_UINT32(2, unit->lost);
+    TEST_ASSERT_EQUAL_UINT32(2, unit->packets);
+    TEST_ASSERT_FALSE(hub.ingest(packet, 3, 0, 60000));  // Truncated
+}
+
+void test_rebooted_member_rejoins() {
+    FleetHub hub;
+    TEST_ASSERT_TRUE(hub.begin(2, false));
+    uint8_t packet[256];
+    uint32_t arrival = 200000;
+
+    for (uint32_t p = 0; p < 500; p++, arrival += PACKET_MS) {
+        size_t length = buildPacket(packet, 9, p, 1000 + p * PACKET_MS, 100.0f);
+        hub.ingest(packet, length, 0, arrival);
+    }
+
+    // Reboot: sequence and member clock restart at 0, samples must be accepted again
+    for (uint32_t p = 0; p < 10; p++, arrival += PACKET_MS) {
+        size_t length = buildPacket(packet, 9, p, 500 + p * PACKET_MS, 400.0f);
+        TEST_ASSERT_TRUE(hub.ingest(packet, length, 0, arrival));
+    }
+    const FleetUnit* unit = hub.getUnit(0);
+    TEST_ASSERT_EQUAL_UINT32(1, unit->rejoins);
+    TEST_ASSERT_EQUAL_UINT32(10, unit->packets);
+    TEST_ASSERT_EQUAL(10 * FLEET_SAMPLES_PER_PACKET, unit->count);
+
+    FleetPoint series[4];
+    TEST_ASSERT_EQUAL(1, hub.merge(arrival - PACKET_MS, PACKET_MS, series, 4));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 400.0, series[0].powerGenerated);
+}
+
+// Members in separate processes send over loopback UDP to a listening hub,
+// like a site on the hub's access point. Reports ingest rate, loss and merge time.
+static void runLoopback(int members, int processes, int packetsPerUnit) {
+    FleetHub hub;
+    TEST_ASSERT_TRUE(hub.begin(members, true));
+
+    int perProcess = members / processes;
+    for (int p = 0; p < processes; p++) {
+        if (fork() != 0) continue;
+        WiFiUDP udp;
+        uint8_t packet[256];
+        for (int round = 0; round < packetsPerUnit; round++) {
+            for (int u = p * perProcess; u < (p + 1) * perProcess; u++) {
+                size_t length = buildPacket(packet, 0x1000 + u, round, millis() + u * 37, 10.0f);
+                udp.beginPacket(IPAddress(127, 0, 0, 1), FLEET_PORT);
+                udp.write(packet, length);
+                udp.endPacket();
+            }
+            usleep(2000);  // One datagram per member per round, paced like a real batch period
+        }
+        _exit(0);
+    }
+
+    uint32_t busyUs = 0;
+    int running = processes;
+    uint32_t idleSince = millis();
+    while (running > 0 || millis() - idleSince < 200) {
+        while (running > 0 && waitpid(-1, nullptr, WNOHANG) > 0) running--;
+        uint32_t startUs = micros();
+        uint32_t before = 0;
+        for (int u = 0; u < hub.getUnitCount(); u++) before += hub.getUnit(u)->packets;
+        hub.poll();
+        uint32_t after = 0;
+        for (int u = 0; u < hub.getUnitCount(); u++) after += hub.getUnit(u)->packets;
+        if (after != before) {
+            busyUs += micros() - startUs;
+            idleSince = millis();
+        }
+    }
+
+    uint32_t received = 0;
+    uint32_t lost = 0;
+    for (int u = 0; u < hub.getUnitCount(); u++) {
+        received += hub.getUnit(u)->packets;
+        lost += hub.getUnit(u)->lost;
+    }
+
+    FleetPoint* series = new FleetPoint[FLEET_MAX_POINTS];
+    uint32_t startUs = micros();
+    int points = hub.merge(millis() - 2000, 10, series, FLEET_MAX_POINTS);
+    uint32_t mergeUs = micros() - startUs;
+    delete[] series;
+
+    char line[160];
+    snprintf(line, sizeof(line), "loopback %d members / %d processes: %u of %u packets, %u lost, %.0f packets/s ingest, merge %d points in %u us",
+             members, processes, received, members * packetsPerUnit, lost,
+             busyUs > 0 ? received * 1000000.0 / busyUs : 0.0, points, mergeUs);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(members, hub.getUnitCount());
+    TEST_ASSERT_GREATER_OR_EQUAL((uint32_t)(members * packetsPerUnit * 95 / 100), received);
+    TEST_ASSERT_GREATER_THAN(0, points);
+}
+
+void test_loopback_16_members() {
+    runLoopback(16, 2, 40);
+}
+
+void test_loopback_128_members() {
+    runLoopback(128, 4, 40);
+}
+
+void test_loopback_512_members() {
+    runLoopback(512, 8, 40);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_merge_aligns_member_clocks);
+    RUN_TEST(test_sequence_gaps_and_duplicates);
+    RUN_TEST(test_rebooted_member_rejoins);
+    RUN_TEST(test_loopback_16_members);
+    RUN_TEST(test_loopback_128_members);
+    RUN_TEST(test_loopback_512_members);
+    return UNITY_END();
+}
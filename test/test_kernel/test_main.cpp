@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "simulation.h"
+
+static PvModel pv;
+static Tariff tariff;
+
+static Simulation makeSimulation() {
+    Simulation simulation(nullptr, nullptr, &tariff, &pv);
+    simulation.setSeed(42);
+    return simulation;
+}
+
+// Best of several runs, so a busy host does not decide the ratio
+static uint32_t bestOf(int runs, const std::function<void()>& run) {
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < runs; i++) {
+        uint32_t startUs = micros();
+        run();
+        best = min(best, (uint32_t)(micros() - startUs));
+    }
+    return best;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_kernel_matches_stepped_energy() {
+    DayBuffers* buffers = new DayBuffers;
+    Simulation stepped = makeSimulation();
+    Simulation batched = makeSimulation();
+    uint32_t steps = stepped.runDays(172, 7, 15);
+    TEST_ASSERT_EQUAL_UINT32(7 * 96, steps);
+    TEST_ASSERT_EQUAL_UINT32(steps, batched.runDaysKernel(172, 7, 15, *buffers));
+
+    // Same model, independent noise: the weekly totals agree closely
+    float expected = stepped.getEnergyGenerated();
+    TEST_ASSERT_GREATER_THAN(0.0f, expected);
+    TEST_ASSERT_FLOAT_WITHIN(0.05 * expected, expected, batched.getEnergyGenerated());
+    delete buffers;
+}
+
+// Same comparison as GET /simulation/benchmark: runDays() (the per-step path of
+// update()) against the whole-day kernel, 1-minute steps, summer week
+void test_kernel_benchmark() {
+    DayBuffers* buffers = new DayBuffers;
+    const int days = 7;
+    uint32_t steps = days * 1440;
+
+    uint32_t steppedUs = bestOf(5, [&]() {
+        Simulation simulation = makeSimulation();
+        simulation.runDays(172, days, 1);
+    });
+    uint32_t kernelUs = bestOf(5, [&]() {
+        Simulation simulation = makeSimulation();
+        simulation.runDaysKernel(172, days, 1, *buffers);
+    });
+    delete buffers;
+
+    char line[160];
+    snprintf(line, sizeof(line), "%d days x 1440 steps: stepped %.3f us/step, kernel %.3f us/step, speed-up %.1fx (simd %s)",
+             days, (float)steppedUs / steps, (float)kernelUs / steps, kernelUs > 0 ? (float)steppedUs / kernelUs : 0.0f,
+             Simulation::usesSimd() ? "yes" : "no");
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(steppedUs, kernelUs);
+}
+
+int main() {
+    pv.begin();
+    tariff.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_kernel_matches_stepped_energy);
+    RUN_TEST(test_kernel_benchmark);
+    return UNITY_END();
+}
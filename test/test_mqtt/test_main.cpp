@@ -0,0 +1,157 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "mqtt_publisher.h"
+
+static Simulation simulation(nullptr, nullptr, nullptr, nullptr);
+
+static MqttSample makeSample(uint32_t sequence, uint32_t timeMs) {
+    MqttSample sample = {};
+    sample.sequence = sequence;
+    sample.timeMs = timeMs;
+    sample.voltage = 190.25f;
+    sample.current = 12.5f;
+    sample.powerGenerated = 2375.0f;
+    sample.powerLoad = 1250.0f;
+    sample.batteryLevel = 64.2f;
+    sample.totals = {12.345f, 9.876f, 1.234f, 3.456f};
+    return sample;
+}
+
+// Number of samples in an encoded batch (entries of the "dt" column)
+static int countSamples(const std::string& payload) {
+    size_t start = payload.find("\"dt\":[");
+    size_t end = payload.find(']', start);
+    if (start == std::string::npos || end == std::string::npos) return -1;
+    int count = 1;
+    for (size_t i = start; i < end; i++) count += payload[i] == ',';
+    return count;
+}
+
+void setUp() {
+    hostBroker.reset();
+}
+
+void tearDown() {}
+
+void test_encode_batch_columns() {
+    MqttSample samples[3] = {makeSample(1, 5000), makeSample(2, 6000), makeSample(3, 7250)};
+    samples[2].totals.generated = 20.5f;
+    char out[512];
+    size_t length = MqttPublisher::encodeBatch("abc", samples, 3, out, sizeof(out));
+
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_EQUAL(strlen(out), length);
+    TEST_ASSERT_TRUE(strncmp(out, "{\"id\":\"abc\",\"t0\":5000,\"dt\":[0,1000,2250]", 40) == 0);
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"v\":[190.25,190.25,190.25]"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"tot\":{\"gen\":20.500,"));
+    TEST_ASSERT_EQUAL('}', out[length - 1]);
+}
+
+void test_encode_batch_rejects_small_buffer() {
+    MqttSample samples[MQTT_BATCH_SIZE];
+    for (int i = 0; i < MQTT_BATCH_SIZE; i++) samples[i] = makeSample(i + 1, 1000 * i);
+    char out[64];
+    TEST_ASSERT_EQUAL(0, MqttPublisher::encodeBatch("abc", samples, MQTT_BATCH_SIZE, out, sizeof(out)));
+    TEST_ASSERT_EQUAL(0, MqttPublisher::encodeBatch("abc", samples, 0, out, sizeof(out)));
+
+    char full[MQTT_PAYLOAD_MAX];
+    TEST_ASSERT_GREATER_THAN(0, MqttPublisher::encodeBatch("abc", samples, MQTT_BATCH_SIZE, full, sizeof(full)));
+}
+
+void test_peek_keeps_records_until_commit() {
+    MqttPublisher publisher(&simulation);
+    TEST_ASSERT_TRUE(publisher.begin("127.0.0.1", 1883));
+    for (int i = 0; i < 25; i++) publisher.sample();
+
+    MqttSample batch[MQTT_BATCH_SIZE];
+    TEST_ASSERT_EQUAL(MQTT_BATCH_SIZE, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].sequence);
+    TEST_ASSERT_EQUAL(MQTT_BATCH_SIZE, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].sequence);  // Peek does not consume
+
+    publisher.commit(batch[MQTT_BATCH_SIZE - 1].sequence);
+    TEST_ASSERT_EQUAL(MQTT_BATCH_SIZE, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(MQTT_BATCH_SIZE + 1, batch[0].sequence);
+
+    publisher.commit(1000);
+    TEST_ASSERT_EQUAL(0, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+}
+
+void test_commit_after_overflow() {
+    MqttPublisher publisher(&simulation);
+    TEST_ASSERT_TRUE(publisher.begin("127.0.0.1", 1883));
+    MqttSample batch[MQTT_BATCH_SIZE];
+
+    // Peek a batch, then overflow the queue before the commit arrives
+    publisher.sample();
+    publisher.sample();
+    TEST_ASSERT_EQUAL(2, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+    for (int i = 0; i < MQTT_QUEUE_SIZE; i++) publisher.sample();
+    publisher.commit(batch[1].sequence);
+
+    // The dropped records are gone, the newest MQTT_QUEUE_SIZE are all still queued
+    TEST_ASSERT_EQUAL(1, publisher.peekBatch(batch, 1));
+    TEST_ASSERT_EQUAL_UINT32(3, batch[0].sequence);
+    TEST_ASSERT_NOT_NULL(strstr(publisher.getJson().c_str(), "\"queued\":360,\"capacity\":360,\"dropped\":2"));
+}
+
+void test_publish_through_broker_stand_in() {
+    MqttPublisher publisher(&simulation);
+    TEST_ASSERT_TRUE(publisher.begin("127.0.0.1", 1883));
+    for (int i = 0; i < 3 * MQTT_BATCH_SIZE; i++) publisher.sample();
+
+    publisher.service();
+    TEST_ASSERT_EQUAL_UINT32(1, hostBroker.connects);
+    TEST_ASSERT_EQUAL(3, hostBroker.payloads.size());
+    TEST_ASSERT_EQUAL_STRING("solar_monitor/c3d4e5f6/telemetry", hostBroker.topics[0].c_str());
+    for (const std::string& payload : hostBroker.payloads) TEST_ASSERT_EQUAL(MQTT_BATCH_SIZE, countSamples(payload));
+
+    MqttSample batch[1];
+    TEST_ASSERT_EQUAL(0, publisher.peekBatch(batch, 1));
+}
+
+void test_rejected_publish_keeps_records() {
+    MqttPublisher publisher(&simulation);
+    TEST_ASSERT_TRUE(publisher.begin("127.0.0.1", 1883));
+    for (int i = 0; i < 2 * MQTT_BATCH_SIZE; i++) publisher.sample();
+
+    // Broker refuses the message: nothing is lost, the batch is retried on the next pass
+    hostBroker.acceptPublish = false;
+    publisher.service();
+    TEST_ASSERT_EQUAL(0, hostBroker.payloads.size());
+    MqttSample batch[MQTT_BATCH_SIZE];
+    TEST_ASSERT_EQUAL(MQTT_BATCH_SIZE, publisher.peekBatch(batch, MQTT_BATCH_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].sequence);
+
+    // Broker away: records stay queued
+    hostBroker.acceptPublish = true;
+    hostBroker.online = false;
+    publisher.service();
+    TEST_ASSERT_EQUAL(0, hostBroker.payloads.size());
+
+    hostBroker.online = true;
+    publisher.service();
+    TEST_ASSERT_EQUAL(2, hostBroker.payloads.size());
+    TEST_ASSERT_NOT_NULL(strstr(hostBroker.payloads[0].c_str(), "\"t0\":"));
+    TEST_ASSERT_EQUAL(0, publisher.peekBatch(batch, 1));
+    TEST_ASSERT_NOT_NULL(strstr(publisher.getJson().c_str(), "\"failures\":1"));
+}
+
+void test_encode_benchmark() {
+    MqttPublisher publisher(&simulation);
+    String json = publisher.benchmark(200000);
+    TEST_MESSAGE(("encode " + json).c_str());
+    TEST_ASSERT_NOT_NULL(strstr(json.c_str(), "\"samples\":200000"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_encode_batch_columns);
+    RUN_TEST(test_encode_batch_rejects_small_buffer);
+    RUN_TEST(test_peek_keeps_records_until_commit);
+    RUN_TEST(test_commit_after_overflow);
+    RUN_TEST(test_publish_through_broker_stand_in);
+    RUN_TEST(test_rejected_publish_keeps_records);
+    RUN_TEST(test_encode_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "pv_model.h"
+
+PvModel model;
+
+void setUp() {}
+void tearDown() {}
+
+void test_fit_reproduces_datasheet() {
+    PvPoint point;
+    TEST_ASSERT_TRUE(model.solve(1000.0, 25.0, point));
+    TEST_ASSERT_FLOAT_WITHIN(PANEL_PEAK_POWER * 0.005, PANEL_PEAK_POWER, point.power);
+    TEST_ASSERT_FLOAT_WITHIN(PANEL_VMP * 0.01, PANEL_VMP, point.voltage);
+    TEST_ASSERT_LESS_THAN(PV_NEWTON_MAX_ITERATIONS, point.iterations);
+}
+
+void test_power_falls_with_temperature() {
+    PvPoint cool, hot;
+    model.solve(1000.0, 25.0, cool);
+    model.solve(1000.0, 50.0, hot);
+    TEST_ASSERT_LESS_THAN(cool.power, hot.power);
+    TEST_ASSERT_LESS_THAN(cool.voltage, hot.voltage);
+}
+
+// Table against the direct solve halfway between grid points, where bilinear
+// interpolation is worst
+void test_table_error_above_100_wm2() {
+    float worst = 0.0;
+    for (float g = 100.0 + PV_TABLE_IRRADIANCE_STEP / 2; g < 1200.0; g += PV_TABLE_IRRADIANCE_STEP / 2) {
+        for (float t = PV_TABLE_TEMPERATURE_MIN + PV_TABLE_TEMPERATURE_STEP / 2; t < 80.0; t += PV_TABLE_TEMPERATURE_STEP / 2) {
+            PvPoint point;
+            float power, voltage;
+            model.solve(g, t, point);
+            model.lookup(g, t, power, voltage);
+            float error = fabs(power - point.power) / point.power;
+            if (error > worst) worst = error;
+        }
+    }
+
+    char line[80];
+    snprintf(line, sizeof(line), "table worst error above 100 W/m2: %.3f%%", worst * 100.0);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(0.005, worst);
+}
+
+void test_dark_panel_delivers_nothing() {
+    float power, voltage;
+    model.lookup(0.0, 25.0, power, voltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0, power);
+}
+
+void test_lookup_benchmark() {
+    const int lookups = 10000000;
+    float sum = 0.0;
+    unsigned long best = ~0UL;
+    for (int run = 0; run < 5; run++) {
+        unsigned long start = micros();
+        for (int i = 0; i < lookups; i++) {
+            float power, voltage;
+            model.lookup((i % 1200) + 0.5f, ((i >> 4) % 100) - 20.0f, power, voltage);
+            sum += power;
+        }
+        unsigned long us = micros() - start;
+        if (us < best) best = us;
+    }
+
+    PvPoint point;
+    const int solves = 100000;
+    unsigned long start = micros();
+    for (int i = 0; i < solves; i++) {
+        model.solve((i % 1100) + 100.5f, ((i >> 4) % 100) - 20.0f, point);
+        sum += point.power;
+    }
+    unsigned long solveUs = micros() - start;
+
+    char line[120];
+    snprintf(line, sizeof(line), "lookup %.1f ns, direct solve %.0f ns (checksum %.0f)",
+             best * 1000.0 / lookups, solveUs * 1000.0 / solves, sum);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, best);
+}
+
+int main() {
+    model.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_fit_reproduces_datasheet);
+    RUN_TEST(test_power_falls_with_temperature);
+    RUN_TEST(test_table_error_above_100_wm2);
+    RUN_TEST(test_dark_panel_delivers_nothing);
+    RUN_TEST(test_lookup_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "rollup_store.h"
+
+static const int64_t TEN_DAYS_MS = 10LL * 86400 * 1000;
+
+// Daily sine on top of 100 W, sampled at 10 Hz
+static InaSample sampleAt(int64_t ms) {
+    float phase = ms / 8.64e7 * 6.2831853;
+    InaSample sample = {};
+    sample.timeMs = (uint32_t)ms;
+    sample.voltage = 12.0 + sin(phase);
+    sample.current = 1000.0;
+    sample.power = (100.0 + 50.0 * sin(phase)) * 1000.0;
+    sample.converted = true;
+    return sample;
+}
+
+// Feeds [fromMs, toMs) and returns the exact energy (Wh) of the rectangle rule the store uses
+static double feed(RollupStore& store, int64_t fromMs, int64_t toMs) {
+    double exact = 0.0;
+    for (int64_t ms = fromMs; ms < toMs; ms += 100) {
+        hostTimerUs = ms * 1000;
+        InaSample sample = sampleAt(ms);
+        store.addSample(sample);
+        if (ms > fromMs) exact += sample.power / 1000.0 * 0.1 / 3600.0;
+    }
+    return exact;
+}
+
+struct Totals {
+    int buckets;
+    double energy;
+    uint32_t samples;
+    RollupTier tier;
+    uint32_t width;
+};
+
+static Totals totals(RollupStore& store, uint32_t from, uint32_t to, int points) {
+    Totals result = {0, 0.0, 0, ROLLUP_SECOND, 0};
+    result.buckets = store.query(from, to, points, result.tier, result.width, [&](const RollupBucket& bucket) {
+        result.energy += bucket.energy;
+        result.samples += bucket.samples;
+        return true;
+    });
+    return result;
+}
+
+void setUp() {
+    hostTimerUs = 0;
+}
+void tearDown() {
+    hostPsram = false;
+}
+
+void test_ten_days_at_10hz() {
+    hostPsram = true;  // N8R8: full retention
+    RollupStore store;
+    TEST_ASSERT_TRUE(store.begin());
+
+    unsigned long start = micros();
+    double exact = feed(store, 0, TEN_DAYS_MS);
+    unsigned long elapsedUs = micros() - start;
+    uint32_t now = RollupStore::now();
+
+    char line[120];
+    snprintf(line, sizeof(line), "10 days at 10 Hz: %.1f ns per sample, %.3f Wh", elapsedUs * 1000.0 / (TEN_DAYS_MS / 100), exact);
+    TEST_MESSAGE(line);
+
+    // Whole run from the hour tier: every sample and the energy within float rounding
+    Totals all = totals(store, 0, now + 1, 500);
+    TEST_ASSERT_EQUAL(ROLLUP_HOUR, all.tier);
+    TEST_ASSERT_EQUAL_UINT32(TEN_DAYS_MS / 100, all.samples);
+    TEST_ASSERT_FLOAT_WITHIN(exact * 0.001, exact, all.energy);
+
+    // Last day from the minute tier, last hour from the second tier
+    Totals day = totals(store, now - 86400, now + 1, 500);
+    TEST_ASSERT_EQUAL(ROLLUP_MINUTE, day.tier);
+    TEST_ASSERT_FLOAT_WITHIN(exact / 10 * 0.01, exact / 10, day.energy);
+
+    Totals hour = totals(store, now - 3599, now + 1, 3600);
+    TEST_ASSERT_EQUAL(ROLLUP_SECOND, hour.tier);
+    TEST_ASSERT_EQUAL_UINT32(1, hour.width);
+    TEST_ASSERT_EQUAL_UINT32(36000, hour.samples);
+
+    // 8 days back is past the minute ring, so the hour tier answers
+    Totals week = totals(store, now - 8 * 86400, now + 1, 2000);
+    TEST_ASSERT_EQUAL(ROLLUP_HOUR, week.tier);
+
+    start = micros();
+    for (int i = 0; i < 100; i++) totals(store, now - 7 * 86400 + 3600, now + 1, ROLLUP_MAX_POINTS);
+    snprintf(line, sizeof(line), "7-day query, %d points: %lu us", ROLLUP_MAX_POINTS, (micros() - start) / 100);
+    TEST_MESSAGE(line);
+}
+
+void test_internal_ram_retention() {
+    RollupStore store;
+    TEST_ASSERT_TRUE(store.begin());
+    feed(store, 0, TEN_DAYS_MS);
+    uint32_t now = RollupStore::now();
+
+    // Without PSRAM the hour tier keeps 7 days; a 10-day range starts where it
+    // does and ends with the open hour
+    Totals all = totals(store, 0, now + 1, 500);
+    TEST_ASSERT_EQUAL(ROLLUP_HOUR, all.tier);
+    TEST_ASSERT_EQUAL(ROLLUP_HOURS_INTERNAL + 1, all.buckets);
+    TEST_ASSERT_NOT_NULL(strstr(store.getJson().c_str(), "\"capacity\":168"));
+}
+
+void test_gap_adds_no_energy() {
+    RollupStore store;
+    TEST_ASSERT_TRUE(store.begin());
+    double before = feed(store, 0, 10000);
+    feed(store, 20000, 30000);  // 10 s without samples in between
+    Totals all = totals(store, 0, RollupStore::now() + 1, 1);
+    TEST_ASSERT_EQUAL_UINT32(200, all.samples);
+    TEST_ASSERT_FLOAT_WITHIN(before * 0.01, 2 * before, all.energy);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ten_days_at_10hz);
+    RUN_TEST(test_internal_ram_retention);
+    RUN_TEST(test_gap_adds_no_energy);
+    return UNITY_END();
+}